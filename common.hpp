@@ -1,14 +1,42 @@
 #ifndef COMMON_HPP
 #define COMMON_HPP
 
+#include <algorithm>
 #include <array>
-#include <vulkan/vulkan.h>
-
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* only windows has a window and a surface, everywhere else runs headless */
+#ifdef _WIN32
 #define NOMINMAX
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#include <vulkan/vulkan.h>
 
 #include "linmath.h"
+#include "ktga.hpp"
+#include "ktex.hpp"
+#include "katlas.hpp"
+#include "kalloc.hpp"
+#include "kgraph.hpp"
+#include "ktransform.hpp"
+
+#define VK_CALL(l) { VkResult vr = l; if (vr != VK_SUCCESS) { if (vr != VK_INCOMPLETE) { std::cerr << __FILE__ << ":" << __LINE__ << " Vulkan call failed: " << vr << "\n"; throw std::runtime_error(std::string(__FILE__) + ":" + std::to_string(__LINE__) + " Vulkan call failed"); } else { std::cout << "Warning: Vulkan call returned incomplete\n"; } } }
+#define VK_UNMAKE_VERSION_MAJOR(v) ((v) >> 22)
+#define VK_UNMAKE_VERSION_MINOR(v) (((v) >> 12) & 0x3ff)
+#define VK_UNMAKE_VERSION_PATCH(v) ((v) & 0xfff)
+
+#define VK_DEBUG_INFO
+#define VK_DEBUG
 
 struct extension_t {
 	const char * name;
@@ -17,10 +45,429 @@ struct extension_t {
 
 typedef extension_t layer_t;
 
+struct mapped_file_t {
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+	void * data;
+	size_t size;
+};
+
+/* mips are uploaded smallest first, resident_level is the most detailed level that is valid */
+struct vk_texture_stream_t {
+	mapped_file_t file;
+	ktex_t ktex;
+	VkFormat format;
+	uint32_t resident_level;
+	VkDeviceSize frame_budget;
+
+	/* frames whose descriptor set still references a retired sampler, which is destroyed once the
+	   graphics timeline reaches the value paired with it */
+	uint32_t stale_frames;
+	std::vector<std::pair<VkSampler, uint64_t>> retired_samplers;
+};
+
+/* one VkDeviceMemory carved up by kalloc, host visible blocks stay mapped for their whole lifetime */
+struct vk_memory_block_t {
+	VkDeviceMemory memory;
+	void * mapped;
+	kalloc_t ranges;
+	bool dedicated;
+
+	/* being emptied by the defragmenter, new allocations skip it until it is empty */
+	bool draining;
+};
+
+/* blocks of one memory type, optimal images get their own pools when bufferImageGranularity > 1
+   so they never share a granularity page with buffers or linear images */
+struct vk_memory_pool_t {
+	uint32_t memory_type;
+	bool optimal;
+	VkDeviceSize block_size;
+	std::vector<vk_memory_block_t> blocks;
+};
+
+/* what an allocation holds, only used to break the memory statistics down */
+enum vk_memory_category_t {
+	MEMORY_CATEGORY_MESH,
+	MEMORY_CATEGORY_TEXTURE,
+	MEMORY_CATEGORY_UNIFORM,
+	MEMORY_CATEGORY_DEPTH,
+	MEMORY_CATEGORY_STAGING,
+	MEMORY_CATEGORY_COUNT,
+};
+
+struct vk_allocation_t {
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	void * mapped;
+	uint32_t pool;
+	uint32_t block;
+	uint32_t handle;
+	vk_memory_category_t category;
+};
+
+/* what a resource's memory is used for, each usage ranks the device's memory types once in vk_device_caps_t */
+enum vk_memory_usage_t {
+	MEMORY_USAGE_DEVICE,	/* only the gpu touches it */
+	MEMORY_USAGE_UPLOAD,	/* cpu writes, gpu copies out of it */
+	MEMORY_USAGE_READBACK,	/* gpu writes, cpu reads */
+	MEMORY_USAGE_REBAR,		/* cpu writes, gpu reads in place, device local when the bar allows */
+	MEMORY_USAGE_TRANSIENT,	/* attachments that never leave the render pass, lazily allocated when the device has it */
+	MEMORY_USAGE_COUNT,
+};
+
+/* everything resource creation needs from the physical device, queried once after vk_create_physical */
+struct vk_device_caps_t {
+	VkPhysicalDeviceProperties props;
+	VkPhysicalDeviceFeatures feats;
+	VkPhysicalDeviceMemoryProperties memory;
+	VkFormatProperties depth_format;
+
+	/* memory types best first per usage, types that can't serve a usage are left out */
+	uint32_t usage_types[MEMORY_USAGE_COUNT][VK_MAX_MEMORY_TYPES];
+	uint32_t usage_type_count[MEMORY_USAGE_COUNT];
+
+	/* a device local host visible heap bigger than the 256MB legacy window */
+	bool rebar;
+
+	/* VK_KHR_timeline_semaphore features, core since 1.2 */
+	bool timeline_semaphore;
+
+	/* VK_KHR_synchronization2 features, core since 1.3 */
+	bool synchronization2;
+
+	/* the best MEMORY_USAGE_REBAR type is device local and not just the legacy window (rebar, integrated
+	   or cpu devices), so buffers the gpu reads can be created there and written without staging */
+	bool direct_upload;
+
+	/* VK_EXT_memory_budget was enabled on the device */
+	bool memory_budget;
+
+	/* timestampValidBits of the graphics family, 0 when it can't write timestamps */
+	uint32_t timestamp_bits;
+};
+
+/* bytes and allocations handed out per category, and per heap the VkDeviceMemory we hold against
+   what the driver lets the process use. Without VK_EXT_memory_budget usage is only our own blocks
+   and the budget is 80% of the heap. */
+struct vk_memory_stats_t {
+	VkDeviceSize category_bytes[MEMORY_CATEGORY_COUNT];
+	uint32_t category_count[MEMORY_CATEGORY_COUNT];
+
+	VkDeviceSize heap_allocated[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize heap_usage[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize heap_budget[VK_MAX_MEMORY_HEAPS];
+
+	/* heap_allocated when usage was last queried, what we allocated since is added on top */
+	VkDeviceSize heap_allocated_at_query[VK_MAX_MEMORY_HEAPS];
+};
+
+/* one persistently mapped uniform buffer split into a slice per frame in flight, draws bump
+   allocate out of the current frame's slice and bind it with a dynamic offset. The first reserved
+   bytes of every slice are kept across frames for vk_object_uniforms_t, the bump starts after them. */
+struct vk_uniform_ring_t {
+	VkBuffer buffer;
+	vk_allocation_t memory;
+	VkDeviceSize slice_size;
+	VkDeviceSize alignment;
+	VkDeviceSize base;
+	VkDeviceSize head;
+	VkDeviceSize reserved = 0;
+	/* bumped each time the buffer is recreated, whatever was kept in it is gone then */
+	uint32_t generation = 0;
+};
+
+/* a uniform per transform at a fixed place in every slice, only rewritten in the frames whose copy is
+   older than the transform, so objects that stand still cost nothing once every frame has them */
+struct vk_object_uniforms_t {
+	VkDeviceSize offset;
+	VkDeviceSize stride;
+	uint32_t count;
+	/* a bit per frame in flight whose copy of the slot is stale, pending lists the slots with any set */
+	std::vector<uint32_t> stale;
+	std::vector<uint32_t> pending;
+	std::vector<uint32_t> moved;
+	/* what the slots were written with, a new view, projection or ring makes every one stale */
+	mat4x4 view;
+	mat4x4 proj;
+	uint32_t ring_generation;
+};
+
+/* a queue's timeline semaphore counts its submits, submit N signals N once everything before it is done.
+   completed caches the last value read back so polling mostly doesn't reach the driver. */
+struct vk_timeline_t {
+	VkQueue queue;
+	VkSemaphore semaphore;
+	uint64_t submitted;
+	uint64_t completed;
+};
+
+/* value is ignored for binary semaphores */
+struct vk_timeline_wait_t {
+	VkSemaphore semaphore;
+	uint64_t value;
+	VkPipelineStageFlags stage;
+};
+
+/* barriers gathered for one point in a command buffer, recorded with a single vkCmdPipelineBarrier2 by
+   vk_barrier_flush. Each keeps its own stage and access masks, so batching never widens a dependency.
+   Without synchronization2 the flush records one vkCmdPipelineBarrier per distinct pair of stage masks. */
+struct vk_barrier_batch_t {
+	std::vector<VkMemoryBarrier2> memory;
+	std::vector<VkBufferMemoryBarrier2> buffers;
+	std::vector<VkImageMemoryBarrier2> images;
+};
+
+/* running totals since init, a flush is one vk_barrier_flush and commands the barrier calls it recorded */
+struct vk_barrier_stats_t {
+	uint64_t flushes;
+	uint64_t commands;
+	uint64_t memory;
+	uint64_t buffers;
+	uint64_t images;
+};
+
+/* one submitted batch of copies and transitions, its bytes of the staging ring are free again once the
+   transfer timeline reaches value */
+struct vk_staging_batch_t {
+	VkDeviceSize begin;
+	VkCommandBuffer cmd;
+	uint64_t value;
+};
+
+/* persistently mapped upload ring, copies and layout transitions are recorded into an open batch and
+   submitted without waiting. A batch's serial is its value on the transfer timeline. */
+struct vk_staging_t {
+	VkBuffer buffer;
+	vk_allocation_t memory;
+	VkDeviceSize size;
+	VkDeviceSize head;
+
+	/* the open batch, cmd is null until something has been allocated for it */
+	VkCommandBuffer cmd;
+	VkDeviceSize batch_begin;
+
+	/* oldest first */
+	std::vector<vk_staging_batch_t> in_flight;
+	std::vector<VkCommandBuffer> spare_cmds;
+
+	/* barriers for the open batch, flushed before the next command recorded into it and on submit */
+	vk_barrier_batch_t barriers;
+
+	/* only used with a separate transfer queue: what the open batch released to the graphics family,
+	   then once submitted what the next frame has to acquire after the transfer timeline reaches acquire_value.
+	   The stages are the ones the frame waits on the timeline at. */
+	vk_barrier_batch_t open_acquires;
+	VkPipelineStageFlags open_acquire_stages;
+	vk_barrier_batch_t acquires;
+	VkPipelineStageFlags acquire_stages;
+	uint64_t acquire_value;
+};
+
+struct vertex_t {
+	struct { float x, y, z; } pos;
+	struct { float r, g, b; } color;
+	struct { float u, v; } uv;
+};
+
+enum vk_asset_kind_t {
+	ASSET_KIND_MESH,
+	ASSET_KIND_TEXTURE,
+};
+
+/* read and decoded on a loader thread, then created and uploaded by the render thread which publishes it
+   at the start of the first frame after its staging batch is done */
+struct vk_asset_t {
+	vk_asset_kind_t kind;
+	std::string path;
+
+	/* decoded data, error is non-zero when reading or decoding failed */
+	int error;
+	std::vector<vertex_t> vertices;
+	std::vector<uint32_t> indices;
+	ktga_t tga;
+
+	/* created on the render thread, serial is the staging batch the upload went out in */
+	uint64_t serial;
+	VkDeviceSize size;
+	uint32_t vertex_count;
+	uint32_t index_count;
+	VkBuffer buffer;
+	VkImage image;
+	vk_allocation_t memory;
+	VkImageCreateInfo image_info;
+	VkImageViewCreateInfo view_info;
+	VkImageView view;
+	VkSampler sampler;
+};
+
+/* workers only touch queued and decoded under mutex, uploading belongs to the render thread */
+struct vk_loader_t {
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake;
+	bool stop;
+
+	std::deque<vk_asset_t> queued;
+	std::vector<vk_asset_t> decoded;
+	std::vector<vk_asset_t> uploading;
+
+	/* queued and neither published nor dropped yet, only the render thread touches it */
+	uint32_t pending;
+};
+
+/* a transient command pool and the buffers allocated from it, which are handed out again in order after every
+   reset so a frame allocates nothing once warm */
+struct vk_cmd_pool_t {
+	VkCommandPool pool;
+	std::vector<VkCommandBuffer> cmds;
+	uint32_t used;
+};
+
+/* a frame in flight's pools, all reset once the frame's last submit is done. Recording threads each get their
+   own secondary pool, a pool can only be used from one thread at a time. */
+struct vk_frame_cmds_t {
+	vk_cmd_pool_t primary;
+	std::vector<vk_cmd_pool_t> secondary;
+
+	/* the primary's first and last timestamps when vulkan.gpu_timestamps is set, written says there are
+	   results from the frame before to read */
+	VkQueryPool timestamps;
+	bool timestamps_written;
+};
+
+/* one indexed draw, vertices at the start of mesh_buffer and indices from index_offset. unif_offset
+   is its slot in the uniform ring. desc_set binds a texture of its own, VK_NULL_HANDLE keeps the frame's
+   set with the scene texture. */
+struct vk_draw_t {
+	VkBuffer mesh_buffer;
+	VkDeviceSize index_offset;
+	uint32_t index_count;
+	uint32_t first_index;
+	int32_t vertex_offset;
+	uint32_t unif_offset;
+	VkDescriptorSet desc_set;
+};
+
+struct vulkan_t;
+
+/* a scene for measuring throughput: objects draws spread over meshes uploads of the test mesh, each
+   with its own transform, plus textures resident textures of texture_size squared the objects sample in
+   turn. warmup_frames aren't measured, frames are. */
+struct vk_bench_config_t {
+	uint32_t objects = 1024;
+	uint32_t meshes = 1;
+	uint32_t textures = 0;
+	uint32_t texture_size = 256;
+	/* non-zero packs the textures into one atlas page this many texels square */
+	uint32_t atlas_size = 0;
+	/* objects that spin, the rest stand still */
+	uint32_t moving = ~0u;
+	uint32_t frames_in_flight = 2;
+	uint32_t warmup_frames = 60;
+	uint32_t frames = 600;
+	bool json = false;
+	const char * out_path = nullptr;
+};
+
+/* samples are per measured frame in seconds, gpu ones only when the device writes timestamps */
+struct vk_bench_t {
+	vk_bench_config_t config;
+	std::vector<vk_asset_t> meshes;
+	std::vector<vk_asset_t> textures;
+	/* one set per texture, the objects cycle through them like they do the meshes */
+	VkDescriptorPool desc_pool;
+	std::vector<VkDescriptorSet> desc_sets;
+	ktransform_soa_t transforms;
+	mat4x4 * models;
+	vk_object_uniforms_t uniforms;
+
+	std::vector<double> cpu_times;
+	std::vector<double> submit_times;
+	std::vector<double> gpu_times;
+};
+
+/* a transient image the frame graph gave a slot, pooled across frames for the next slot it fits.
+   state is what the last graph left it in, so the next first use waits on exactly that. */
+struct vk_graph_image_t {
+	kgraph_slot_t desc;
+	VkImage image;
+	VkImageView view;
+	vk_allocation_t memory;
+	kgraph_state_t state;
+	bool used;
+};
+
+/* render passes are keyed by their attachments, framebuffers by render pass, views and extent */
+struct vk_graph_render_pass_t {
+	std::vector<VkAttachmentDescription> attachments;
+	VkRenderPass render_pass;
+};
+
+struct vk_graph_framebuffer_t {
+	VkRenderPass render_pass;
+	std::vector<VkImageView> views;
+	VkExtent2D extent;
+	VkFramebuffer framebuffer;
+};
+
+/* records a pass, rp_info is null for passes without attachments and otherwise begins theirs */
+typedef std::function<void(vulkan_t &, VkCommandBuffer, const VkRenderPassBeginInfo *)> vk_graph_execute_t;
+
+/* a kgraph plus what it needs to record, images and views are per graph image and filled in for
+   the transient ones when the graph runs */
+struct vk_graph_t {
+	kgraph_t graph;
+	std::vector<vk_graph_execute_t> executes;
+	/* anything added here before the graph runs is recorded with the first pass's barriers */
+	vk_barrier_batch_t barriers;
+	std::vector<VkImage> images;
+	std::vector<VkImageView> views;
+};
+
+/* a resource the defragmenter may move, it is recreated from the stored create info in another block,
+   the copy is recorded, and *buffer or *image and *memory are rewritten before patch runs */
+struct vk_movable_t {
+	vk_allocation_t * memory;
+	VkBuffer * buffer;
+	VkImage * image;
+	VkBufferCreateInfo buffer_info;
+	VkImageCreateInfo image_info;
+
+	/* only color images, they are left in this layout after the copy and all levels and layers have to be in it */
+	VkImageLayout layout;
+	std::function<void(vulkan_t &)> patch;
+};
+
+/* objects replaced by a move, destroyed once the graphics timeline reaches value, the last submit that could
+   still reference them */
+struct vk_retired_t {
+	VkBuffer buffer;
+	VkImage image;
+	VkImageView view;
+	vk_allocation_t memory;
+	uint64_t value;
+};
+
+struct vk_defrag_t {
+	std::vector<vk_movable_t> movables;
+	std::vector<vk_retired_t> retired;
+
+	/* the block being emptied, block is KALLOC_NONE when there is none */
+	uint32_t pool = 0;
+	uint32_t block = KALLOC_NONE;
+};
+
 struct vulkan_t {
 	VkInstance instance;
 	VkAllocationCallbacks * allocator;
 	VkPhysicalDevice physical;
+	vk_device_caps_t caps;
 	VkDevice device;
 	VkSurfaceKHR surface;
 	VkSurfaceCapabilitiesKHR surface_capabilities;
@@ -34,23 +481,49 @@ struct vulkan_t {
 	/* per frame (backbuffer/frontbuffer or intermediate buffers) */
 	std::vector<VkImage> swapchain_images;
 	std::vector<VkImageView> swapchain_views;
-	std::vector<VkFramebuffer> framebuffers;
 	uint32_t swapchain_image_count = 0;
 
-	VkCommandPool cmd_pool;
+	/* headless renders into offscreen instead of a swapchain, with no window, surface or present, so any
+	   device runs it, software ones included. While readback is set each frame also copies the finished
+	   image into readback_buffer, tightly packed in swapchain_format. */
+	bool headless = false;
+	vk_graph_image_t offscreen;
+	bool readback = false;
+	VkBuffer readback_buffer = VK_NULL_HANDLE;
+	vk_allocation_t readback_memory;
+
+	/* the staging ring's pool on the transfer family, its buffers are recycled one at a time */
+	VkCommandPool transfer_cmd_pool;
+
+	/* every submit to a queue goes through its timeline, frames, moves and deletions wait on values of these */
+	vk_timeline_t graphics_timeline;
+	vk_timeline_t transfer_timeline;
 
-	/* per frame in flight */
-	std::vector<VkCommandBuffer> cmd_buffers;
+	/* per frame in flight, frame_values is the graphics timeline value of the frame's last submit */
+	std::vector<vk_frame_cmds_t> frame_cmds;
 	std::vector<VkSemaphore> semaphores_img_avail;
 	std::vector<VkSemaphore> semaphores_render_finished;
-	std::vector<VkFence> fences_flight;
+	std::vector<uint64_t> frame_values;
 	std::vector<VkDescriptorSet> desc_sets;
-	std::vector<VkBuffer> unif_buffers;
-	std::vector<VkDeviceMemory> unif_memorys;
-	std::vector<void *> unif_mappeds;
 	uint32_t frames_in_flight = 1;
 	uint32_t current_frame = 0;
 
+	/* the frame's draws, split across up to record_thread_count threads recording secondaries when each
+	   gets at least record_min_draws, recorded inline in the primary otherwise. 0 threads means one per core. */
+	std::vector<vk_draw_t> draws;
+	uint32_t record_thread_count = 0;
+	uint32_t record_min_draws = 2048;
+
+	/* submit_time is how long the last frame's queue submit took. With gpu_timestamps set (before init) and
+	   supported, gpu_time is how long the gpu took for the frame drawn frames_in_flight frames ago, read
+	   once its slot comes round again, and negative until there is one. Both in seconds. */
+	bool gpu_timestamps = false;
+	double submit_time = 0;
+	double gpu_time = -1;
+
+	/* draws its synthetic scene instead of the spinning model while set */
+	vk_bench_t * bench = nullptr;
+
 	VkShaderModule vertex_shader;
 	VkShaderModule fragment_shader;
 	VkPipelineLayout pipeline_layout;
@@ -61,41 +534,86 @@ struct vulkan_t {
 	VkDescriptorSetLayout desc_layout;
 
 	VkBuffer mesh_buffer;
-	VkDeviceMemory mesh_memory;
+	vk_allocation_t mesh_memory;
 	uint32_t mesh_vertex_count;
 	uint32_t mesh_index_count;
 
-	VkImage depth;
-	VkImageView depth_view;
-	VkDeviceMemory depth_memory;
+	/* the scene's transforms, only the ones touched since the last frame are rebuilt. Slot 0 is the mesh above. */
+	ktransform_soa_t transforms;
+	mat4x4 * models;
+	vk_object_uniforms_t object_uniforms;
+
+	/* rebuilt every frame, the transient images it allocates and the render passes and framebuffers it
+	   records with are cached, render_pass above is the cached one the main pass uses */
+	vk_graph_t frame_graph;
+	std::vector<vk_graph_image_t> graph_images;
+	std::vector<vk_graph_render_pass_t> graph_render_passes;
+	std::vector<vk_graph_framebuffer_t> graph_framebuffers;
 
 	VkImage texture;
 	VkImageView texture_view;
-	VkDeviceMemory texture_memory;
+	vk_allocation_t texture_memory;
 	VkSampler texture_sampler;
+	vk_texture_stream_t texture_stream;
+	/* bytes of mip levels the streamed texture uploads a frame */
+	VkDeviceSize texture_stream_budget = 16 * 1024;
+
+	/* the mesh and texture above are placeholders until the loader publishes the real ones, an empty mesh
+	   (mesh_index_count of 0) is not drawn. loader_uploads caps how many decoded assets a frame uploads. */
+	vk_loader_t loader;
+	uint32_t loader_thread_count = 2;
+	uint32_t loader_uploads = 1;
+
+	/* sub-allocated device memory, blocks default to memory_block_size but stay under 1/8 of their heap */
+	std::vector<vk_memory_pool_t> memory_pools;
+	VkDeviceSize memory_block_size = 64 * 1024 * 1024;
+
+	/* a new block that would take its heap over budget first asks memory_evict to free at least the
+	   given bytes of that heap, if it can't the allocation comes back empty when memory_soft_fail is
+	   set and goes ahead anyway when it isn't */
+	vk_memory_stats_t memory_stats = {};
+	std::function<bool(vulkan_t &, uint32_t, VkDeviceSize)> memory_evict;
+	bool memory_soft_fail = false;
+
+	/* per frame uniform space, 1MB holds a few thousand draws at the usual 256 byte alignment */
+	vk_uniform_ring_t unif_ring;
+	VkDeviceSize unif_slice_size = 1024 * 1024;
+
+	/* uploads are split into quarters of the ring so the gpu copies one while the next is filled */
+	vk_staging_t staging;
+	VkDeviceSize staging_size = 32 * 1024 * 1024;
+
+	/* set when the device has no synchronization2, or beforehand to run the legacy barriers anyway */
+	bool legacy_barriers = false;
+	vk_barrier_stats_t barrier_stats = {};
+
+	/* shared blocks less than defrag_threshold full are emptied into the others, defrag_budget bytes a frame */
+	vk_defrag_t defrag;
+	VkDeviceSize defrag_budget = 8 * 1024 * 1024;
+	float defrag_threshold = 0.5f;
 
 	VkQueue present_queue;
 	VkQueue graphics_queue;
 
+	/* a dma-only family when the device has one that copies at texel granularity, the graphics one otherwise */
+	VkQueue transfer_queue;
+
 	uint32_t graphics_family;
 	uint32_t present_family;
+	uint32_t transfer_family;
 
 	double target_fps = 144;
 
 	uint32_t window_width;
 	uint32_t window_height;
+#ifdef _WIN32
 	HWND hwnd;
 	HINSTANCE hinstance;
+#endif
 
 	VkDebugUtilsMessengerEXT debug_messenger;
 };
 
-struct vertex_t {
-	struct { float x, y, z; } pos;
-	struct { float r, g, b; } color;
-	struct { float u, v; } uv;
-};
-
 struct uniform_t {
 	mat4x4 model;
 	mat4x4 view;
@@ -136,46 +654,175 @@ inline std::array<VkVertexInputAttributeDescription, 3> vertex_attr_desc() {
 	return attr_descs;
 }
 
-inline uint32_t vk_memory_type(vulkan_t & vulkan, uint32_t type_filter, VkMemoryPropertyFlags props) {
-	VkPhysicalDeviceMemoryProperties mem_props;
-	vkGetPhysicalDeviceMemoryProperties(vulkan.physical, &mem_props);
-
-	for (uint32_t i = 0; i < mem_props.memoryTypeCount; i++) {
-		if (type_filter & (1 << i) && (mem_props.memoryTypes[i].propertyFlags & props) == props) {
-			return i;
+/* first type in the usage's ranking that the resource accepts, so a missing preferred type falls back to the next best */
+inline uint32_t vk_memory_type(vulkan_t & vulkan, uint32_t type_filter, vk_memory_usage_t usage) {
+	const vk_device_caps_t & caps = vulkan.caps;
+	for (uint32_t i = 0; i < caps.usage_type_count[usage]; i++) {
+		uint32_t type = caps.usage_types[usage][i];
+		if (type_filter & (1 << type)) {
+			return type;
 		}
 	}
 
 	throw std::runtime_error("Failed to find Vulkan memory type");
 }
 
+/* what the process uses of a heap right now, as of the last query plus our blocks since */
+inline VkDeviceSize vk_memory_heap_usage(vulkan_t & vulkan, uint32_t heap) {
+	const vk_memory_stats_t & stats = vulkan.memory_stats;
+	return stats.heap_usage[heap] + stats.heap_allocated[heap] - stats.heap_allocated_at_query[heap];
+}
+
+/* starts filling the current frame's slice, only once its fence has been waited on */
+inline void vk_uniform_ring_begin(vulkan_t & vulkan) {
+	vulkan.unif_ring.base = vulkan.unif_ring.slice_size * vulkan.current_frame;
+	vulkan.unif_ring.head = vulkan.unif_ring.reserved;
+}
+
+/* size bytes at the same offset in every slice for as long as the ring lives, returns that offset */
+inline VkDeviceSize vk_uniform_reserve(vulkan_t & vulkan, VkDeviceSize size) {
+	vk_uniform_ring_t & ring = vulkan.unif_ring;
+	VkDeviceSize offset = ring.reserved;
+	ring.reserved += (size + ring.alignment - 1) & ~(ring.alignment - 1);
+	if (ring.reserved > ring.slice_size) {
+		std::cout << "Uniform ring slice of " << ring.slice_size << " bytes can't keep " << ring.reserved << " bytes\n";
+		throw std::runtime_error("Uniform ring slice is full");
+	}
+
+	ring.head = std::max(ring.head, ring.reserved);
+	return offset;
+}
+
+/* space for one draw's uniforms, out_offset is the dynamic offset to bind it with */
+inline void * vk_uniform_alloc(vulkan_t & vulkan, VkDeviceSize size, uint32_t * out_offset) {
+	vk_uniform_ring_t & ring = vulkan.unif_ring;
+	VkDeviceSize offset = ring.head;
+	ring.head += (size + ring.alignment - 1) & ~(ring.alignment - 1);
+	if (ring.head > ring.slice_size) {
+		std::cout << "Uniform ring slice of " << ring.slice_size << " bytes is full\n";
+		throw std::runtime_error("Uniform ring slice is full");
+	}
+
+	*out_offset = static_cast<uint32_t>(ring.base + offset);
+	return static_cast<char *>(ring.memory.mapped) + ring.base + offset;
+}
+
+/* the dynamic offset of slot i in the current frame's slice */
+inline uint32_t vk_object_uniform_offset(vulkan_t & vulkan, const vk_object_uniforms_t & uniforms, uint32_t i) {
+	return static_cast<uint32_t>(vulkan.unif_ring.base + uniforms.offset + uniforms.stride * i);
+}
+
+void vk_init(vulkan_t & vulkan);
+void vk_deinit(vulkan_t & vulkan);
+void vk_draw_frame(vulkan_t & vulkan);
+
 void vk_create_instance(vulkan_t & vulkan, VkApplicationInfo app_info, const std::vector<layer_t> & vk_requested_layer_names, const std::vector<extension_t> & vk_requested_extension_names);
 void vk_create_physical(vulkan_t & vulkan, std::function<int64_t(const VkPhysicalDevice &)> score_func);
+void vk_query_device_caps(vulkan_t & vulkan);
 void vk_create_device(vulkan_t & vulkan, std::vector<layer_t> & requested_layers, std::vector<extension_t> & requested_extensions);
 void vk_create_surface(vulkan_t & vulkan);
+void vk_create_offscreen(vulkan_t & vulkan);
+void vk_destroy_offscreen(vulkan_t & vulkan);
+void vk_read_offscreen(vulkan_t & vulkan, std::vector<unsigned char> & out_pixels);
 void vk_create_swapchain(vulkan_t & vulkan, std::function<size_t(const std::vector<VkSurfaceFormatKHR> &)> choose_fmt_func, std::function<size_t(const std::vector<VkPresentModeKHR> &)> choose_mode_func, std::function<VkExtent2D(const VkSurfaceCapabilitiesKHR &)> choose_extent_func, std::function<uint32_t(uint32_t, uint32_t)> choose_image_count_func);
 void vk_init_pipeline(vulkan_t & vulkan, const std::vector<unsigned char> & vertex_spv, const std::vector<unsigned char> & fragment_spv);
 void vk_init_render_pass(vulkan_t & vulkan);
-void vk_init_framebuffers(vulkan_t & vulkan);
 void vk_create_command_utils(vulkan_t & vulkan);
 void vk_create_semaphores(vulkan_t & vulkan);
 void vk_create_descriptor_utilities(vulkan_t & vulkan);
-void vk_create_buffers(vulkan_t & vulkan);
-void vk_create_texture(vulkan_t & vulkan);
-void vk_create_depth(vulkan_t & vulkan);
-
-VkImage vk_create_image(vulkan_t & vulkan, VkExtent3D extent, VkImageType type, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props, VkDeviceMemory & memory);
-void vk_transition_image(vulkan_t & vulkan, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout);
+void vk_create_placeholders(vulkan_t & vulkan);
+void vk_create_uniform_ring(vulkan_t & vulkan);
+void vk_destroy_uniform_ring(vulkan_t & vulkan);
+void vk_create_object_uniforms(vulkan_t & vulkan, vk_object_uniforms_t & uniforms, uint32_t count);
+void vk_update_object_uniforms(vulkan_t & vulkan, vk_object_uniforms_t & uniforms, ktransform_soa_t & soa, mat4x4 * models, mat4x4 const view, mat4x4 const proj, uint32_t thread_count);
+bool vk_create_texture_container(vulkan_t & vulkan, const char * path);
+void vk_create_texture_atlas(vulkan_t & vulkan, const katlas_t & atlas, vk_asset_t & asset);
+void vk_create_texture_ktex(vulkan_t & vulkan, const ktex_t & ktex, vk_asset_t & asset);
+bool vk_create_texture_streamed(vulkan_t & vulkan, const char * path, VkDeviceSize frame_budget);
+void vk_stream_textures(vulkan_t & vulkan);
+
+void vk_loader_start(vulkan_t & vulkan);
+void vk_loader_stop(vulkan_t & vulkan);
+void vk_loader_queue(vulkan_t & vulkan, vk_asset_kind_t kind, const char * path);
+/* called at the start of a frame, after its timeline wait */
+void vk_loader_update(vulkan_t & vulkan);
+bool vk_loader_idle(vulkan_t & vulkan);
+
+void vk_bench_scene(vulkan_t & vulkan, vk_bench_t & bench, float time);
+void vk_bench_run(vulkan_t & vulkan, vk_bench_t & bench);
+
+void vk_graph_begin(vulkan_t & vulkan, vk_graph_t & graph);
+uint32_t vk_graph_import(vk_graph_t & graph, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent, const kgraph_state_t & state, VkImageLayout final_layout);
+uint32_t vk_graph_transient(vk_graph_t & graph, VkFormat format, VkExtent2D extent);
+/* declare what the pass reads and writes with kgraph_read and kgraph_write on graph.graph */
+uint32_t vk_graph_pass(vk_graph_t & graph, const char * name, bool side_effect, vk_graph_execute_t execute);
+void vk_graph_run(vulkan_t & vulkan, vk_graph_t & graph, VkCommandBuffer cmd);
+VkRenderPass vk_graph_render_pass(vulkan_t & vulkan, const std::vector<VkAttachmentDescription> & attachments);
+/* the pooled images and every framebuffer, for when the swapchain goes, the cache also drops render passes */
+void vk_destroy_graph_images(vulkan_t & vulkan);
+void vk_destroy_graph_cache(vulkan_t & vulkan);
+
+VkImageCreateInfo vk_image_info(VkExtent3D extent, VkImageType type, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, uint32_t mip_levels = 1, uint32_t array_layers = 1, VkImageCreateFlags flags = 0);
+/* vk_create_image and vk_create_buffer return VK_NULL_HANDLE when memory_soft_fail is set and the memory doesn't fit the budget */
+VkImage vk_create_image(vulkan_t & vulkan, const VkImageCreateInfo & create_info, vk_memory_usage_t memory_usage, vk_memory_category_t category, vk_allocation_t & memory);
+VkImage vk_create_image(vulkan_t & vulkan, VkExtent3D extent, VkImageType type, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, vk_memory_usage_t memory_usage, vk_memory_category_t category, vk_allocation_t & memory, uint32_t mip_levels = 1, uint32_t array_layers = 1, VkImageCreateFlags flags = 0);
+/* these record into the open staging batch, they have happened once its serial has been waited on */
+void vk_transition_image(vulkan_t & vulkan, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t base_level = 0, uint32_t level_count = 1, uint32_t layer_count = 1);
 void vk_copy_buffer_to_image(vulkan_t & vulkan, VkBuffer buffer, VkImage image, VkExtent3D extent);
+void vk_copy_buffer_to_image_regions(vulkan_t & vulkan, VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> & regions);
 
-VkBuffer vk_create_buffer(vulkan_t & vulkan, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props, VkDeviceMemory & memory);
+VkBuffer vk_create_buffer(vulkan_t & vulkan, VkDeviceSize size, VkBufferUsageFlags usage, vk_memory_usage_t memory_usage, vk_memory_category_t category, vk_allocation_t & memory);
+
+vk_allocation_t vk_alloc_memory(vulkan_t & vulkan, const VkMemoryRequirements & reqs, vk_memory_usage_t usage, vk_memory_category_t category, bool optimal);
+void vk_free_memory(vulkan_t & vulkan, vk_allocation_t & allocation);
+void vk_destroy_memory_pools(vulkan_t & vulkan);
+void vk_query_memory_budget(vulkan_t & vulkan);
+std::string vk_memory_stats_json(vulkan_t & vulkan);
+void vk_barrier_flush(vulkan_t & vulkan, vk_barrier_batch_t & batch, VkCommandBuffer cmd);
+/* recorded into the open staging batch like the image transitions and copies */
 void vk_copy_buffer(vulkan_t & vulkan, VkBuffer src, VkBuffer dst, VkDeviceSize size);
 
+void vk_create_staging(vulkan_t & vulkan);
+void vk_destroy_staging(vulkan_t & vulkan);
+void * vk_staging_alloc(vulkan_t & vulkan, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize * out_offset);
+VkCommandBuffer vk_staging_cmd(vulkan_t & vulkan);
+uint64_t vk_staging_submit(vulkan_t & vulkan);
+void vk_staging_wait(vulkan_t & vulkan, uint64_t serial);
+bool vk_staging_done(vulkan_t & vulkan, uint64_t serial);
+void vk_staging_acquire(vulkan_t & vulkan, vk_barrier_batch_t & barriers, std::vector<vk_timeline_wait_t> & waits);
+void vk_staging_flush(vulkan_t & vulkan);
+void vk_staging_upload_buffer(vulkan_t & vulkan, VkBuffer dst, VkDeviceSize dst_offset, const void * data, VkDeviceSize size);
+void vk_upload_buffer(vulkan_t & vulkan, VkBuffer dst, const vk_allocation_t & memory, VkDeviceSize dst_offset, const void * data, VkDeviceSize size);
+void vk_staging_upload_image(vulkan_t & vulkan, VkImage image, const unsigned char * data, const std::vector<VkBufferImageCopy> & regions, uint32_t block_width, uint32_t block_height, uint32_t block_bytes);
+
+void vk_defrag_register_buffer(vulkan_t & vulkan, VkBuffer * buffer, vk_allocation_t * memory, VkDeviceSize size, VkBufferUsageFlags usage);
+void vk_defrag_register_image(vulkan_t & vulkan, VkImage * image, vk_allocation_t * memory, const VkImageCreateInfo & create_info, VkImageLayout layout, std::function<void(vulkan_t &)> patch);
+void vk_defrag_unregister(vulkan_t & vulkan, vk_allocation_t * memory);
+void vk_defrag_step(vulkan_t & vulkan);
+void vk_defrag_flush(vulkan_t & vulkan);
+
 void vk_recreate_swapchain(vulkan_t & vulkan);
 
 void vk_frames_in_flight(vulkan_t & vulkan, uint32_t new_count);
 
+/* resets the current frame's pools, its last submit has to be done */
+void vk_reset_frame_cmds(vulkan_t & vulkan);
+/* a primary from the current frame's pool, valid until that frame comes around again */
+VkCommandBuffer vk_frame_cmd(vulkan_t & vulkan);
+void vk_frame_timestamp(vulkan_t & vulkan, VkCommandBuffer cmd, bool end);
+/* records vulkan.draws into the render pass, in parallel when there are enough of them */
+void vk_record_pass(vulkan_t & vulkan, VkCommandBuffer cmd, const VkRenderPassBeginInfo & rp_info);
 void vk_begin_cmd(vulkan_t & vulkan, VkCommandBuffer & buffer);
 void vk_end_cmd(vulkan_t & vulkan, VkCommandBuffer & buffer);
 
+void vk_create_timeline(vulkan_t & vulkan, VkQueue queue, vk_timeline_t & timeline);
+void vk_destroy_timeline(vulkan_t & vulkan, vk_timeline_t & timeline);
+/* submits cmd after waits and returns the value it signals on the timeline, signal is an optional binary semaphore */
+uint64_t vk_timeline_submit(vulkan_t & vulkan, vk_timeline_t & timeline, VkCommandBuffer cmd, const std::vector<vk_timeline_wait_t> & waits, VkSemaphore signal = VK_NULL_HANDLE);
+bool vk_timeline_done(vulkan_t & vulkan, vk_timeline_t & timeline, uint64_t value);
+void vk_timeline_wait(vulkan_t & vulkan, vk_timeline_t & timeline, uint64_t value);
+
+bool map_file(const char * path, mapped_file_t & mapped);
+void unmap_file(mapped_file_t & mapped);
+
 #endif
\ No newline at end of file
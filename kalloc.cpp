@@ -0,0 +1,276 @@
+#include "kalloc.hpp"
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+static uint32_t kalloc_fls(uint64_t x) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, x);
+	return index;
+#else
+	return 63 - __builtin_clzll(x);
+#endif
+}
+
+static uint32_t kalloc_ffs(uint64_t x) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, x);
+	return index;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+/* first level is the power of two, second level splits it linearly into KALLOC_SL_COUNT */
+static void kalloc_mapping(uint64_t size, uint32_t * fl, uint32_t * sl) {
+	if (size < KALLOC_SL_COUNT) {
+		*fl = 0;
+		*sl = static_cast<uint32_t>(size);
+		return;
+	}
+
+	uint32_t bit = kalloc_fls(size);
+	*fl = bit - KALLOC_SL_LOG2 + 1;
+	*sl = static_cast<uint32_t>(size >> (bit - KALLOC_SL_LOG2)) ^ KALLOC_SL_COUNT;
+}
+
+/* rounds up to the next list so any block found there is large enough */
+static void kalloc_mapping_search(uint64_t size, uint32_t * fl, uint32_t * sl) {
+	if (size >= KALLOC_SL_COUNT) {
+		size += (1ull << (kalloc_fls(size) - KALLOC_SL_LOG2)) - 1;
+	}
+	kalloc_mapping(size, fl, sl);
+}
+
+static uint32_t kalloc_node_new(kalloc_t * alloc) {
+	if (alloc->spare_nodes != KALLOC_NONE) {
+		uint32_t index = alloc->spare_nodes;
+		alloc->spare_nodes = alloc->nodes[index].next_free;
+		alloc->nodes[index].in_use = true;
+		return index;
+	}
+
+	alloc->nodes.push_back({});
+	alloc->nodes.back().in_use = true;
+	return static_cast<uint32_t>(alloc->nodes.size() - 1);
+}
+
+static void kalloc_node_release(kalloc_t * alloc, uint32_t index) {
+	alloc->nodes[index].in_use = false;
+	alloc->nodes[index].next_free = alloc->spare_nodes;
+	alloc->spare_nodes = index;
+}
+
+static void kalloc_insert_free(kalloc_t * alloc, uint32_t index) {
+	kalloc_node_t & node = alloc->nodes[index];
+	uint32_t fl, sl;
+	kalloc_mapping(node.size, &fl, &sl);
+
+	node.free = true;
+	node.prev_free = KALLOC_NONE;
+	node.next_free = alloc->heads[fl][sl];
+	if (node.next_free != KALLOC_NONE) {
+		alloc->nodes[node.next_free].prev_free = index;
+	}
+	alloc->heads[fl][sl] = index;
+
+	alloc->fl_bitmap |= 1ull << fl;
+	alloc->sl_bitmap[fl] |= 1u << sl;
+}
+
+static void kalloc_remove_free(kalloc_t * alloc, uint32_t index) {
+	kalloc_node_t & node = alloc->nodes[index];
+	uint32_t fl, sl;
+	kalloc_mapping(node.size, &fl, &sl);
+
+	if (node.prev_free != KALLOC_NONE) {
+		alloc->nodes[node.prev_free].next_free = node.next_free;
+	} else {
+		alloc->heads[fl][sl] = node.next_free;
+	}
+	if (node.next_free != KALLOC_NONE) {
+		alloc->nodes[node.next_free].prev_free = node.prev_free;
+	}
+
+	if (alloc->heads[fl][sl] == KALLOC_NONE) {
+		alloc->sl_bitmap[fl] &= ~(1u << sl);
+		if (alloc->sl_bitmap[fl] == 0) {
+			alloc->fl_bitmap &= ~(1ull << fl);
+		}
+	}
+
+	node.free = false;
+}
+
+static uint32_t kalloc_find_free(const kalloc_t * alloc, uint64_t size) {
+	uint32_t fl, sl;
+	kalloc_mapping_search(size, &fl, &sl);
+	if (fl >= KALLOC_FL_COUNT) {
+		return KALLOC_NONE;
+	}
+
+	uint32_t sl_map = alloc->sl_bitmap[fl] & (~0u << sl);
+	if (sl_map == 0) {
+		uint64_t fl_map = fl + 1 < KALLOC_FL_COUNT ? alloc->fl_bitmap & (~0ull << (fl + 1)) : 0;
+		if (fl_map == 0) {
+			return KALLOC_NONE;
+		}
+		fl = kalloc_ffs(fl_map);
+		sl_map = alloc->sl_bitmap[fl];
+	}
+
+	return alloc->heads[fl][kalloc_ffs(sl_map)];
+}
+
+/* splits size bytes off the front of node, the rest becomes a new free node after it */
+static void kalloc_split(kalloc_t * alloc, uint32_t index, uint64_t size) {
+	uint32_t rest = kalloc_node_new(alloc);
+	kalloc_node_t & node = alloc->nodes[index];
+	kalloc_node_t & next = alloc->nodes[rest];
+
+	next.offset = node.offset + size;
+	next.size = node.size - size;
+	next.prev_phys = index;
+	next.next_phys = node.next_phys;
+	if (node.next_phys != KALLOC_NONE) {
+		alloc->nodes[node.next_phys].prev_phys = rest;
+	}
+
+	node.size = size;
+	node.next_phys = rest;
+
+	kalloc_insert_free(alloc, rest);
+}
+
+/* folds next_phys into index, next must already be off the free lists */
+static void kalloc_merge(kalloc_t * alloc, uint32_t index, uint32_t next_index) {
+	kalloc_node_t & node = alloc->nodes[index];
+	kalloc_node_t & next = alloc->nodes[next_index];
+
+	node.size += next.size;
+	node.next_phys = next.next_phys;
+	if (next.next_phys != KALLOC_NONE) {
+		alloc->nodes[next.next_phys].prev_phys = index;
+	}
+
+	kalloc_node_release(alloc, next_index);
+}
+
+int kalloc_create(kalloc_t * out_alloc, uint64_t size) {
+	if (out_alloc == nullptr || size == 0) {
+		return 1;
+	}
+
+	out_alloc->size = size;
+	out_alloc->used = 0;
+	out_alloc->allocation_count = 0;
+	out_alloc->fl_bitmap = 0;
+	memset(out_alloc->sl_bitmap, 0, sizeof(out_alloc->sl_bitmap));
+	memset(out_alloc->heads, 0xFF, sizeof(out_alloc->heads));
+	out_alloc->nodes.clear();
+	out_alloc->spare_nodes = KALLOC_NONE;
+
+	uint32_t root = kalloc_node_new(out_alloc);
+	kalloc_node_t & node = out_alloc->nodes[root];
+	node.offset = 0;
+	node.size = size;
+	node.prev_phys = KALLOC_NONE;
+	node.next_phys = KALLOC_NONE;
+	kalloc_insert_free(out_alloc, root);
+
+	return 0;
+}
+
+int kalloc_alloc(kalloc_t * alloc, uint64_t size, uint64_t alignment, uint64_t * out_offset, uint32_t * out_handle) {
+	if (alloc == nullptr || size == 0 || out_offset == nullptr || out_handle == nullptr || (alignment & (alignment - 1)) != 0) {
+		return 1;
+	}
+	if (alignment == 0) {
+		alignment = 1;
+	}
+
+	/* any block from the list for size + alignment - 1 fits wherever its aligned start lands */
+	uint32_t index = kalloc_find_free(alloc, size + alignment - 1);
+	if (index == KALLOC_NONE) {
+		return 3;
+	}
+
+	kalloc_remove_free(alloc, index);
+
+	uint64_t offset = alloc->nodes[index].offset;
+	uint64_t padding = ((offset + alignment - 1) & ~(alignment - 1)) - offset;
+	if (padding != 0) {
+		/* the front padding stays free as its own node, its physical neighbour before is in use */
+		kalloc_split(alloc, index, padding);
+		uint32_t aligned = alloc->nodes[index].next_phys;
+		kalloc_remove_free(alloc, aligned);
+		kalloc_insert_free(alloc, index);
+		index = aligned;
+	}
+
+	if (alloc->nodes[index].size > size) {
+		kalloc_split(alloc, index, size);
+	}
+
+	alloc->used += size;
+	++alloc->allocation_count;
+
+	*out_offset = alloc->nodes[index].offset;
+	*out_handle = index;
+	return 0;
+}
+
+void kalloc_free(kalloc_t * alloc, uint32_t handle) {
+	if (alloc == nullptr || handle >= alloc->nodes.size() || !alloc->nodes[handle].in_use || alloc->nodes[handle].free) {
+		return;
+	}
+
+	alloc->used -= alloc->nodes[handle].size;
+	--alloc->allocation_count;
+
+	uint32_t next = alloc->nodes[handle].next_phys;
+	if (next != KALLOC_NONE && alloc->nodes[next].free) {
+		kalloc_remove_free(alloc, next);
+		kalloc_merge(alloc, handle, next);
+	}
+
+	uint32_t prev = alloc->nodes[handle].prev_phys;
+	if (prev != KALLOC_NONE && alloc->nodes[prev].free) {
+		kalloc_remove_free(alloc, prev);
+		kalloc_merge(alloc, prev, handle);
+		handle = prev;
+	}
+
+	kalloc_insert_free(alloc, handle);
+}
+
+uint64_t kalloc_largest_free(const kalloc_t * alloc) {
+	if (alloc->fl_bitmap == 0) {
+		return 0;
+	}
+
+	uint32_t fl = kalloc_fls(alloc->fl_bitmap);
+	uint32_t sl = kalloc_fls(alloc->sl_bitmap[fl]);
+	uint64_t largest = 0;
+	for (uint32_t index = alloc->heads[fl][sl]; index != KALLOC_NONE; index = alloc->nodes[index].next_free) {
+		if (alloc->nodes[index].size > largest) {
+			largest = alloc->nodes[index].size;
+		}
+	}
+
+	return largest;
+}
+
+void kalloc_destroy(kalloc_t * alloc) {
+	alloc->nodes.clear();
+	alloc->nodes.shrink_to_fit();
+	alloc->spare_nodes = KALLOC_NONE;
+	alloc->fl_bitmap = 0;
+	alloc->size = 0;
+	alloc->used = 0;
+	alloc->allocation_count = 0;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#ifndef KRISVERS_KALLOC_HPP
+#define KRISVERS_KALLOC_HPP
+
+#include <cstdint>
+#include <vector>
+
+/* TLSF range allocator: hands out aligned [offset, offset + size) ranges of an abstract
+   block without touching its memory, so it can manage GPU memory it can't see */
+
+#define KALLOC_SL_LOG2 5
+#define KALLOC_SL_COUNT (1 << KALLOC_SL_LOG2)
+#define KALLOC_FL_COUNT 60
+#define KALLOC_NONE 0xFFFFFFFF
+
+struct kalloc_node_t {
+	uint64_t offset;
+	uint64_t size;
+	uint32_t prev_phys;
+	uint32_t next_phys;
+	uint32_t prev_free;
+	uint32_t next_free;
+	bool free;
+	bool in_use;
+};
+
+struct kalloc_t {
+	uint64_t size;
+	uint64_t used;
+	uint32_t allocation_count;
+
+	uint64_t fl_bitmap;
+	uint32_t sl_bitmap[KALLOC_FL_COUNT];
+	uint32_t heads[KALLOC_FL_COUNT][KALLOC_SL_COUNT];
+
+	/* handles index nodes, unused nodes are chained through next_free */
+	std::vector<kalloc_node_t> nodes;
+	uint32_t spare_nodes;
+};
+
+int kalloc_create(kalloc_t * out_alloc, uint64_t size);
+int kalloc_alloc(kalloc_t * alloc, uint64_t size, uint64_t alignment, uint64_t * out_offset, uint32_t * out_handle);
+void kalloc_free(kalloc_t * alloc, uint32_t handle);
+uint64_t kalloc_largest_free(const kalloc_t * alloc);
+void kalloc_destroy(kalloc_t * alloc);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,284 @@
+#include "katlas.hpp"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct katlas_node_t {
+	uint32_t x;
+	uint32_t y;
+	uint32_t w;
+};
+
+typedef std::vector<katlas_node_t> katlas_skyline_t;
+
+/* bottom-left skyline fit, returns the node index the rect starts at or -1 */
+static int katlas_skyline_find(const katlas_skyline_t & skyline, uint32_t page_width, uint32_t page_height, uint32_t w, uint32_t h, uint32_t * out_x, uint32_t * out_y) {
+	int best = -1;
+	uint32_t best_bottom = 0xFFFFFFFF;
+	uint32_t best_x = 0;
+
+	for (size_t i = 0; i < skyline.size(); ++i) {
+		uint32_t x = skyline[i].x;
+		if (x + w > page_width) {
+			break;
+		}
+
+		uint32_t y = 0;
+		uint32_t covered = 0;
+		for (size_t j = i; j < skyline.size() && covered < w; ++j) {
+			y = std::max(y, skyline[j].y);
+			covered += skyline[j].w;
+		}
+
+		if (covered < w || y + h > page_height) {
+			continue;
+		}
+
+		if (y + h < best_bottom || (y + h == best_bottom && x < best_x)) {
+			best = static_cast<int>(i);
+			best_bottom = y + h;
+			best_x = x;
+			*out_x = x;
+			*out_y = y;
+		}
+	}
+
+	return best;
+}
+
+static void katlas_skyline_insert(katlas_skyline_t & skyline, int index, uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+	skyline.insert(skyline.begin() + index, { x, y + h, w });
+
+	for (size_t i = index + 1; i < skyline.size();) {
+		uint32_t end = skyline[i - 1].x + skyline[i - 1].w;
+		if (skyline[i].x >= end) {
+			break;
+		}
+
+		uint32_t shrink = end - skyline[i].x;
+		if (skyline[i].w <= shrink) {
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+
+		skyline[i].x += shrink;
+		skyline[i].w -= shrink;
+		break;
+	}
+
+	for (size_t i = 0; i + 1 < skyline.size();) {
+		if (skyline[i].y == skyline[i + 1].y) {
+			skyline[i].w += skyline[i + 1].w;
+			skyline.erase(skyline.begin() + i + 1);
+		} else {
+			++i;
+		}
+	}
+}
+
+int katlas_build(katlas_t * out_atlas, const ktga_t * images, uint32_t image_count, uint32_t page_width, uint32_t page_height, uint32_t mip_levels, uint32_t max_pages) {
+	if (out_atlas == nullptr || images == nullptr || image_count == 0 || page_width == 0 || page_height == 0) {
+		return 1;
+	}
+
+	memset(out_atlas, 0, sizeof(*out_atlas));
+
+	uint32_t max_levels = 1;
+	while ((std::min(page_width, page_height) >> max_levels) != 0) {
+		++max_levels;
+	}
+	mip_levels = std::clamp(mip_levels, 1u, max_levels);
+
+	/* a texel of the smallest mip covers alignment x alignment texels of level 0, so cells
+	   aligned to that never share a texel at any level, and the gutter keeps one texel of
+	   the image's own border around it all the way down the chain */
+	out_atlas->alignment = 1u << (mip_levels - 1);
+	out_atlas->padding = out_atlas->alignment;
+
+	if (page_width % out_atlas->alignment != 0 || page_height % out_atlas->alignment != 0) {
+		return 1;
+	}
+
+	for (uint32_t i = 0; i < image_count; ++i) {
+		if (images[i].bitmap == nullptr || (images[i].header.bpp != 24 && images[i].header.bpp != 32)) {
+			return 4;
+		}
+	}
+
+	uint32_t padding = out_atlas->padding;
+	uint32_t alignment = out_atlas->alignment;
+	auto cell_size = [padding, alignment](uint32_t size) {
+		return (size + padding * 2 + alignment - 1) / alignment * alignment;
+	};
+
+	/* tallest first keeps the skyline flat */
+	std::vector<uint32_t> order(image_count);
+	for (uint32_t i = 0; i < image_count; ++i) {
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [images](uint32_t a, uint32_t b) {
+		if (images[a].header.img_h != images[b].header.img_h) {
+			return images[a].header.img_h > images[b].header.img_h;
+		}
+		return images[a].header.img_w > images[b].header.img_w;
+	});
+
+	out_atlas->entries = new katlas_entry_t[image_count];
+	if (out_atlas->entries == nullptr) {
+		return 3;
+	}
+	out_atlas->entry_count = image_count;
+
+	std::vector<katlas_skyline_t> pages;
+	for (uint32_t index : order) {
+		uint32_t w = cell_size(images[index].header.img_w);
+		uint32_t h = cell_size(images[index].header.img_h);
+		uint32_t x = 0;
+		uint32_t y = 0;
+
+		if (w > page_width || h > page_height) {
+			katlas_destroy(out_atlas);
+			return 2;
+		}
+
+		size_t page = 0;
+		int node = -1;
+		for (; page < pages.size(); ++page) {
+			node = katlas_skyline_find(pages[page], page_width, page_height, w, h, &x, &y);
+			if (node != -1) {
+				break;
+			}
+		}
+
+		if (node == -1) {
+			if (max_pages != 0 && pages.size() >= max_pages) {
+				katlas_destroy(out_atlas);
+				return 5;
+			}
+
+			pages.push_back({ { 0, 0, page_width } });
+			page = pages.size() - 1;
+			node = katlas_skyline_find(pages[page], page_width, page_height, w, h, &x, &y);
+		}
+
+		katlas_skyline_insert(pages[page], node, x, y, w, h);
+
+		katlas_entry_t & entry = out_atlas->entries[index];
+		entry.page = static_cast<uint32_t>(page);
+		entry.x = x + padding;
+		entry.y = y + padding;
+		entry.w = images[index].header.img_w;
+		entry.h = images[index].header.img_h;
+		entry.uv_scale[0] = static_cast<float>(entry.w) / page_width;
+		entry.uv_scale[1] = static_cast<float>(entry.h) / page_height;
+		entry.uv_offset[0] = static_cast<float>(entry.x) / page_width;
+		entry.uv_offset[1] = static_cast<float>(entry.y) / page_height;
+	}
+
+	ktex_t & tex = out_atlas->texture;
+	tex.vk_format = VK_FORMAT_B8G8R8A8_SRGB;
+	tex.width = page_width;
+	tex.height = page_height;
+	tex.depth = 1;
+	tex.levels = mip_levels;
+	tex.layers = static_cast<uint32_t>(pages.size());
+	tex.faces = 1;
+	tex.block_width = 1;
+	tex.block_height = 1;
+	tex.block_bytes = 4;
+
+	tex.images = new ktex_image_t[tex.levels * tex.layers];
+	if (tex.images == nullptr) {
+		katlas_destroy(out_atlas);
+		return 3;
+	}
+
+	unsigned long long int size = 0;
+	for (uint32_t level = 0; level < tex.levels; ++level) {
+		for (uint32_t layer = 0; layer < tex.layers; ++layer) {
+			ktex_image_t & image = tex.images[level * tex.layers + layer];
+			image.level = level;
+			image.layer = layer;
+			image.width = std::max(page_width >> level, 1u);
+			image.height = std::max(page_height >> level, 1u);
+			image.depth = 1;
+			image.offset = size;
+			image.size = static_cast<uint64_t>(image.width) * image.height * 4;
+			size += image.size;
+		}
+	}
+
+	out_atlas->data = new unsigned char[size];
+	if (out_atlas->data == nullptr) {
+		katlas_destroy(out_atlas);
+		return 3;
+	}
+	memset(out_atlas->data, 0, size);
+	tex.data = out_atlas->data;
+	tex.data_length = size;
+
+	/* fill each whole cell, clamping to the image so the gutter repeats its edge texels */
+	for (uint32_t i = 0; i < image_count; ++i) {
+		const katlas_entry_t & entry = out_atlas->entries[i];
+		const ktga_t & tga = images[i];
+		uint32_t bytes = tga.header.bpp / 8;
+		unsigned char * page = out_atlas->data + tex.images[entry.page].offset;
+
+		uint32_t cell_w = cell_size(entry.w);
+		uint32_t cell_h = cell_size(entry.h);
+		for (uint32_t cy = 0; cy < cell_h; ++cy) {
+			int64_t sy = std::clamp<int64_t>(static_cast<int64_t>(cy) - padding, 0, entry.h - 1);
+			for (uint32_t cx = 0; cx < cell_w; ++cx) {
+				int64_t sx = std::clamp<int64_t>(static_cast<int64_t>(cx) - padding, 0, entry.w - 1);
+				const unsigned char * src = tga.bitmap + (sy * entry.w + sx) * bytes;
+				unsigned char * dst = page + ((static_cast<uint64_t>(entry.y - padding + cy) * page_width) + entry.x - padding + cx) * 4;
+
+				dst[0] = src[0];
+				dst[1] = src[1];
+				dst[2] = src[2];
+				dst[3] = bytes == 4 ? src[3] : 0xFF;
+			}
+		}
+	}
+
+	/* 2x2 box filter, cells are aligned so this never mixes two images */
+	for (uint32_t level = 1; level < tex.levels; ++level) {
+		for (uint32_t layer = 0; layer < tex.layers; ++layer) {
+			const ktex_image_t & src_image = tex.images[(level - 1) * tex.layers + layer];
+			const ktex_image_t & dst_image = tex.images[level * tex.layers + layer];
+			const unsigned char * src = out_atlas->data + src_image.offset;
+			unsigned char * dst = out_atlas->data + dst_image.offset;
+
+			for (uint32_t y = 0; y < dst_image.height; ++y) {
+				uint32_t y0 = std::min(y * 2, src_image.height - 1);
+				uint32_t y1 = std::min(y * 2 + 1, src_image.height - 1);
+				for (uint32_t x = 0; x < dst_image.width; ++x) {
+					uint32_t x0 = std::min(x * 2, src_image.width - 1);
+					uint32_t x1 = std::min(x * 2 + 1, src_image.width - 1);
+					for (uint32_t c = 0; c < 4; ++c) {
+						uint32_t sum = src[(y0 * src_image.width + x0) * 4 + c] + src[(y0 * src_image.width + x1) * 4 + c] + src[(y1 * src_image.width + x0) * 4 + c] + src[(y1 * src_image.width + x1) * 4 + c];
+						dst[(y * dst_image.width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+					}
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
+void katlas_remap_uv(const katlas_entry_t * entry, float * u, float * v) {
+	*u = *u * entry->uv_scale[0] + entry->uv_offset[0];
+	*v = *v * entry->uv_scale[1] + entry->uv_offset[1];
+}
+
+void katlas_destroy(katlas_t * atlas) {
+	delete[] atlas->entries;
+	delete[] atlas->data;
+	ktex_destroy(&atlas->texture);
+
+	atlas->entries = nullptr;
+	atlas->data = nullptr;
+	atlas->entry_count = 0;
+}
\ No newline at end of file
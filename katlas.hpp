@@ -0,0 +1,36 @@
+#ifndef KRISVERS_KATLAS_HPP
+#define KRISVERS_KATLAS_HPP
+
+#include <cstdint>
+#include "ktga.hpp"
+#include "ktex.hpp"
+
+struct katlas_entry_t {
+	uint32_t page;
+	uint32_t x;
+	uint32_t y;
+	uint32_t w;
+	uint32_t h;
+
+	/* uv' = uv * uv_scale + uv_offset, only valid for uvs inside [0, 1] */
+	float uv_scale[2];
+	float uv_offset[2];
+};
+
+struct katlas_t {
+	uint32_t padding;
+	uint32_t alignment;
+	uint32_t entry_count;
+	katlas_entry_t * entries;
+
+	/* pages as B8G8R8A8 array layers with a full mip chain, data is owned by the atlas */
+	ktex_t texture;
+	unsigned char * data;
+};
+
+/* max_pages of 0 opens as many pages as the images need, otherwise 5 is returned once they overflow it */
+int katlas_build(katlas_t * out_atlas, const ktga_t * images, uint32_t image_count, uint32_t page_width, uint32_t page_height, uint32_t mip_levels, uint32_t max_pages);
+void katlas_remap_uv(const katlas_entry_t * entry, float * u, float * v);
+void katlas_destroy(katlas_t * atlas);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,406 @@
+#include "kgraph.hpp"
+
+#define KGRAPH_WRITE_ACCESS (VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_HOST_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT)
+
+static VkImageAspectFlags kgraph_format_aspect(VkFormat format) {
+	switch (format) {
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+}
+
+static VkImageUsageFlags kgraph_usage_flags(kgraph_usage_t usage) {
+	switch (usage) {
+	case KGRAPH_USAGE_COLOR_ATTACHMENT: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	case KGRAPH_USAGE_DEPTH_ATTACHMENT: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case KGRAPH_USAGE_DEPTH_READ: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+	case KGRAPH_USAGE_SAMPLED: return VK_IMAGE_USAGE_SAMPLED_BIT;
+	case KGRAPH_USAGE_STORAGE: return VK_IMAGE_USAGE_STORAGE_BIT;
+	case KGRAPH_USAGE_TRANSFER_SRC: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	case KGRAPH_USAGE_TRANSFER_DST: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
+	return 0;
+}
+
+static bool kgraph_usage_writable(kgraph_usage_t usage) {
+	return usage != KGRAPH_USAGE_DEPTH_READ && usage != KGRAPH_USAGE_SAMPLED && usage != KGRAPH_USAGE_TRANSFER_SRC;
+}
+
+VkImageLayout kgraph_usage_layout(kgraph_usage_t usage) {
+	switch (usage) {
+	case KGRAPH_USAGE_COLOR_ATTACHMENT: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	case KGRAPH_USAGE_DEPTH_ATTACHMENT: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	case KGRAPH_USAGE_DEPTH_READ: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	case KGRAPH_USAGE_SAMPLED: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	case KGRAPH_USAGE_STORAGE: return VK_IMAGE_LAYOUT_GENERAL;
+	case KGRAPH_USAGE_TRANSFER_SRC: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	case KGRAPH_USAGE_TRANSFER_DST: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	}
+	return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+void kgraph_usage_access(kgraph_usage_t usage, bool write, VkPipelineStageFlags2 * stages, VkAccessFlags2 * access) {
+	switch (usage) {
+	case KGRAPH_USAGE_COLOR_ATTACHMENT:
+		*stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		*access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : 0);
+		break;
+	case KGRAPH_USAGE_DEPTH_ATTACHMENT:
+	case KGRAPH_USAGE_DEPTH_READ:
+		*stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+		*access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+		break;
+	case KGRAPH_USAGE_SAMPLED:
+		*stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+		*access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+		break;
+	case KGRAPH_USAGE_STORAGE:
+		*stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		*access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | (write ? VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT : 0);
+		break;
+	case KGRAPH_USAGE_TRANSFER_SRC:
+		*stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		*access = VK_ACCESS_2_TRANSFER_READ_BIT;
+		break;
+	case KGRAPH_USAGE_TRANSFER_DST:
+		*stages = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		*access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		break;
+	}
+}
+
+/* undefined and present have no use on the gpu, so their side of a barrier waits for or blocks nothing */
+int kgraph_layout_access(VkImageLayout layout, VkPipelineStageFlags2 * stages, VkAccessFlags2 * access) {
+	switch (layout) {
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		*stages = VK_PIPELINE_STAGE_2_NONE;
+		*access = VK_ACCESS_2_NONE;
+		return 0;
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		kgraph_usage_access(KGRAPH_USAGE_COLOR_ATTACHMENT, true, stages, access);
+		return 0;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		kgraph_usage_access(KGRAPH_USAGE_DEPTH_ATTACHMENT, true, stages, access);
+		return 0;
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		kgraph_usage_access(KGRAPH_USAGE_DEPTH_READ, false, stages, access);
+		return 0;
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		kgraph_usage_access(KGRAPH_USAGE_SAMPLED, false, stages, access);
+		return 0;
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		kgraph_usage_access(KGRAPH_USAGE_TRANSFER_SRC, false, stages, access);
+		return 0;
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		kgraph_usage_access(KGRAPH_USAGE_TRANSFER_DST, true, stages, access);
+		return 0;
+	default:
+		return 1;
+	}
+}
+
+void kgraph_reset(kgraph_t * graph) {
+	graph->images.clear();
+	graph->passes.clear();
+	graph->slots.clear();
+	graph->states.clear();
+	graph->final_barriers.clear();
+}
+
+uint32_t kgraph_import(kgraph_t * graph, VkFormat format, VkExtent2D extent, const kgraph_state_t * state, VkImageLayout final_layout) {
+	graph->images.push_back({
+		.format = format,
+		.extent = extent,
+		.aspect = kgraph_format_aspect(format),
+		.imported = true,
+		.final_layout = final_layout,
+		.usage = 0,
+		.slot = KGRAPH_NONE,
+		.first_pass = KGRAPH_NONE,
+		.last_pass = KGRAPH_NONE,
+	});
+	graph->states.push_back(state != nullptr ? *state : kgraph_state_t{});
+
+	return static_cast<uint32_t>(graph->images.size() - 1);
+}
+
+uint32_t kgraph_transient(kgraph_t * graph, VkFormat format, VkExtent2D extent) {
+	graph->images.push_back({
+		.format = format,
+		.extent = extent,
+		.aspect = kgraph_format_aspect(format),
+		.imported = false,
+		.final_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.usage = 0,
+		.slot = KGRAPH_NONE,
+		.first_pass = KGRAPH_NONE,
+		.last_pass = KGRAPH_NONE,
+	});
+	graph->states.push_back({});
+
+	return static_cast<uint32_t>(graph->images.size() - 1);
+}
+
+uint32_t kgraph_pass(kgraph_t * graph, const char * name, bool side_effect) {
+	graph->passes.push_back({
+		.name = name,
+		.side_effect = side_effect,
+		.culled = false,
+		.accesses = {},
+		.barriers = {},
+	});
+
+	return static_cast<uint32_t>(graph->passes.size() - 1);
+}
+
+void kgraph_read(kgraph_t * graph, uint32_t pass, uint32_t image, kgraph_usage_t usage) {
+	graph->passes[pass].accesses.push_back({
+		.image = image,
+		.usage = usage,
+		.write = false,
+		.clear = false,
+		.clear_value = {},
+		.load_op = VK_ATTACHMENT_LOAD_OP_LOAD,
+		.store_op = VK_ATTACHMENT_STORE_OP_STORE,
+	});
+}
+
+void kgraph_write(kgraph_t * graph, uint32_t pass, uint32_t image, kgraph_usage_t usage, const VkClearValue * clear) {
+	graph->passes[pass].accesses.push_back({
+		.image = image,
+		.usage = usage,
+		.write = true,
+		.clear = clear != nullptr,
+		.clear_value = clear != nullptr ? *clear : VkClearValue{},
+		.load_op = VK_ATTACHMENT_LOAD_OP_LOAD,
+		.store_op = VK_ATTACHMENT_STORE_OP_STORE,
+	});
+}
+
+int kgraph_compile(kgraph_t * graph) {
+	if (graph == nullptr) {
+		return 1;
+	}
+
+	size_t image_count = graph->images.size();
+	for (kgraph_pass_t & pass : graph->passes) {
+		for (kgraph_access_t & access : pass.accesses) {
+			if (access.image >= image_count || (access.write && !kgraph_usage_writable(access.usage))) {
+				return 1;
+			}
+		}
+	}
+
+	/* backwards, an image is needed while a later pass reads what it holds at this point, imported
+	   ones always are. A pass that writes nothing needed is culled and so doesn't need its inputs. */
+	std::vector<bool> needed(image_count);
+	for (size_t i = 0; i < image_count; ++i) {
+		needed[i] = graph->images[i].imported;
+	}
+
+	for (size_t p = graph->passes.size(); p-- > 0;) {
+		kgraph_pass_t & pass = graph->passes[p];
+		pass.culled = !pass.side_effect;
+		for (kgraph_access_t & access : pass.accesses) {
+			if (access.write && needed[access.image]) {
+				pass.culled = false;
+			}
+		}
+		if (pass.culled) {
+			continue;
+		}
+
+		for (kgraph_access_t & access : pass.accesses) {
+			access.store_op = needed[access.image] ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		}
+		for (kgraph_access_t & access : pass.accesses) {
+			if (access.clear) {
+				needed[access.image] = false;
+			}
+		}
+		for (kgraph_access_t & access : pass.accesses) {
+			if (!access.clear) {
+				needed[access.image] = true;
+			}
+		}
+	}
+
+	/* forwards, only load what an earlier pass or the importer left behind */
+	std::vector<bool> defined(image_count);
+	for (size_t i = 0; i < image_count; ++i) {
+		kgraph_image_t & image = graph->images[i];
+		image.usage = 0;
+		image.slot = KGRAPH_NONE;
+		image.first_pass = KGRAPH_NONE;
+		image.last_pass = KGRAPH_NONE;
+		defined[i] = image.imported && graph->states[i].layout != VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+	for (size_t p = 0; p < graph->passes.size(); ++p) {
+		kgraph_pass_t & pass = graph->passes[p];
+		if (pass.culled) {
+			continue;
+		}
+
+		for (kgraph_access_t & access : pass.accesses) {
+			kgraph_image_t & image = graph->images[access.image];
+			if (!image.imported && !defined[access.image] && !access.write) {
+				return 2;
+			}
+
+			image.usage |= kgraph_usage_flags(access.usage);
+			if (image.first_pass == KGRAPH_NONE) {
+				image.first_pass = static_cast<uint32_t>(p);
+			}
+			image.last_pass = static_cast<uint32_t>(p);
+
+			if (access.clear) {
+				access.load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			} else {
+				access.load_op = defined[access.image] ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			}
+		}
+		for (kgraph_access_t & access : pass.accesses) {
+			if (access.write) {
+				defined[access.image] = true;
+			}
+		}
+	}
+
+	/* in order of first use, a slot is free again once its last image's last pass is behind */
+	graph->slots.clear();
+	std::vector<uint32_t> slot_last;
+	for (size_t p = 0; p < graph->passes.size(); ++p) {
+		if (graph->passes[p].culled) {
+			continue;
+		}
+
+		for (kgraph_access_t & access : graph->passes[p].accesses) {
+			kgraph_image_t & image = graph->images[access.image];
+			if (image.imported || image.slot != KGRAPH_NONE) {
+				continue;
+			}
+
+			uint32_t slot = KGRAPH_NONE;
+			for (uint32_t s = 0; s < graph->slots.size(); ++s) {
+				const kgraph_slot_t & candidate = graph->slots[s];
+				if (slot_last[s] < p && candidate.format == image.format && candidate.extent.width == image.extent.width && candidate.extent.height == image.extent.height) {
+					slot = s;
+					break;
+				}
+			}
+
+			if (slot == KGRAPH_NONE) {
+				graph->slots.push_back({
+					.format = image.format,
+					.extent = image.extent,
+					.aspect = image.aspect,
+					.usage = 0,
+					.state = {},
+				});
+				slot_last.push_back(0);
+				slot = static_cast<uint32_t>(graph->slots.size() - 1);
+			}
+
+			graph->slots[slot].usage |= image.usage;
+			slot_last[slot] = image.last_pass;
+			image.slot = slot;
+		}
+	}
+
+	return 0;
+}
+
+/* a layout change is a write of its own, so it waits for everything since the last write. Write after
+   write needs the first flushed, write after read only has to wait, and a read only waits for a write
+   it can't see yet, so reads after reads cost nothing. */
+static void kgraph_sync(kgraph_state_t & state, uint32_t image, VkImageLayout old_layout, VkImageLayout layout, VkPipelineStageFlags2 stages, VkAccessFlags2 access, bool write, std::vector<kgraph_barrier_t> & barriers) {
+	if (old_layout != layout) {
+		barriers.push_back({ image, old_layout, layout, state.write_stages | state.read_stages, state.write_access, stages, access });
+
+		state.layout = layout;
+		state.write_stages = stages;
+		state.write_access = write ? access & KGRAPH_WRITE_ACCESS : 0;
+		state.read_stages = 0;
+		state.visible_stages = write ? 0 : stages;
+		state.visible_access = write ? 0 : access;
+		return;
+	}
+
+	if (write) {
+		if ((state.write_stages | state.read_stages) != 0) {
+			barriers.push_back({ image, layout, layout, state.write_stages | state.read_stages, state.write_access, stages, state.write_access != 0 ? access : 0 });
+		}
+
+		state.write_stages = stages;
+		state.write_access = access & KGRAPH_WRITE_ACCESS;
+		state.read_stages = 0;
+		state.visible_stages = 0;
+		state.visible_access = 0;
+		return;
+	}
+
+	if (state.write_stages != 0 && ((stages & ~state.visible_stages) != 0 || (access & ~state.visible_access) != 0)) {
+		barriers.push_back({ image, layout, layout, state.write_stages, state.write_access, stages, state.write_access != 0 ? access : 0 });
+
+		state.visible_stages |= stages;
+		state.visible_access |= access;
+	}
+	state.read_stages |= stages;
+}
+
+void kgraph_schedule(kgraph_t * graph) {
+	auto state_of = [graph](uint32_t image) -> kgraph_state_t & {
+		const kgraph_image_t & info = graph->images[image];
+		return info.imported ? graph->states[image] : graph->slots[info.slot].state;
+	};
+
+	for (size_t p = 0; p < graph->passes.size(); ++p) {
+		kgraph_pass_t & pass = graph->passes[p];
+		pass.barriers.clear();
+		if (pass.culled) {
+			continue;
+		}
+
+		for (const kgraph_access_t & access : pass.accesses) {
+			const kgraph_image_t & image = graph->images[access.image];
+			kgraph_state_t & state = state_of(access.image);
+
+			VkPipelineStageFlags2 stages;
+			VkAccessFlags2 access_mask;
+			kgraph_usage_access(access.usage, access.write, &stages, &access_mask);
+
+			/* a transient image starts over at its first use even when its slot was just used */
+			VkImageLayout old_layout = !image.imported && image.first_pass == p ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+			kgraph_sync(state, access.image, old_layout, kgraph_usage_layout(access.usage), stages, access_mask, access.write, pass.barriers);
+		}
+	}
+
+	graph->final_barriers.clear();
+	for (uint32_t i = 0; i < graph->images.size(); ++i) {
+		const kgraph_image_t & image = graph->images[i];
+		kgraph_state_t & state = graph->states[i];
+		if (!image.imported || image.final_layout == VK_IMAGE_LAYOUT_UNDEFINED || image.final_layout == state.layout) {
+			continue;
+		}
+
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		if (kgraph_layout_access(image.final_layout, &stages, &access) != 0) {
+			stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+		}
+		kgraph_sync(state, i, state.layout, image.final_layout, stages, access, false, graph->final_barriers);
+	}
+}
\ No newline at end of file
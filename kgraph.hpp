@@ -0,0 +1,130 @@
+#ifndef KRISVERS_KGRAPH_HPP
+#define KRISVERS_KGRAPH_HPP
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+/* frame graph: passes declare the images they read and write, compiling culls the passes nothing
+   consumes, picks attachment load and store ops and packs transient images into as few slots as
+   their lifetimes allow. Scheduling then works out the barriers each pass needs from what each image
+   last went through, with synchronization2 stage and access masks so the caller can record a pass's
+   barriers with one vkCmdPipelineBarrier2. It only deals in indices and Vulkan enums, the caller binds
+   images and records. */
+
+#define KGRAPH_NONE 0xFFFFFFFF
+
+enum kgraph_usage_t {
+	KGRAPH_USAGE_COLOR_ATTACHMENT,
+	KGRAPH_USAGE_DEPTH_ATTACHMENT,
+	KGRAPH_USAGE_DEPTH_READ,
+	KGRAPH_USAGE_SAMPLED,
+	KGRAPH_USAGE_STORAGE,
+	KGRAPH_USAGE_TRANSFER_SRC,
+	KGRAPH_USAGE_TRANSFER_DST,
+};
+
+/* what an image last went through: the last write and the stages and accesses it has already been
+   made visible to, and the reads since it that a following write has to wait for */
+struct kgraph_state_t {
+	VkImageLayout layout;
+	VkPipelineStageFlags2 write_stages;
+	VkAccessFlags2 write_access;
+	VkPipelineStageFlags2 read_stages;
+	VkPipelineStageFlags2 visible_stages;
+	VkAccessFlags2 visible_access;
+};
+
+struct kgraph_image_t {
+	VkFormat format;
+	VkExtent2D extent;
+	VkImageAspectFlags aspect;
+
+	/* imported images keep their contents and end up in final_layout, transient ones start undefined
+	   every frame and live in the slot compile gives them */
+	bool imported;
+	VkImageLayout final_layout;
+	VkImageUsageFlags usage;
+	uint32_t slot;
+	uint32_t first_pass;
+	uint32_t last_pass;
+};
+
+struct kgraph_access_t {
+	uint32_t image;
+	kgraph_usage_t usage;
+	bool write;
+	bool clear;
+	VkClearValue clear_value;
+
+	/* filled in by compile, only meaningful for attachments */
+	VkAttachmentLoadOp load_op;
+	VkAttachmentStoreOp store_op;
+};
+
+/* with equal layouts and no access it is only an execution dependency */
+struct kgraph_barrier_t {
+	uint32_t image;
+	VkImageLayout old_layout;
+	VkImageLayout new_layout;
+	VkPipelineStageFlags2 src_stages;
+	VkAccessFlags2 src_access;
+	VkPipelineStageFlags2 dst_stages;
+	VkAccessFlags2 dst_access;
+};
+
+/* barriers is empty when the pass needs no synchronization at all */
+struct kgraph_pass_t {
+	const char * name;
+	bool side_effect;
+	bool culled;
+	std::vector<kgraph_access_t> accesses;
+	std::vector<kgraph_barrier_t> barriers;
+};
+
+/* transient images with the same format and extent whose lifetimes don't overlap share a slot,
+   state is what the caller's image for it went through before and after the graph */
+struct kgraph_slot_t {
+	VkFormat format;
+	VkExtent2D extent;
+	VkImageAspectFlags aspect;
+	VkImageUsageFlags usage;
+	kgraph_state_t state;
+};
+
+struct kgraph_t {
+	std::vector<kgraph_image_t> images;
+	std::vector<kgraph_pass_t> passes;
+	std::vector<kgraph_slot_t> slots;
+
+	/* imported image states, set on import and left as the graph leaves them by schedule */
+	std::vector<kgraph_state_t> states;
+
+	/* after the last pass, moves imported images into their final layouts */
+	std::vector<kgraph_barrier_t> final_barriers;
+};
+
+void kgraph_reset(kgraph_t * graph);
+uint32_t kgraph_import(kgraph_t * graph, VkFormat format, VkExtent2D extent, const kgraph_state_t * state, VkImageLayout final_layout);
+uint32_t kgraph_transient(kgraph_t * graph, VkFormat format, VkExtent2D extent);
+
+/* side effect passes are never culled, the rest only live while something reads what they write.
+   Each image is declared at most once per pass, a write without clear keeps what was there. */
+uint32_t kgraph_pass(kgraph_t * graph, const char * name, bool side_effect);
+void kgraph_read(kgraph_t * graph, uint32_t pass, uint32_t image, kgraph_usage_t usage);
+void kgraph_write(kgraph_t * graph, uint32_t pass, uint32_t image, kgraph_usage_t usage, const VkClearValue * clear);
+
+/* culls, assigns slots and attachment ops. Returns 2 when a transient image is read before anything
+   writes it. The caller then sets every slot's state and calls schedule for the barriers. */
+int kgraph_compile(kgraph_t * graph);
+void kgraph_schedule(kgraph_t * graph);
+
+/* the layout, stages and accesses a usage needs */
+VkImageLayout kgraph_usage_layout(kgraph_usage_t usage);
+void kgraph_usage_access(kgraph_usage_t usage, bool write, VkPipelineStageFlags2 * stages, VkAccessFlags2 * access);
+
+/* the stages and accesses that use an image in a layout, for one-off transitions outside a graph.
+   Returns 1 for layouts without a single obvious use. */
+int kgraph_layout_access(VkImageLayout layout, VkPipelineStageFlags2 * stages, VkAccessFlags2 * access);
+
+#endif
\ No newline at end of file
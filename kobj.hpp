@@ -1,6 +1,7 @@
 #ifndef KRISVERS_KOBJ_HPP
 #define KRISVERS_KOBJ_HPP
 
+#include <cstddef>
 #include <cstdint>
 
 struct kobj_face_t {
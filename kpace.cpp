@@ -0,0 +1,151 @@
+#include "kpace.hpp"
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <time.h>
+#endif
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+int64_t kpace_now_ns(void) {
+#ifdef _WIN32
+	static LARGE_INTEGER freq = {};
+	if (freq.QuadPart == 0) {
+		QueryPerformanceFrequency(&freq);
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	/* split so the multiply can't overflow for counters that have run for a long time */
+	int64_t seconds = counter.QuadPart / freq.QuadPart;
+	int64_t rest = counter.QuadPart % freq.QuadPart;
+	return seconds * 1000000000 + rest * 1000000000 / freq.QuadPart;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* sleeps until about until_ns, never past it by more than the OS's timer resolution */
+static void kpace_sleep_until(kpace_t * pace, int64_t until_ns) {
+#ifdef _WIN32
+	int64_t remaining = until_ns - kpace_now_ns();
+	if (remaining <= 0) {
+		return;
+	}
+
+	if (pace->timer != nullptr) {
+		/* relative due times are negative and in 100ns units */
+		LARGE_INTEGER due;
+		due.QuadPart = -(remaining / 100);
+		if (SetWaitableTimerEx(pace->timer, &due, 0, nullptr, nullptr, nullptr, 0)) {
+			WaitForSingleObject(pace->timer, INFINITE);
+			return;
+		}
+	}
+
+	/* without the high resolution timer Sleep only has whole milliseconds, rounded down so it can't overshoot */
+	DWORD ms = static_cast<DWORD>(remaining / 1000000);
+	if (ms > 0) {
+		Sleep(ms);
+	}
+#else
+	timespec ts = {
+		.tv_sec = static_cast<time_t>(until_ns / 1000000000),
+		.tv_nsec = static_cast<long>(until_ns % 1000000000),
+	};
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+	}
+	(void) pace;
+#endif
+}
+
+int kpace_create(kpace_t * out_pace, double target_fps) {
+	if (out_pace == nullptr) {
+		return 1;
+	}
+
+	out_pace->deadline_ns = 0;
+	out_pace->margin_ns = KPACE_MAX_MARGIN_NS / 2;
+	out_pace->oversleep_ns = 0;
+	out_pace->drift_ns = 0;
+	out_pace->jitter_ns = 0.0;
+	out_pace->frames = 0;
+	out_pace->missed = 0;
+	out_pace->timer = nullptr;
+
+#ifdef _WIN32
+	out_pace->timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+#endif
+
+	return kpace_set_target(out_pace, target_fps);
+}
+
+int kpace_set_target(kpace_t * pace, double target_fps) {
+	if (pace == nullptr || !(target_fps > 0.0)) {
+		return 1;
+	}
+
+	pace->interval_ns = static_cast<int64_t>(1e9 / target_fps);
+	return 0;
+}
+
+void kpace_wait(kpace_t * pace) {
+	int64_t now = kpace_now_ns();
+	if (pace->deadline_ns == 0) {
+		pace->deadline_ns = now + pace->interval_ns;
+		return;
+	}
+
+	if (now < pace->deadline_ns - pace->margin_ns) {
+		int64_t target = pace->deadline_ns - pace->margin_ns;
+		kpace_sleep_until(pace, target);
+
+		/* the margin is twice the usual oversleep, so an unusually late wake still lands before the deadline */
+		int64_t oversleep = kpace_now_ns() - target;
+		if (oversleep < 0) {
+			oversleep = 0;
+		}
+		pace->oversleep_ns += (oversleep - pace->oversleep_ns) / 8;
+		pace->margin_ns = pace->oversleep_ns * 2;
+		if (pace->margin_ns < KPACE_MIN_MARGIN_NS) {
+			pace->margin_ns = KPACE_MIN_MARGIN_NS;
+		}
+		if (pace->margin_ns > KPACE_MAX_MARGIN_NS) {
+			pace->margin_ns = KPACE_MAX_MARGIN_NS;
+		}
+	}
+
+	while ((now = kpace_now_ns()) < pace->deadline_ns) {
+		std::this_thread::yield();
+	}
+
+	pace->drift_ns = now - pace->deadline_ns;
+	pace->jitter_ns += (std::fabs(static_cast<double>(pace->drift_ns)) - pace->jitter_ns) / 16.0;
+	++pace->frames;
+
+	if (pace->drift_ns > pace->interval_ns) {
+		++pace->missed;
+		pace->deadline_ns = now + pace->interval_ns;
+	} else {
+		pace->deadline_ns += pace->interval_ns;
+	}
+}
+
+void kpace_destroy(kpace_t * pace) {
+#ifdef _WIN32
+	if (pace->timer != nullptr) {
+		CloseHandle(pace->timer);
+	}
+#endif
+	pace->timer = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef KRISVERS_KPACE_HPP
+#define KRISVERS_KPACE_HPP
+
+#include <cstdint>
+
+/* frame pacer: sleeps with the finest timer the OS has until a margin before each deadline, then yields
+   the rest of the way. Deadlines step by the interval from the previous one rather than from whenever the
+   frame ended, so small lateness doesn't add up. A frame later than a whole interval starts over from now
+   instead of rushing to catch up. */
+
+/* the margin follows how far past their target the sleeps land, kept within these */
+#define KPACE_MIN_MARGIN_NS 50000
+#define KPACE_MAX_MARGIN_NS 2000000
+
+struct kpace_t {
+	int64_t interval_ns;
+	int64_t deadline_ns;
+	int64_t margin_ns;
+	int64_t oversleep_ns;
+
+	/* drift is how far the last wait returned past its deadline, jitter a moving average of its size */
+	int64_t drift_ns;
+	double jitter_ns;
+	uint64_t frames;
+	uint64_t missed;
+
+	/* high resolution waitable timer on windows, unused elsewhere */
+	void * timer;
+};
+
+int64_t kpace_now_ns(void);
+
+/* returns 1 for a target that isn't positive */
+int kpace_create(kpace_t * out_pace, double target_fps);
+int kpace_set_target(kpace_t * pace, double target_fps);
+
+/* blocks until the next deadline, the first call only starts the schedule */
+void kpace_wait(kpace_t * pace);
+void kpace_destroy(kpace_t * pace);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "kstats.hpp"
+#include <algorithm>
+#include <cmath>
+
+double kstats_percentile(const double * sorted, size_t count, double percentile) {
+	if (sorted == nullptr || count == 0) {
+		return 0.0;
+	}
+
+	size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * static_cast<double>(count)));
+	if (rank == 0) {
+		rank = 1;
+	}
+	if (rank > count) {
+		rank = count;
+	}
+
+	return sorted[rank - 1];
+}
+
+int kstats_summarize(double * samples, size_t count, kstats_summary_t * out_summary) {
+	if (out_summary == nullptr) {
+		return 1;
+	}
+
+	*out_summary = {};
+	if (samples == nullptr || count == 0) {
+		return 1;
+	}
+
+	std::sort(samples, samples + count);
+
+	double sum = 0.0;
+	for (size_t i = 0; i < count; ++i) {
+		sum += samples[i];
+	}
+
+	out_summary->count = count;
+	out_summary->min = samples[0];
+	out_summary->max = samples[count - 1];
+	out_summary->mean = sum / static_cast<double>(count);
+	out_summary->median = kstats_percentile(samples, count, 50.0);
+	out_summary->p95 = kstats_percentile(samples, count, 95.0);
+	out_summary->p99 = kstats_percentile(samples, count, 99.0);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef KRISVERS_KSTATS_HPP
+#define KRISVERS_KSTATS_HPP
+
+#include <cstddef>
+
+/* order statistics over a run of samples, percentiles are nearest rank so every value reported is
+   one that was actually measured */
+struct kstats_summary_t {
+	size_t count;
+	double min;
+	double max;
+	double mean;
+	double median;
+	double p95;
+	double p99;
+};
+
+/* sorts samples in place. Returns 1 when there are none, the summary is zeroed then. */
+int kstats_summarize(double * samples, size_t count, kstats_summary_t * out_summary);
+double kstats_percentile(const double * sorted, size_t count, double percentile);
+
+#endif
\ No newline at end of file
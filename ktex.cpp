@@ -0,0 +1,358 @@
+#include "ktex.hpp"
+#include <cstring>
+#include <new>
+#include <vulkan/vulkan.h>
+
+#define U8(buf, i) (*(((const unsigned char *) buf) + (i)))
+#define U32(buf, i) ((uint32_t) U8(buf, i) | ((uint32_t) U8(buf, (i) + 1) << 8) | ((uint32_t) U8(buf, (i) + 2) << 16) | ((uint32_t) U8(buf, (i) + 3) << 24))
+#define U64(buf, i) ((uint64_t) U32(buf, i) | ((uint64_t) U32(buf, (i) + 4) << 32))
+#define FOURCC(a, b, c, d) ((uint32_t) (a) | ((uint32_t) (b) << 8) | ((uint32_t) (c) << 16) | ((uint32_t) (d) << 24))
+
+static const unsigned char ktx2_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static int ktex_format_block(uint32_t format, uint32_t * block_width, uint32_t * block_height, uint32_t * block_bytes) {
+	*block_width = 1;
+	*block_height = 1;
+
+	switch (format) {
+		case VK_FORMAT_R8_UNORM:
+		case VK_FORMAT_R8_SRGB:
+			*block_bytes = 1;
+			return 0;
+		case VK_FORMAT_R8G8_UNORM:
+		case VK_FORMAT_R16_SFLOAT:
+			*block_bytes = 2;
+			return 0;
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB:
+		case VK_FORMAT_B8G8R8A8_UNORM:
+		case VK_FORMAT_B8G8R8A8_SRGB:
+		case VK_FORMAT_R16G16_SFLOAT:
+		case VK_FORMAT_R32_SFLOAT:
+			*block_bytes = 4;
+			return 0;
+		case VK_FORMAT_R16G16B16A16_SFLOAT:
+		case VK_FORMAT_R32G32_SFLOAT:
+			*block_bytes = 8;
+			return 0;
+		case VK_FORMAT_R32G32B32A32_SFLOAT:
+			*block_bytes = 16;
+			return 0;
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		case VK_FORMAT_BC4_UNORM_BLOCK:
+		case VK_FORMAT_BC4_SNORM_BLOCK:
+			*block_width = 4;
+			*block_height = 4;
+			*block_bytes = 8;
+			return 0;
+		case VK_FORMAT_BC2_UNORM_BLOCK:
+		case VK_FORMAT_BC2_SRGB_BLOCK:
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK:
+		case VK_FORMAT_BC5_UNORM_BLOCK:
+		case VK_FORMAT_BC5_SNORM_BLOCK:
+		case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+		case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK:
+			*block_width = 4;
+			*block_height = 4;
+			*block_bytes = 16;
+			return 0;
+		default:
+			return 1;
+	}
+}
+
+static uint32_t ktex_mip_dimension(uint32_t base, uint32_t level) {
+	uint32_t d = base >> level;
+	return d == 0 ? 1 : d;
+}
+
+/* 0 once the size no longer fits in 64 bits */
+static uint64_t ktex_image_size(const ktex_t * tex, uint32_t level) {
+	uint64_t size = (static_cast<uint64_t>(ktex_mip_dimension(tex->width, level)) + tex->block_width - 1) / tex->block_width;
+	uint64_t factors[3] = {
+		(static_cast<uint64_t>(ktex_mip_dimension(tex->height, level)) + tex->block_height - 1) / tex->block_height,
+		ktex_mip_dimension(tex->depth, level),
+		tex->block_bytes,
+	};
+	for (uint64_t factor : factors) {
+		if (size > UINT64_MAX / factor) {
+			return 0;
+		}
+		size *= factor;
+	}
+	return size;
+}
+
+/* every image of every layer has to fit in the available bytes of the file, which bounds the
+   header's counts before anything is allocated from them, and every offset sum after */
+static int ktex_check_size(ktex_t * tex, uint64_t layers, unsigned long long int available) {
+	if (layers == 0 || layers > UINT32_MAX || layers > available) {
+		return 5;
+	}
+
+	uint64_t total = 0;
+	for (uint32_t level = 0; level < tex->levels; ++level) {
+		uint64_t size = ktex_image_size(tex, level);
+		if (size == 0 || size > available / layers) {
+			return 5;
+		}
+		total += size * layers;
+		if (total > available) {
+			return 5;
+		}
+	}
+
+	tex->layers = static_cast<uint32_t>(layers);
+	return 0;
+}
+
+static int ktex_alloc_images(ktex_t * tex) {
+	tex->images = new (std::nothrow) ktex_image_t[static_cast<size_t>(tex->levels) * tex->layers];
+	if (tex->images == nullptr) {
+		return 3;
+	}
+
+	for (uint32_t level = 0; level < tex->levels; ++level) {
+		for (uint32_t layer = 0; layer < tex->layers; ++layer) {
+			ktex_image_t & image = tex->images[level * tex->layers + layer];
+			image.level = level;
+			image.layer = layer;
+			image.width = ktex_mip_dimension(tex->width, level);
+			image.height = ktex_mip_dimension(tex->height, level);
+			image.depth = ktex_mip_dimension(tex->depth, level);
+			image.offset = 0;
+			image.size = ktex_image_size(tex, level);
+		}
+	}
+
+	return 0;
+}
+
+int ktex_load(ktex_t * out_tex, const void * buffer, unsigned long long int buffer_length) {
+	if (buffer == nullptr || buffer_length < 12) {
+		return 1;
+	}
+
+	if (memcmp(buffer, ktx2_identifier, sizeof(ktx2_identifier)) == 0) {
+		return ktex_load_ktx2(out_tex, buffer, buffer_length);
+	}
+
+	if (U32(buffer, 0) == FOURCC('D', 'D', 'S', ' ')) {
+		return ktex_load_dds(out_tex, buffer, buffer_length);
+	}
+
+	return 2;
+}
+
+int ktex_load_ktx2(ktex_t * out_tex, const void * buffer, unsigned long long int buffer_length) {
+	if (buffer == nullptr || buffer_length < 80) {
+		return 1;
+	}
+
+	const unsigned char * buf = reinterpret_cast<const unsigned char *>(buffer);
+	if (memcmp(buf, ktx2_identifier, sizeof(ktx2_identifier)) != 0) {
+		return 2;
+	}
+
+	memset(out_tex, 0, sizeof(*out_tex));
+	out_tex->vk_format = U32(buf, 12);
+	out_tex->width = U32(buf, 20);
+	out_tex->height = U32(buf, 24);
+	out_tex->depth = U32(buf, 28);
+	uint32_t layer_count = U32(buf, 32);
+	out_tex->faces = U32(buf, 36);
+	out_tex->levels = U32(buf, 40);
+	uint32_t supercompression = U32(buf, 44);
+
+	/* basis/zstd payloads would need a transcoder, which defeats the point of a GPU-native container */
+	if (supercompression != 0 || out_tex->vk_format == VK_FORMAT_UNDEFINED) {
+		return 4;
+	}
+
+	if (ktex_format_block(out_tex->vk_format, &out_tex->block_width, &out_tex->block_height, &out_tex->block_bytes) != 0) {
+		return 4;
+	}
+
+	/* zero means "not an array" / "generate mips at load time", both of which are one level here */
+	out_tex->height = out_tex->height == 0 ? 1 : out_tex->height;
+	out_tex->depth = out_tex->depth == 0 ? 1 : out_tex->depth;
+	out_tex->faces = out_tex->faces == 0 ? 1 : out_tex->faces;
+	out_tex->levels = out_tex->levels == 0 ? 1 : out_tex->levels;
+	uint64_t layers = static_cast<uint64_t>(layer_count == 0 ? 1 : layer_count) * out_tex->faces;
+
+	unsigned long long int index_end = 80 + static_cast<unsigned long long int>(out_tex->levels) * 24;
+	if (out_tex->width == 0 || out_tex->levels > 32 || index_end > buffer_length) {
+		return 5;
+	}
+
+	int ret = ktex_check_size(out_tex, layers, buffer_length - index_end);
+	if (ret != 0) {
+		return ret;
+	}
+
+	ret = ktex_alloc_images(out_tex);
+	if (ret != 0) {
+		return ret;
+	}
+
+	for (uint32_t level = 0; level < out_tex->levels; ++level) {
+		uint64_t byte_offset = U64(buf, 80 + level * 24);
+		uint64_t byte_length = U64(buf, 80 + level * 24 + 8);
+		uint64_t image_size = out_tex->images[level * out_tex->layers].size;
+
+		/* image_size * layers is bounded by ktex_check_size, the range is checked without summing header values */
+		if (byte_offset > buffer_length || byte_length > buffer_length - byte_offset || image_size > byte_length / out_tex->layers) {
+			ktex_destroy(out_tex);
+			return 5;
+		}
+
+		/* a level stores every layer (and every face within it) back to back */
+		for (uint32_t layer = 0; layer < out_tex->layers; ++layer) {
+			out_tex->images[level * out_tex->layers + layer].offset = byte_offset + layer * image_size;
+		}
+	}
+
+	out_tex->data = buf;
+	out_tex->data_length = buffer_length;
+
+	return 0;
+}
+
+static uint32_t ktex_dxgi_format(uint32_t dxgi) {
+	switch (dxgi) {
+		case 2: return VK_FORMAT_R32G32B32A32_SFLOAT;
+		case 10: return VK_FORMAT_R16G16B16A16_SFLOAT;
+		case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+		case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+		case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+		case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+		case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+		case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+		case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+		case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+		case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+		case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+		case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+		case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+		case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+		case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+		case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+		case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+		case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+		default: return VK_FORMAT_UNDEFINED;
+	}
+}
+
+int ktex_load_dds(ktex_t * out_tex, const void * buffer, unsigned long long int buffer_length) {
+	if (buffer == nullptr || buffer_length < 128) {
+		return 1;
+	}
+
+	const unsigned char * buf = reinterpret_cast<const unsigned char *>(buffer);
+	if (U32(buf, 0) != FOURCC('D', 'D', 'S', ' ') || U32(buf, 4) != 124) {
+		return 2;
+	}
+
+	memset(out_tex, 0, sizeof(*out_tex));
+	uint32_t flags = U32(buf, 8);
+	out_tex->height = U32(buf, 12);
+	out_tex->width = U32(buf, 16);
+	out_tex->depth = (flags & 0x800000) ? U32(buf, 24) : 1;
+	out_tex->levels = (flags & 0x20000) ? U32(buf, 28) : 1;
+
+	uint32_t pf_flags = U32(buf, 80);
+	uint32_t fourcc = U32(buf, 84);
+	uint32_t caps2 = U32(buf, 112);
+	uint32_t layer_count = 1;
+	unsigned long long int data_offset = 128;
+
+	out_tex->faces = (caps2 & 0x200) ? 6 : 1;
+	out_tex->vk_format = VK_FORMAT_UNDEFINED;
+
+	if ((pf_flags & 0x4) && fourcc == FOURCC('D', 'X', '1', '0')) {
+		if (buffer_length < 148) {
+			return 5;
+		}
+
+		out_tex->vk_format = ktex_dxgi_format(U32(buf, 128));
+		layer_count = U32(buf, 140);
+		out_tex->faces = (U32(buf, 136) & 0x4) ? 6 : 1;
+		data_offset = 148;
+	} else if (pf_flags & 0x4) {
+		switch (fourcc) {
+			case FOURCC('D', 'X', 'T', '1'): out_tex->vk_format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK; break;
+			case FOURCC('D', 'X', 'T', '2'):
+			case FOURCC('D', 'X', 'T', '3'): out_tex->vk_format = VK_FORMAT_BC2_UNORM_BLOCK; break;
+			case FOURCC('D', 'X', 'T', '4'):
+			case FOURCC('D', 'X', 'T', '5'): out_tex->vk_format = VK_FORMAT_BC3_UNORM_BLOCK; break;
+			case FOURCC('A', 'T', 'I', '1'):
+			case FOURCC('B', 'C', '4', 'U'): out_tex->vk_format = VK_FORMAT_BC4_UNORM_BLOCK; break;
+			case FOURCC('B', 'C', '4', 'S'): out_tex->vk_format = VK_FORMAT_BC4_SNORM_BLOCK; break;
+			case FOURCC('A', 'T', 'I', '2'):
+			case FOURCC('B', 'C', '5', 'U'): out_tex->vk_format = VK_FORMAT_BC5_UNORM_BLOCK; break;
+			case FOURCC('B', 'C', '5', 'S'): out_tex->vk_format = VK_FORMAT_BC5_SNORM_BLOCK; break;
+			default: break;
+		}
+	} else if ((pf_flags & 0x40) && U32(buf, 88) == 32) {
+		/* DDPF_RGB, masks decide the channel order */
+		if (U32(buf, 92) == 0x00ff0000 && U32(buf, 100) == 0x000000ff) {
+			out_tex->vk_format = VK_FORMAT_B8G8R8A8_UNORM;
+		} else if (U32(buf, 92) == 0x000000ff && U32(buf, 100) == 0x00ff0000) {
+			out_tex->vk_format = VK_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	if (out_tex->vk_format == VK_FORMAT_UNDEFINED || ktex_format_block(out_tex->vk_format, &out_tex->block_width, &out_tex->block_height, &out_tex->block_bytes) != 0) {
+		return 4;
+	}
+
+	out_tex->height = out_tex->height == 0 ? 1 : out_tex->height;
+	out_tex->depth = out_tex->depth == 0 ? 1 : out_tex->depth;
+	out_tex->levels = out_tex->levels == 0 ? 1 : out_tex->levels;
+	uint64_t layers = static_cast<uint64_t>(layer_count == 0 ? 1 : layer_count) * out_tex->faces;
+
+	if (out_tex->width == 0 || out_tex->levels > 32) {
+		return 5;
+	}
+
+	int ret = ktex_check_size(out_tex, layers, buffer_length - data_offset);
+	if (ret != 0) {
+		return ret;
+	}
+
+	ret = ktex_alloc_images(out_tex);
+	if (ret != 0) {
+		return ret;
+	}
+
+	/* unlike KTX2, DDS stores every layer's full mip chain back to back */
+	unsigned long long int cursor = data_offset;
+	for (uint32_t layer = 0; layer < out_tex->layers; ++layer) {
+		for (uint32_t level = 0; level < out_tex->levels; ++level) {
+			ktex_image_t & image = out_tex->images[level * out_tex->layers + layer];
+			if (image.size > buffer_length - cursor) {
+				ktex_destroy(out_tex);
+				return 5;
+			}
+			image.offset = cursor;
+			cursor += image.size;
+		}
+	}
+
+	out_tex->data = buf;
+	out_tex->data_length = buffer_length;
+
+	return 0;
+}
+
+void ktex_destroy(ktex_t * tex) {
+	delete[] tex->images;
+	tex->images = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#ifndef KRISVERS_KTEX_HPP
+#define KRISVERS_KTEX_HPP
+
+#include <cstdint>
+
+/* one mip level of one array layer (cube faces count as layers) */
+struct ktex_image_t {
+	uint32_t level;
+	uint32_t layer;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct ktex_t {
+	uint32_t vk_format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;
+	uint32_t levels;
+	uint32_t layers;
+	uint32_t faces;
+	uint32_t block_width;
+	uint32_t block_height;
+	uint32_t block_bytes;
+
+	/* levels * layers entries, images[level * layers + layer] */
+	ktex_image_t * images;
+
+	/* not owned, points into the buffer given to ktex_load */
+	const unsigned char * data;
+	unsigned long long int data_length;
+};
+
+int ktex_load(ktex_t * out_tex, const void * buffer, unsigned long long int buffer_length);
+int ktex_load_ktx2(ktex_t * out_tex, const void * buffer, unsigned long long int buffer_length);
+int ktex_load_dds(ktex_t * out_tex, const void * buffer, unsigned long long int buffer_length);
+void ktex_destroy(ktex_t * tex);
+
+#endif
\ No newline at end of file
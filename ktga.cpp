@@ -39,6 +39,30 @@ int ktga_load(ktga_t * out_tga, void * buffer, unsigned long long int buffer_len
 	return 0;
 }
 
+int ktga_save(const ktga_t * tga, void * buffer, unsigned long long int buffer_length) {
+	if (tga == nullptr || buffer == nullptr || tga->header.img_type != 2) {
+		return 1;
+	}
+
+	unsigned long long int size = static_cast<unsigned long long int>(tga->header.img_w) * tga->header.img_h * (tga->header.bpp / 8);
+	if (buffer_length < 18 + size) {
+		return 1;
+	}
+
+	unsigned char * buf = (unsigned char *) buffer;
+	memset(buf, 0, 18);
+	U8(buf, 2) = tga->header.img_type;
+	U8(buf, 12) = tga->header.img_w & 0xFF;
+	U8(buf, 13) = tga->header.img_w >> 8;
+	U8(buf, 14) = tga->header.img_h & 0xFF;
+	U8(buf, 15) = tga->header.img_h >> 8;
+	U8(buf, 16) = tga->header.bpp;
+	U8(buf, 17) = tga->header.img_desc;
+	memcpy(&buf[18], tga->bitmap, size);
+
+	return 0;
+}
+
 void ktga_destroy(ktga_t * tga) {
 	delete tga->bitmap;
 }
\ No newline at end of file
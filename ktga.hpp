@@ -22,6 +22,8 @@ struct ktga_t {
 };
 
 int ktga_load(ktga_t * out_tga, void * buffer, unsigned long long int buffer_length);
+/* uncompressed true color only, buffer needs 18 + img_w * img_h * bpp / 8 bytes */
+int ktga_save(const ktga_t * tga, void * buffer, unsigned long long int buffer_length);
 void ktga_destroy(ktga_t * tga);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,216 @@
+#include "ktransform.hpp"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+int ktransform_soa_create(ktransform_soa_t * out_soa, uint32_t count) {
+	if (out_soa == nullptr || count == 0) {
+		return 1;
+	}
+
+	out_soa->data = new float[static_cast<size_t>(count) * 10];
+	out_soa->touched = new uint32_t[count];
+	out_soa->touched_flags = new unsigned char[count];
+	if (out_soa->data == nullptr || out_soa->touched == nullptr || out_soa->touched_flags == nullptr) {
+		return 3;
+	}
+
+	out_soa->count = count;
+	for (uint32_t i = 0; i < 3; ++i) {
+		out_soa->position[i] = out_soa->data + static_cast<size_t>(count) * i;
+		out_soa->scale[i] = out_soa->data + static_cast<size_t>(count) * (3 + i);
+	}
+	for (uint32_t i = 0; i < 4; ++i) {
+		out_soa->rotation[i] = out_soa->data + static_cast<size_t>(count) * (6 + i);
+	}
+
+	/* zero position, unit scale, identity rotation */
+	for (uint32_t i = 0; i < count; ++i) {
+		out_soa->position[0][i] = out_soa->position[1][i] = out_soa->position[2][i] = 0.0f;
+		out_soa->scale[0][i] = out_soa->scale[1][i] = out_soa->scale[2][i] = 1.0f;
+		out_soa->rotation[0][i] = out_soa->rotation[1][i] = out_soa->rotation[2][i] = 0.0f;
+		out_soa->rotation[3][i] = 1.0f;
+		out_soa->touched[i] = i;
+		out_soa->touched_flags[i] = 1;
+	}
+	out_soa->touched_count = count;
+
+	return 0;
+}
+
+void ktransform_soa_set(ktransform_soa_t * soa, uint32_t index, const float position[3], const float rotation[4], const float scale[3]) {
+	for (uint32_t i = 0; i < 3; ++i) {
+		soa->position[i][index] = position[i];
+		soa->scale[i][index] = scale[i];
+	}
+	for (uint32_t i = 0; i < 4; ++i) {
+		soa->rotation[i][index] = rotation[i];
+	}
+	ktransform_soa_touch(soa, index);
+}
+
+void ktransform_soa_touch(ktransform_soa_t * soa, uint32_t index) {
+	if (soa->touched_flags[index] == 0) {
+		soa->touched_flags[index] = 1;
+		soa->touched[soa->touched_count++] = index;
+	}
+}
+
+void ktransform_soa_destroy(ktransform_soa_t * soa) {
+	delete[] soa->data;
+	delete[] soa->touched;
+	delete[] soa->touched_flags;
+	memset(soa, 0, sizeof(*soa));
+}
+
+static void ktransform_build_one(const ktransform_soa_t * soa, uint32_t i, mat4x4 model) {
+	vec3 t = { soa->position[0][i], soa->position[1][i], soa->position[2][i] };
+	quat q = { soa->rotation[0][i], soa->rotation[1][i], soa->rotation[2][i], soa->rotation[3][i] };
+	vec3 s = { soa->scale[0][i], soa->scale[1][i], soa->scale[2][i] };
+	mat4x4_from_trs(model, t, q, s);
+}
+
+#ifdef LINMATH_SSE
+/* four transforms at once, every matrix element is a register holding it for all four,
+   same terms as mat4x4_from_quat */
+static void ktransform_build_sse(const ktransform_soa_t * soa, uint32_t i, mat4x4 * models) {
+	__m128 b = _mm_loadu_ps(soa->rotation[0] + i);
+	__m128 c = _mm_loadu_ps(soa->rotation[1] + i);
+	__m128 d = _mm_loadu_ps(soa->rotation[2] + i);
+	__m128 a = _mm_loadu_ps(soa->rotation[3] + i);
+	__m128 kx = _mm_loadu_ps(soa->scale[0] + i);
+	__m128 ky = _mm_loadu_ps(soa->scale[1] + i);
+	__m128 kz = _mm_loadu_ps(soa->scale[2] + i);
+
+	__m128 a2 = _mm_mul_ps(a, a);
+	__m128 b2 = _mm_mul_ps(b, b);
+	__m128 c2 = _mm_mul_ps(c, c);
+	__m128 d2 = _mm_mul_ps(d, d);
+	__m128 bc = _mm_mul_ps(b, c);
+	__m128 ad = _mm_mul_ps(a, d);
+	__m128 bd = _mm_mul_ps(b, d);
+	__m128 ac = _mm_mul_ps(a, c);
+	__m128 cd = _mm_mul_ps(c, d);
+	__m128 ab = _mm_mul_ps(a, b);
+	__m128 two = _mm_set1_ps(2.0f);
+	__m128 zero = _mm_setzero_ps();
+
+	__m128 m[4][4];
+	m[0][0] = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_add_ps(a2, b2), c2), d2), kx);
+	m[0][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(bc, ad)), kx);
+	m[0][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(bd, ac)), kx);
+	m[0][3] = zero;
+
+	m[1][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(bc, ad)), ky);
+	m[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_sub_ps(a2, b2), c2), d2), ky);
+	m[1][2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(cd, ab)), ky);
+	m[1][3] = zero;
+
+	m[2][0] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(bd, ac)), kz);
+	m[2][1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(cd, ab)), kz);
+	m[2][2] = _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_sub_ps(a2, b2), c2), d2), kz);
+	m[2][3] = zero;
+
+	m[3][0] = _mm_loadu_ps(soa->position[0] + i);
+	m[3][1] = _mm_loadu_ps(soa->position[1] + i);
+	m[3][2] = _mm_loadu_ps(soa->position[2] + i);
+	m[3][3] = _mm_set1_ps(1.0f);
+
+	for (uint32_t col = 0; col < 4; ++col) {
+		_MM_TRANSPOSE4_PS(m[col][0], m[col][1], m[col][2], m[col][3]);
+		for (uint32_t k = 0; k < 4; ++k) {
+			_mm_storeu_ps(models[k][col], m[col][k]);
+		}
+	}
+}
+#endif
+
+static void ktransform_build_range(const ktransform_soa_t * soa, uint32_t first, uint32_t last, mat4x4 * models, mat4x4 const view_proj, mat4x4 * mvps) {
+	uint32_t i = first;
+#ifdef LINMATH_SSE
+	for (; i + 4 <= last; i += 4) {
+		ktransform_build_sse(soa, i, models + (i - first));
+	}
+#endif
+	for (; i < last; ++i) {
+		ktransform_build_one(soa, i, models[i - first]);
+	}
+
+	if (mvps != nullptr) {
+		for (i = first; i < last; ++i) {
+			mat4x4_mul(mvps[i - first], view_proj, models[i - first]);
+		}
+	}
+}
+
+void ktransform_build(const ktransform_soa_t * soa, uint32_t first, uint32_t count, mat4x4 * models, mat4x4 const view_proj, mat4x4 * mvps, uint32_t thread_count) {
+	if (soa == nullptr || models == nullptr || count == 0 || count > soa->count || first > soa->count - count || (mvps != nullptr && view_proj == nullptr)) {
+		return;
+	}
+
+	uint32_t max_threads = (count + KTRANSFORM_MIN_CHUNK - 1) / KTRANSFORM_MIN_CHUNK;
+	if (thread_count > max_threads) {
+		thread_count = max_threads;
+	}
+
+	if (thread_count <= 1) {
+		ktransform_build_range(soa, first, first + count, models, view_proj, mvps);
+		return;
+	}
+
+	/* chunks stay multiples of 4 so only the last one has a scalar tail */
+	uint32_t chunk = ((count + thread_count - 1) / thread_count + 3) & ~3u;
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count - 1);
+
+	uint32_t begin = first;
+	for (uint32_t t = 0; t + 1 < thread_count && begin + chunk < first + count; ++t) {
+		uint32_t offset = begin - first;
+		threads.emplace_back(ktransform_build_range, soa, begin, begin + chunk, models + offset, view_proj, mvps != nullptr ? mvps + offset : nullptr);
+		begin += chunk;
+	}
+
+	uint32_t offset = begin - first;
+	ktransform_build_range(soa, begin, first + count, models + offset, view_proj, mvps != nullptr ? mvps + offset : nullptr);
+
+	for (std::thread & thread : threads) {
+		thread.join();
+	}
+}
+
+uint32_t ktransform_build_touched(ktransform_soa_t * soa, mat4x4 * models, uint32_t * out_slots, uint32_t thread_count) {
+	if (soa == nullptr || models == nullptr || out_slots == nullptr || soa->touched_count == 0) {
+		return 0;
+	}
+
+	/* when most slots moved one pass over the flags lists them in order, sorting a few is cheaper otherwise */
+	uint32_t count = soa->touched_count;
+	if (count > soa->count / 8) {
+		count = 0;
+		for (uint32_t i = 0; i < soa->count; ++i) {
+			if (soa->touched_flags[i] != 0) {
+				out_slots[count++] = i;
+			}
+		}
+	} else {
+		memcpy(out_slots, soa->touched, sizeof(uint32_t) * count);
+		std::sort(out_slots, out_slots + count);
+	}
+
+	for (uint32_t i = 0; i < count; ++i) {
+		soa->touched_flags[out_slots[i]] = 0;
+	}
+	soa->touched_count = 0;
+
+	uint32_t run = 0;
+	for (uint32_t i = 1; i <= count; ++i) {
+		if (i == count || out_slots[i] != out_slots[i - 1] + 1) {
+			uint32_t first = out_slots[run];
+			ktransform_build(soa, first, i - run, models + first, nullptr, nullptr, thread_count);
+			run = i;
+		}
+	}
+
+	return count;
+}
\ No newline at end of file
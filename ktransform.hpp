@@ -0,0 +1,42 @@
+#ifndef KRISVERS_KTRANSFORM_HPP
+#define KRISVERS_KTRANSFORM_HPP
+
+#include <cstdint>
+#include "linmath.h"
+
+/* transforms stored as one array per component so four of them fill a SIMD register,
+   rotation is a unit quaternion (x, y, z, w) and model = T * R * S. This is transform_t's
+   layout split into columns, Euler angles go through quat_from_euler before they get here. */
+struct ktransform_soa_t {
+	uint32_t count;
+	float * position[3];
+	float * rotation[4];
+	float * scale[3];
+	float * data;
+
+	/* slots changed since the last ktransform_build_touched, each listed once. A new soa starts
+	   with every slot touched. */
+	uint32_t * touched;
+	uint32_t touched_count;
+	unsigned char * touched_flags;
+};
+
+/* below this many transforms per thread the spawn cost outweighs the work */
+#define KTRANSFORM_MIN_CHUNK 8192
+
+int ktransform_soa_create(ktransform_soa_t * out_soa, uint32_t count);
+void ktransform_soa_set(ktransform_soa_t * soa, uint32_t index, const float position[3], const float rotation[4], const float scale[3]);
+/* marks a slot written through the arrays directly, ktransform_soa_set does it itself */
+void ktransform_soa_touch(ktransform_soa_t * soa, uint32_t index);
+void ktransform_soa_destroy(ktransform_soa_t * soa);
+
+/* models[i] = T * R * S for transforms [first, first + count), and mvps[i] = view_proj * models[i]
+   when mvps is not null. Work is split across up to thread_count threads, the caller included. */
+void ktransform_build(const ktransform_soa_t * soa, uint32_t first, uint32_t count, mat4x4 * models, mat4x4 const view_proj, mat4x4 * mvps, uint32_t thread_count);
+
+/* models[i] for just the slots touched since the last call, so the work follows how many moved rather than
+   soa->count. Runs of consecutive slots still go through ktransform_build together. The rebuilt slots are
+   written in order to out_slots, which needs room for soa->count, and their count is returned. */
+uint32_t ktransform_build_touched(ktransform_soa_t * soa, mat4x4 * models, uint32_t * out_slots, uint32_t thread_count);
+
+#endif
\ No newline at end of file
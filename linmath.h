@@ -11,6 +11,22 @@
 #define LINMATH_H_FUNC static inline
 #endif
 
+/* SIMD paths for the mat4x4 hot functions, picked from what the compiler targets.
+   Define LINMATH_NO_SIMD to force the scalar code. */
+#ifndef LINMATH_NO_SIMD
+#if defined(__AVX__)
+#define LINMATH_AVX
+#define LINMATH_SSE
+#include <immintrin.h>
+#elif defined(__SSE__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define LINMATH_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define LINMATH_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
 #define LINMATH_H_DEFINE_VEC(n) \
 typedef float vec##n[n]; \
 LINMATH_H_FUNC void vec##n##_add(vec##n r, vec##n const a, vec##n const b) \
@@ -150,6 +166,57 @@ LINMATH_H_FUNC void mat4x4_scale_aniso(mat4x4 M, mat4x4 const a, float x, float
 	vec4_dup(M[3], a[3]);
 }
 LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b) {
+	/* every path sums k = 0..3 in order, M may alias a or b */
+#if defined(LINMATH_AVX)
+	__m256 a0 = _mm256_broadcast_ps((__m128 const *)a[0]);
+	__m256 a1 = _mm256_broadcast_ps((__m128 const *)a[1]);
+	__m256 a2 = _mm256_broadcast_ps((__m128 const *)a[2]);
+	__m256 a3 = _mm256_broadcast_ps((__m128 const *)a[3]);
+	__m256 b01 = _mm256_loadu_ps(b[0]);
+	__m256 b23 = _mm256_loadu_ps(b[2]);
+	__m256 r01 = _mm256_mul_ps(a0, _mm256_permute_ps(b01, 0x00));
+	__m256 r23 = _mm256_mul_ps(a0, _mm256_permute_ps(b23, 0x00));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a1, _mm256_permute_ps(b01, 0x55)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a1, _mm256_permute_ps(b23, 0x55)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a2, _mm256_permute_ps(b01, 0xAA)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a2, _mm256_permute_ps(b23, 0xAA)));
+	r01 = _mm256_add_ps(r01, _mm256_mul_ps(a3, _mm256_permute_ps(b01, 0xFF)));
+	r23 = _mm256_add_ps(r23, _mm256_mul_ps(a3, _mm256_permute_ps(b23, 0xFF)));
+	_mm256_storeu_ps(M[0], r01);
+	_mm256_storeu_ps(M[2], r23);
+#elif defined(LINMATH_SSE)
+	__m128 a0 = _mm_loadu_ps(a[0]);
+	__m128 a1 = _mm_loadu_ps(a[1]);
+	__m128 a2 = _mm_loadu_ps(a[2]);
+	__m128 a3 = _mm_loadu_ps(a[3]);
+	__m128 r[4];
+	int c;
+	for (c = 0; c < 4; ++c) {
+		__m128 bc = _mm_loadu_ps(b[c]);
+		r[c] = _mm_mul_ps(a0, _mm_shuffle_ps(bc, bc, 0x00));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a1, _mm_shuffle_ps(bc, bc, 0x55)));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a2, _mm_shuffle_ps(bc, bc, 0xAA)));
+		r[c] = _mm_add_ps(r[c], _mm_mul_ps(a3, _mm_shuffle_ps(bc, bc, 0xFF)));
+	}
+	for (c = 0; c < 4; ++c)
+		_mm_storeu_ps(M[c], r[c]);
+#elif defined(LINMATH_NEON)
+	float32x4_t a0 = vld1q_f32(a[0]);
+	float32x4_t a1 = vld1q_f32(a[1]);
+	float32x4_t a2 = vld1q_f32(a[2]);
+	float32x4_t a3 = vld1q_f32(a[3]);
+	float32x4_t r[4];
+	int c;
+	for (c = 0; c < 4; ++c) {
+		/* separate mul and add, vmlaq may be fused on AArch64 */
+		r[c] = vmulq_n_f32(a0, b[c][0]);
+		r[c] = vaddq_f32(r[c], vmulq_n_f32(a1, b[c][1]));
+		r[c] = vaddq_f32(r[c], vmulq_n_f32(a2, b[c][2]));
+		r[c] = vaddq_f32(r[c], vmulq_n_f32(a3, b[c][3]));
+	}
+	for (c = 0; c < 4; ++c)
+		vst1q_f32(M[c], r[c]);
+#else
 	mat4x4 temp;
 	int k, r, c;
 	for (c = 0; c < 4; ++c) for (r = 0; r < 4; ++r) {
@@ -158,14 +225,54 @@ LINMATH_H_FUNC void mat4x4_mul(mat4x4 M, mat4x4 const a, mat4x4 const b) {
 			temp[c][r] += a[k][r] * b[c][k];
 	}
 	mat4x4_dup(M, temp);
+#endif
 }
 LINMATH_H_FUNC void mat4x4_mul_vec4(vec4 r, mat4x4 const M, vec4 const v) {
+#if defined(LINMATH_SSE)
+	__m128 x = _mm_loadu_ps(v);
+	__m128 t = _mm_mul_ps(_mm_loadu_ps(M[0]), _mm_shuffle_ps(x, x, 0x00));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(M[1]), _mm_shuffle_ps(x, x, 0x55)));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(M[2]), _mm_shuffle_ps(x, x, 0xAA)));
+	t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(M[3]), _mm_shuffle_ps(x, x, 0xFF)));
+	_mm_storeu_ps(r, t);
+#elif defined(LINMATH_NEON)
+	float x0 = v[0], x1 = v[1], x2 = v[2], x3 = v[3];
+	float32x4_t t = vmulq_n_f32(vld1q_f32(M[0]), x0);
+	t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(M[1]), x1));
+	t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(M[2]), x2));
+	t = vaddq_f32(t, vmulq_n_f32(vld1q_f32(M[3]), x3));
+	vst1q_f32(r, t);
+#else
 	int i, j;
 	for (j = 0; j < 4; ++j) {
 		r[j] = 0.f;
 		for (i = 0; i < 4; ++i)
 			r[j] += M[i][j] * v[i];
 	}
+#endif
+}
+/* r[i] = M * v[i] for count vectors, r may be v */
+LINMATH_H_FUNC void mat4x4_mul_vec4_batch(vec4 * r, mat4x4 const M, vec4 const * v, int count) {
+	int i = 0;
+#if defined(LINMATH_AVX)
+	__m256 m0 = _mm256_broadcast_ps((__m128 const *)M[0]);
+	__m256 m1 = _mm256_broadcast_ps((__m128 const *)M[1]);
+	__m256 m2 = _mm256_broadcast_ps((__m128 const *)M[2]);
+	__m256 m3 = _mm256_broadcast_ps((__m128 const *)M[3]);
+	for (; i + 2 <= count; i += 2) {
+		__m256 x = _mm256_loadu_ps(v[i]);
+		__m256 t = _mm256_mul_ps(m0, _mm256_permute_ps(x, 0x00));
+		t = _mm256_add_ps(t, _mm256_mul_ps(m1, _mm256_permute_ps(x, 0x55)));
+		t = _mm256_add_ps(t, _mm256_mul_ps(m2, _mm256_permute_ps(x, 0xAA)));
+		t = _mm256_add_ps(t, _mm256_mul_ps(m3, _mm256_permute_ps(x, 0xFF)));
+		_mm256_storeu_ps(r[i], t);
+	}
+#endif
+	for (; i < count; ++i) {
+		vec4 t;
+		vec4_dup(t, v[i]);
+		mat4x4_mul_vec4(r[i], M, t);
+	}
 }
 LINMATH_H_FUNC void mat4x4_translate(mat4x4 T, float x, float y, float z) {
 	mat4x4_identity(T);
@@ -195,6 +302,26 @@ LINMATH_H_FUNC void mat4x4_rotate(mat4x4 R, mat4x4 const M, float x, float y, fl
 	if (vec3_len(u) > 1e-4) {
 		vec3_norm(u, u);
 		mat4x4 T;
+#if defined(LINMATH_SSE)
+		/* column i = (u * u[i] + (e[i] - u * u[i]) * c) + S[i] * s, same rounding as below */
+		__m128 uv = _mm_setr_ps(u[0], u[1], u[2], 0.f);
+		__m128 cv = _mm_set1_ps(c);
+		__m128 sv = _mm_set1_ps(s);
+		__m128 Sv[3] = {
+			_mm_setr_ps(0.f, u[2], -u[1], 0.f),
+			_mm_setr_ps(-u[2], 0.f, u[0], 0.f),
+			_mm_setr_ps(u[1], -u[0], 0.f, 0.f)
+		};
+		int i;
+		for (i = 0; i < 3; ++i) {
+			__m128 t = _mm_mul_ps(uv, _mm_set1_ps(u[i]));
+			__m128 e = _mm_setr_ps(i == 0 ? 1.f : 0.f, i == 1 ? 1.f : 0.f, i == 2 ? 1.f : 0.f, 0.f);
+			__m128 col = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(e, t), cv));
+			_mm_storeu_ps(T[i], _mm_add_ps(col, _mm_mul_ps(Sv[i], sv)));
+		}
+		_mm_storeu_ps(T[3], _mm_setr_ps(0.f, 0.f, 0.f, 1.f));
+		mat4x4_mul(R, M, T);
+#else
 		mat4x4_from_vec3_mul_outer(T, u, u);
 
 		mat4x4 S = {
@@ -216,6 +343,7 @@ LINMATH_H_FUNC void mat4x4_rotate(mat4x4 R, mat4x4 const M, float x, float y, fl
 
 		T[3][3] = 1.f;
 		mat4x4_mul(R, M, T);
+#endif
 	} else {
 		mat4x4_dup(R, M);
 	}
@@ -254,6 +382,54 @@ LINMATH_H_FUNC void mat4x4_rotate_Z(mat4x4 Q, mat4x4 const M, float angle) {
 	mat4x4_mul(Q, M, R);
 }
 LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M) {
+	/* column i of T is a signed sum of the rows of M swizzled to x[k] = (M[1][k], M[0][k], M[3][k], M[2][k])
+	   weighted by (c, c, s, s) minor pairs, the SIMD paths keep the scalar evaluation order */
+#if defined(LINMATH_SSE)
+	__m128 m0 = _mm_loadu_ps(M[0]);
+	__m128 m1 = _mm_loadu_ps(M[1]);
+	__m128 m2 = _mm_loadu_ps(M[2]);
+	__m128 m3 = _mm_loadu_ps(M[3]);
+
+	/* s[0..3], s[4..5] from columns 0 and 1, c[] likewise from columns 2 and 3 */
+	__m128 s03 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(m0, m0, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(m1, m1, _MM_SHUFFLE(2, 3, 2, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(m1, m1, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 3, 2, 1))));
+	__m128 s45 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 1, 2, 1)), _mm_shuffle_ps(m1, m1, _MM_SHUFFLE(3, 3, 3, 3))),
+		_mm_mul_ps(_mm_shuffle_ps(m1, m1, _MM_SHUFFLE(2, 1, 2, 1)), _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(3, 3, 3, 3))));
+	__m128 c03 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(m2, m2, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(m3, m3, _MM_SHUFFLE(2, 3, 2, 1))),
+		_mm_mul_ps(_mm_shuffle_ps(m3, m3, _MM_SHUFFLE(1, 0, 0, 0)), _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(2, 3, 2, 1))));
+	__m128 c45 = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(m2, m2, _MM_SHUFFLE(2, 1, 2, 1)), _mm_shuffle_ps(m3, m3, _MM_SHUFFLE(3, 3, 3, 3))),
+		_mm_mul_ps(_mm_shuffle_ps(m3, m3, _MM_SHUFFLE(2, 1, 2, 1)), _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(3, 3, 3, 3))));
+
+	float s[8];
+	float c[8];
+	_mm_storeu_ps(s, s03);
+	_mm_storeu_ps(s + 4, s45);
+	_mm_storeu_ps(c, c03);
+	_mm_storeu_ps(c + 4, c45);
+
+	/* Assumes it is invertible */
+	float idet = 1.0f / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0]);
+
+	__m128 w0 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 w1 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(1, 1, 1, 1));
+	__m128 w2 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(2, 2, 2, 2));
+	__m128 w3 = _mm_shuffle_ps(c03, s03, _MM_SHUFFLE(3, 3, 3, 3));
+	__m128 w4 = _mm_shuffle_ps(c45, s45, _MM_SHUFFLE(0, 0, 0, 0));
+	__m128 w5 = _mm_shuffle_ps(c45, s45, _MM_SHUFFLE(1, 1, 1, 1));
+
+	_MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+	__m128 x0 = _mm_shuffle_ps(m0, m0, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 x1 = _mm_shuffle_ps(m1, m1, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 x2 = _mm_shuffle_ps(m2, m2, _MM_SHUFFLE(2, 3, 0, 1));
+	__m128 x3 = _mm_shuffle_ps(m3, m3, _MM_SHUFFLE(2, 3, 0, 1));
+
+	__m128 odd = _mm_mul_ps(_mm_setr_ps(1.f, -1.f, 1.f, -1.f), _mm_set1_ps(idet));
+	__m128 even = _mm_mul_ps(_mm_setr_ps(-1.f, 1.f, -1.f, 1.f), _mm_set1_ps(idet));
+	_mm_storeu_ps(T[0], _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(x1, w5), _mm_mul_ps(x2, w4)), _mm_mul_ps(x3, w3)), odd));
+	_mm_storeu_ps(T[1], _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(x0, w5), _mm_mul_ps(x2, w2)), _mm_mul_ps(x3, w1)), even));
+	_mm_storeu_ps(T[2], _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(x0, w4), _mm_mul_ps(x1, w2)), _mm_mul_ps(x3, w0)), odd));
+	_mm_storeu_ps(T[3], _mm_mul_ps(_mm_add_ps(_mm_sub_ps(_mm_mul_ps(x0, w3), _mm_mul_ps(x1, w1)), _mm_mul_ps(x2, w0)), even));
+#else
 	float s[6];
 	float c[6];
 	s[0] = M[0][0] * M[1][1] - M[1][0] * M[0][1];
@@ -273,6 +449,32 @@ LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M) {
 	/* Assumes it is invertible */
 	float idet = 1.0f / (s[0] * c[5] - s[1] * c[4] + s[2] * c[3] + s[3] * c[2] - s[4] * c[1] + s[5] * c[0]);
 
+#if defined(LINMATH_NEON)
+	float x[4][4];
+	float w[6][4];
+	int i, k;
+	for (k = 0; k < 4; ++k) {
+		x[k][0] = M[1][k];
+		x[k][1] = M[0][k];
+		x[k][2] = M[3][k];
+		x[k][3] = M[2][k];
+	}
+	for (i = 0; i < 6; ++i) {
+		w[i][0] = w[i][1] = c[i];
+		w[i][2] = w[i][3] = s[i];
+	}
+	float32x4_t x0 = vld1q_f32(x[0]), x1 = vld1q_f32(x[1]), x2 = vld1q_f32(x[2]), x3 = vld1q_f32(x[3]);
+	float32x4_t w0 = vld1q_f32(w[0]), w1 = vld1q_f32(w[1]), w2 = vld1q_f32(w[2]);
+	float32x4_t w3 = vld1q_f32(w[3]), w4 = vld1q_f32(w[4]), w5 = vld1q_f32(w[5]);
+	float const odd_sign[4] = { 1.f, -1.f, 1.f, -1.f };
+	float const even_sign[4] = { -1.f, 1.f, -1.f, 1.f };
+	float32x4_t odd = vmulq_n_f32(vld1q_f32(odd_sign), idet);
+	float32x4_t even = vmulq_n_f32(vld1q_f32(even_sign), idet);
+	vst1q_f32(T[0], vmulq_f32(vaddq_f32(vsubq_f32(vmulq_f32(x1, w5), vmulq_f32(x2, w4)), vmulq_f32(x3, w3)), odd));
+	vst1q_f32(T[1], vmulq_f32(vaddq_f32(vsubq_f32(vmulq_f32(x0, w5), vmulq_f32(x2, w2)), vmulq_f32(x3, w1)), even));
+	vst1q_f32(T[2], vmulq_f32(vaddq_f32(vsubq_f32(vmulq_f32(x0, w4), vmulq_f32(x1, w2)), vmulq_f32(x3, w0)), odd));
+	vst1q_f32(T[3], vmulq_f32(vaddq_f32(vsubq_f32(vmulq_f32(x0, w3), vmulq_f32(x1, w1)), vmulq_f32(x2, w0)), even));
+#else
 	T[0][0] = (M[1][1] * c[5] - M[1][2] * c[4] + M[1][3] * c[3]) * idet;
 	T[0][1] = (-M[0][1] * c[5] + M[0][2] * c[4] - M[0][3] * c[3]) * idet;
 	T[0][2] = (M[3][1] * s[5] - M[3][2] * s[4] + M[3][3] * s[3]) * idet;
@@ -292,6 +494,8 @@ LINMATH_H_FUNC void mat4x4_invert(mat4x4 T, mat4x4 const M) {
 	T[3][1] = (M[0][0] * c[3] - M[0][1] * c[1] + M[0][2] * c[0]) * idet;
 	T[3][2] = (-M[3][0] * s[3] + M[3][1] * s[1] - M[3][2] * s[0]) * idet;
 	T[3][3] = (M[2][0] * s[3] - M[2][1] * s[1] + M[2][2] * s[0]) * idet;
+#endif
+#endif
 }
 LINMATH_H_FUNC void mat4x4_orthonormalize(mat4x4 R, mat4x4 const M) {
 	mat4x4_dup(R, M);
@@ -448,6 +652,16 @@ LINMATH_H_FUNC void quat_rotate(quat r, float angle, vec3 const axis) {
 	vec3_scale(r, axis_norm, s);
 	r[3] = c;
 }
+/* same rotation as mat4x4_rotate_Z(z) * mat4x4_rotate_Y(y) * mat4x4_rotate_X(x) */
+LINMATH_H_FUNC void quat_from_euler(quat q, float x, float y, float z) {
+	float sx = sinf(x / 2), cx = cosf(x / 2);
+	float sy = sinf(y / 2), cy = cosf(y / 2);
+	float sz = sinf(z / 2), cz = cosf(z / 2);
+	q[0] = cz * cy * sx - sz * sy * cx;
+	q[1] = cz * sy * cx + sz * cy * sx;
+	q[2] = sz * cy * cx - cz * sy * sx;
+	q[3] = cz * cy * cx + sz * sy * sx;
+}
 LINMATH_H_FUNC void quat_mul_vec3(vec3 r, quat const q, vec3 const v) {
 /*
  * Method by Fabian 'ryg' Giessen (of Farbrausch)
@@ -496,6 +710,17 @@ LINMATH_H_FUNC void mat4x4_from_quat(mat4x4 M, quat const q) {
 	M[3][3] = 1.f;
 }
 
+/* T * R * S from a translation, unit quaternion and scale, no trig involved */
+LINMATH_H_FUNC void mat4x4_from_trs(mat4x4 M, vec3 const t, quat const q, vec3 const s) {
+	mat4x4_from_quat(M, q);
+	vec4_scale(M[0], M[0], s[0]);
+	vec4_scale(M[1], M[1], s[1]);
+	vec4_scale(M[2], M[2], s[2]);
+	M[3][0] = t[0];
+	M[3][1] = t[1];
+	M[3][2] = t[2];
+}
+
 LINMATH_H_FUNC void mat4x4o_mul_quat(mat4x4 R, mat4x4 const M, quat const q) {
 /*  XXX: The way this is written only works for orthogonal matrices. */
 /* TODO: Take care of non-orthogonal case. */
@@ -11,5 +11,5 @@ layout (location = 0) out vec4 out_color;
 void main() {
 	//out_color = vec4(v_uv, 0.0f, 1.0f);
 	//out_color = vec4((v_pos + 1) / 2, 1.0f);
-	//out_color = vec4(texture(unif_sampler, v_uv).xyz, 1.0f);
+	out_color = vec4(texture(unif_sampler, v_uv).xyz, 1.0f);
 }
\ No newline at end of file
@@ -0,0 +1,309 @@
+#include "kalloc.hpp"
+
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+// stresses the TLSF allocator with random alloc/free traffic and checks after every step that live ranges are
+// aligned, in bounds and disjoint, and every so often walks the node lists to check that no two free
+// neighbours were left unmerged and that the free lists and bitmaps agree with the physical chain.
+
+struct live_t {
+	uint64_t size;
+	uint64_t alignment;
+	uint32_t handle;
+};
+
+static int failures = 0;
+
+static void fail(const char * what, uint64_t a = 0, uint64_t b = 0) {
+	if (failures < 16) {
+		std::cout << "FAIL " << what << " (" << a << ", " << b << ")\n";
+	}
+	++failures;
+}
+
+// the physical chain has to tile [0, size), with every free node on the list its size maps to
+static void check_structure(const kalloc_t & alloc, const std::map<uint64_t, live_t> & live) {
+	uint32_t first = KALLOC_NONE;
+	for (uint32_t i = 0; i < alloc.nodes.size(); ++i) {
+		if (alloc.nodes[i].in_use && alloc.nodes[i].prev_phys == KALLOC_NONE) {
+			if (first != KALLOC_NONE) {
+				fail("two chain heads", first, i);
+			}
+			first = i;
+		}
+	}
+	if (first == KALLOC_NONE) {
+		fail("no chain head");
+		return;
+	}
+
+	uint64_t offset = 0;
+	uint64_t used = 0;
+	uint32_t free_nodes = 0;
+	uint32_t used_nodes = 0;
+	uint32_t prev = KALLOC_NONE;
+	for (uint32_t i = first; i != KALLOC_NONE; i = alloc.nodes[i].next_phys) {
+		const kalloc_node_t & node = alloc.nodes[i];
+		if (!node.in_use) {
+			fail("released node in the chain", i);
+		}
+		if (node.offset != offset) {
+			fail("gap or overlap in the chain", node.offset, offset);
+		}
+		if (node.prev_phys != prev) {
+			fail("prev_phys doesn't point back", i, node.prev_phys);
+		}
+		if (node.size == 0) {
+			fail("empty node", i);
+		}
+		if (node.free) {
+			if (prev != KALLOC_NONE && alloc.nodes[prev].free) {
+				fail("free neighbours left unmerged", prev, i);
+			}
+			++free_nodes;
+		} else {
+			auto it = live.find(node.offset);
+			if (it == live.end() || it->second.handle != i || it->second.size != node.size) {
+				fail("allocated node doesn't match a live allocation", node.offset, node.size);
+			}
+			used += node.size;
+			++used_nodes;
+		}
+		offset += node.size;
+		prev = i;
+	}
+	if (offset != alloc.size) {
+		fail("chain doesn't cover the block", offset, alloc.size);
+	}
+	if (used != alloc.used || used_nodes != alloc.allocation_count || used_nodes != live.size()) {
+		fail("used bytes or allocation count out of step", used, alloc.used);
+	}
+
+	uint32_t listed = 0;
+	for (uint32_t fl = 0; fl < KALLOC_FL_COUNT; ++fl) {
+		if (((alloc.fl_bitmap >> fl) & 1) != (alloc.sl_bitmap[fl] != 0)) {
+			fail("first level bitmap disagrees with the second", fl);
+		}
+		for (uint32_t sl = 0; sl < KALLOC_SL_COUNT; ++sl) {
+			uint32_t head = alloc.heads[fl][sl];
+			if (((alloc.sl_bitmap[fl] >> sl) & 1) != (head != KALLOC_NONE)) {
+				fail("second level bitmap disagrees with the list", fl, sl);
+			}
+			for (uint32_t i = head; i != KALLOC_NONE; i = alloc.nodes[i].next_free) {
+				if (!alloc.nodes[i].in_use || !alloc.nodes[i].free) {
+					fail("allocated node on a free list", fl, sl);
+					break;
+				}
+				++listed;
+			}
+		}
+	}
+	if (listed != free_nodes) {
+		fail("free lists and chain disagree", listed, free_nodes);
+	}
+}
+
+// every live range is aligned, inside the block, and ends before the next one starts
+static void check_allocation(const kalloc_t & alloc, const std::map<uint64_t, live_t> & live, std::map<uint64_t, live_t>::const_iterator it) {
+	uint64_t offset = it->first;
+	if ((offset & (it->second.alignment - 1)) != 0) {
+		fail("misaligned", offset, it->second.alignment);
+	}
+	if (offset + it->second.size > alloc.size) {
+		fail("past the end of the block", offset, it->second.size);
+	}
+	if (it != live.begin()) {
+		auto before = std::prev(it);
+		if (before->first + before->second.size > offset) {
+			fail("overlaps the allocation before it", before->first, offset);
+		}
+	}
+	auto after = std::next(it);
+	if (after != live.end() && offset + it->second.size > after->first) {
+		fail("overlaps the allocation after it", offset, after->first);
+	}
+}
+
+static void test_stress() {
+	const uint64_t size = 64ull << 20;
+	kalloc_t alloc;
+	if (kalloc_create(&alloc, size) != 0) {
+		fail("kalloc_create");
+		return;
+	}
+
+	std::mt19937 rng(0x6B616C63);
+	std::map<uint64_t, live_t> live;
+	std::vector<uint64_t> offsets;
+	uint32_t full = 0;
+
+	for (int step = 0; step < 200000; ++step) {
+		// lean towards allocating until the block fills, then towards freeing, so both ends get hit
+		bool allocate = live.empty() || rng() % 100 < (alloc.used < size / 2 ? 60u : 40u);
+		if (allocate) {
+			uint64_t bytes;
+			switch (rng() % 8) {
+			case 0: bytes = 1 + rng() % 31; break;
+			case 1: bytes = 1 + rng() % (4u << 20); break;
+			default: bytes = 1 + rng() % 65536; break;
+			}
+			uint64_t alignment = rng() % 4 == 0 ? 1 : 1ull << (rng() % 17);
+
+			uint64_t offset;
+			uint32_t handle;
+			int result = kalloc_alloc(&alloc, bytes, alignment, &offset, &handle);
+			if (result == 3) {
+				++full;
+				// a failure can be fragmentation, but never when the largest hole obviously fits
+				uint64_t search = bytes + alignment - 1;
+				if (kalloc_largest_free(&alloc) > search + (search >> KALLOC_SL_LOG2)) {
+					fail("out of memory with room left", bytes, kalloc_largest_free(&alloc));
+				}
+			} else if (result != 0) {
+				fail("kalloc_alloc", result, bytes);
+			} else {
+				auto [it, inserted] = live.emplace(offset, live_t { .size = bytes, .alignment = alignment, .handle = handle });
+				if (!inserted) {
+					fail("offset handed out twice", offset);
+				} else {
+					check_allocation(alloc, live, it);
+					offsets.push_back(offset);
+				}
+			}
+		} else {
+			size_t pick = rng() % offsets.size();
+			auto it = live.find(offsets[pick]);
+			kalloc_free(&alloc, it->second.handle);
+			live.erase(it);
+			offsets[pick] = offsets.back();
+			offsets.pop_back();
+		}
+
+		if (step % 1000 == 0) {
+			check_structure(alloc, live);
+		}
+	}
+	check_structure(alloc, live);
+	if (full == 0) {
+		fail("the stress never filled the block");
+	}
+
+	// freeing everything has to coalesce back to the one block it started as
+	for (auto & [offset, l] : live) {
+		kalloc_free(&alloc, l.handle);
+	}
+	live.clear();
+	check_structure(alloc, live);
+	if (kalloc_largest_free(&alloc) != size || alloc.used != 0 || alloc.allocation_count != 0) {
+		fail("not back to one free block", kalloc_largest_free(&alloc), alloc.used);
+	}
+
+	std::cout << "stress: " << alloc.nodes.size() << " nodes at peak, " << full << " allocations found no room\n";
+	kalloc_destroy(&alloc);
+}
+
+// the neighbour cases of coalescing, one at a time
+static void test_coalesce() {
+	kalloc_t alloc;
+	kalloc_create(&alloc, 4096);
+
+	uint64_t offsets[4];
+	uint32_t handles[4];
+	for (int i = 0; i < 4; ++i) {
+		if (kalloc_alloc(&alloc, 1024, 1, &offsets[i], &handles[i]) != 0 || offsets[i] != 1024ull * i) {
+			fail("filling the block", i, offsets[i]);
+		}
+	}
+
+	uint64_t offset;
+	uint32_t handle;
+	if (kalloc_alloc(&alloc, 1, 1, &offset, &handle) != 3) {
+		fail("a full block has to refuse");
+	}
+
+	// 1 then 2 merges with the free block before it, 0 with the one after, 3 with both
+	kalloc_free(&alloc, handles[1]);
+	if (kalloc_largest_free(&alloc) != 1024) {
+		fail("free 1", kalloc_largest_free(&alloc));
+	}
+	kalloc_free(&alloc, handles[2]);
+	if (kalloc_largest_free(&alloc) != 2048) {
+		fail("merge with the block before", kalloc_largest_free(&alloc));
+	}
+	kalloc_free(&alloc, handles[0]);
+	if (kalloc_largest_free(&alloc) != 3072) {
+		fail("merge with the block after", kalloc_largest_free(&alloc));
+	}
+	kalloc_free(&alloc, handles[3]);
+	if (kalloc_largest_free(&alloc) != 4096) {
+		fail("merge with both", kalloc_largest_free(&alloc));
+	}
+
+	// double frees and stale handles are ignored
+	kalloc_free(&alloc, handles[3]);
+	kalloc_free(&alloc, 1000);
+	check_structure(alloc, {});
+
+	// the aligned start leaves the padding in front free, and it merges back on free
+	uint64_t a;
+	uint32_t ha;
+	kalloc_alloc(&alloc, 16, 1, &a, &ha);
+	if (kalloc_alloc(&alloc, 16, 2048, &offset, &handle) != 0 || offset != 2048) {
+		fail("aligned allocation", offset);
+	}
+	std::map<uint64_t, live_t> live = {
+		{ a, live_t { .size = 16, .alignment = 1, .handle = ha } },
+		{ offset, live_t { .size = 16, .alignment = 2048, .handle = handle } },
+	};
+	check_structure(alloc, live);
+	kalloc_free(&alloc, ha);
+	kalloc_free(&alloc, handle);
+	check_structure(alloc, {});
+	if (kalloc_largest_free(&alloc) != 4096) {
+		fail("padding merged back", kalloc_largest_free(&alloc));
+	}
+
+	kalloc_destroy(&alloc);
+}
+
+static void test_arguments() {
+	kalloc_t alloc;
+	if (kalloc_create(&alloc, 0) != 1 || kalloc_create(nullptr, 16) != 1) {
+		fail("kalloc_create takes an empty block");
+	}
+	kalloc_create(&alloc, 1 << 16);
+
+	uint64_t offset;
+	uint32_t handle;
+	if (kalloc_alloc(&alloc, 0, 1, &offset, &handle) != 1) {
+		fail("zero size");
+	}
+	if (kalloc_alloc(&alloc, 16, 3, &offset, &handle) != 1) {
+		fail("alignment that isn't a power of two");
+	}
+	if (kalloc_alloc(&alloc, (1 << 16) + 1, 1, &offset, &handle) != 3) {
+		fail("larger than the block");
+	}
+	if (kalloc_alloc(&alloc, 16, 0, &offset, &handle) != 0 || offset != 0) {
+		fail("alignment 0 means unaligned");
+	}
+
+	kalloc_destroy(&alloc);
+}
+
+int main() {
+	test_arguments();
+	test_coalesce();
+	test_stress();
+
+	if (failures != 0) {
+		std::cout << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "ok\n";
+	return 0;
+}
\ No newline at end of file
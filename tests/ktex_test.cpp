@@ -0,0 +1,157 @@
+#include "ktex.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+// loads test.ktx2, then feeds ktex_load headers whose counts, sizes and offsets are out of range or wrap
+// in 64 bits. Each has to come back as an error code rather than a huge allocation or a range past the buffer.
+
+static const uint32_t format_rgba8 = 37; // VK_FORMAT_R8G8B8A8_UNORM
+
+static int failures = 0;
+
+static void put32(std::vector<unsigned char> & buf, size_t at, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		buf[at + i] = static_cast<unsigned char>(value >> (i * 8));
+	}
+}
+
+static void put64(std::vector<unsigned char> & buf, size_t at, uint64_t value) {
+	put32(buf, at, static_cast<uint32_t>(value));
+	put32(buf, at + 4, static_cast<uint32_t>(value >> 32));
+}
+
+struct ktx2_desc_t {
+	uint32_t width = 4;
+	uint32_t height = 4;
+	uint32_t depth = 0;
+	uint32_t layers = 0;
+	uint32_t faces = 1;
+	uint32_t levels = 1;
+};
+
+// one level of 4x4 RGBA8 right after the level index unless the fields say otherwise
+static std::vector<unsigned char> make_ktx2(const ktx2_desc_t & desc, size_t data_bytes = 64) {
+	static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	uint32_t index_levels = desc.levels == 0 ? 1 : (desc.levels > 32 ? 32 : desc.levels);
+	size_t data_offset = 80 + index_levels * 24;
+
+	std::vector<unsigned char> buf(data_offset + data_bytes, 0);
+	memcpy(buf.data(), identifier, sizeof(identifier));
+	put32(buf, 12, format_rgba8);
+	put32(buf, 16, 1);
+	put32(buf, 20, desc.width);
+	put32(buf, 24, desc.height);
+	put32(buf, 28, desc.depth);
+	put32(buf, 32, desc.layers);
+	put32(buf, 36, desc.faces);
+	put32(buf, 40, desc.levels);
+	for (uint32_t level = 0; level < index_levels; ++level) {
+		put64(buf, 80 + level * 24, data_offset);
+		put64(buf, 80 + level * 24 + 8, data_bytes);
+	}
+	return buf;
+}
+
+struct dds_desc_t {
+	uint32_t width = 4;
+	uint32_t height = 4;
+	uint32_t levels = 1;
+	uint32_t array_size = 0;
+	bool dx10 = false;
+	bool cube = false;
+};
+
+// BC1 is 8 bytes a 4x4 block
+static std::vector<unsigned char> make_dds(const dds_desc_t & desc, size_t data_bytes = 8) {
+	size_t data_offset = desc.dx10 ? 148 : 128;
+	std::vector<unsigned char> buf(data_offset + data_bytes, 0);
+	put32(buf, 0, 0x20534444);
+	put32(buf, 4, 124);
+	put32(buf, 8, 0x1007 | 0x20000);
+	put32(buf, 12, desc.height);
+	put32(buf, 16, desc.width);
+	put32(buf, 28, desc.levels);
+	put32(buf, 76, 32);
+	put32(buf, 80, 0x4);
+	if (desc.dx10) {
+		put32(buf, 84, 0x30315844);
+		put32(buf, 128, 71);
+		put32(buf, 132, 3);
+		put32(buf, 136, desc.cube ? 0x4 : 0);
+		put32(buf, 140, desc.array_size);
+	} else {
+		put32(buf, 84, 0x31545844);
+		put32(buf, 112, desc.cube ? 0xFE00 : 0);
+	}
+	return buf;
+}
+
+static void expect(const char * what, const std::vector<unsigned char> & buf, int expected) {
+	ktex_t tex = {};
+	int ret = ktex_load(&tex, buf.data(), buf.size());
+	if (ret != expected) {
+		std::cout << "FAIL " << what << ": returned " << ret << ", expected " << expected << "\n";
+		++failures;
+	}
+	if (ret != 0) {
+		return;
+	}
+
+	for (uint32_t i = 0; i < tex.levels * tex.layers; ++i) {
+		const ktex_image_t & image = tex.images[i];
+		if (image.offset > buf.size() || image.size > buf.size() - image.offset) {
+			std::cout << "FAIL " << what << ": image " << i << " runs past the buffer\n";
+			++failures;
+			break;
+		}
+	}
+	ktex_destroy(&tex);
+}
+
+int main() {
+	std::ifstream file("test.ktx2", std::ios::binary);
+	std::vector<unsigned char> ktx2((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (ktx2.empty()) {
+		std::cout << "FAIL test.ktx2 not found, run from the source directory\n";
+		return 1;
+	}
+	expect("test.ktx2", ktx2, 0);
+
+	expect("ktx2 4x4", make_ktx2({}), 0);
+	expect("ktx2 4x4 short data", make_ktx2({}, 63), 5);
+	expect("ktx2 cube", make_ktx2({ .faces = 6 }, 64 * 6), 0);
+
+	// layers * faces is 2^64 - 2^33 + 1, which used to wrap in 32 bits and size the image array from that
+	expect("ktx2 layer and face counts", make_ktx2({ .layers = 0xFFFFFFFF, .faces = 0xFFFFFFFF }), 5);
+	expect("ktx2 layer count", make_ktx2({ .layers = 0x10000000 }), 5);
+	expect("ktx2 extent", make_ktx2({ .width = 0xFFFFFFFF, .height = 0xFFFFFFFF, .depth = 0xFFFFFFFF }), 5);
+	expect("ktx2 level count", make_ktx2({ .levels = 33 }), 5);
+	expect("ktx2 mips larger than the file", make_ktx2({ .width = 1024, .height = 1024, .levels = 3 }), 5);
+
+	// byte_offset + byte_length wraps to something small
+	std::vector<unsigned char> wrap = make_ktx2({});
+	put64(wrap, 80, 0xFFFFFFFFFFFFFFF0ull);
+	put64(wrap, 88, 0x20);
+	expect("ktx2 offset wrap", wrap, 5);
+	put64(wrap, 80, 104);
+	put64(wrap, 88, 0xFFFFFFFFFFFFFFFFull);
+	expect("ktx2 length wrap", wrap, 5);
+
+	expect("dds bc1", make_dds({}), 0);
+	expect("dds bc1 mips", make_dds({ .width = 16, .height = 16, .levels = 3 }, 128 + 32 + 8), 0);
+	expect("dds bc1 short data", make_dds({ .width = 16, .height = 16, .levels = 3 }, 128 + 32), 5);
+	expect("dds cube", make_dds({ .cube = true }, 8 * 6), 0);
+	expect("dds array size", make_dds({ .array_size = 0xFFFFFFFF, .dx10 = true, .cube = true }), 5);
+	expect("dds extent", make_dds({ .width = 0xFFFFFFFF, .height = 0xFFFFFFFF, .levels = 32 }), 5);
+
+	if (failures != 0) {
+		std::cout << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "ok\n";
+	return 0;
+}
\ No newline at end of file
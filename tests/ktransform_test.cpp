@@ -0,0 +1,200 @@
+#include "ktransform.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// ktransform_build runs the 4-wide SSE path over whole groups of four and mat4x4_from_trs over the tail.
+// Every range here is checked against mat4x4_from_trs for each slot, with starts and counts that aren't
+// multiples of 4 so groups straddle the start and a tail is left, and ranges that must be refused.
+// ktransform_build_touched is checked to rebuild the touched slots and leave the rest alone.
+
+static const float tolerance = 1e-5f;
+
+static std::mt19937 rng(0x6B747266);
+static int failures = 0;
+
+static void fail(const char * what, uint32_t first, uint32_t count, float worst = 0.0f) {
+	std::cout << "FAIL " << what << " first " << first << " count " << count << ", max error " << worst << "\n";
+	++failures;
+}
+
+static void random_soa(ktransform_soa_t * soa, uint32_t count) {
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> scales(0.1f, 4.0f);
+	ktransform_soa_create(soa, count);
+	for (uint32_t i = 0; i < count; ++i) {
+		float position[3] = { dist(rng) * 100.0f, dist(rng) * 100.0f, dist(rng) * 100.0f };
+		quat rotation = { dist(rng), dist(rng), dist(rng), dist(rng) };
+		quat_norm(rotation, rotation);
+		float scale[3] = { scales(rng), scales(rng), scales(rng) };
+		ktransform_soa_set(soa, i, position, rotation, scale);
+	}
+}
+
+// the scalar path, the same call ktransform_build makes for the tail
+static void reference(const ktransform_soa_t * soa, uint32_t i, mat4x4 model) {
+	vec3 t = { soa->position[0][i], soa->position[1][i], soa->position[2][i] };
+	quat q = { soa->rotation[0][i], soa->rotation[1][i], soa->rotation[2][i], soa->rotation[3][i] };
+	vec3 s = { soa->scale[0][i], soa->scale[1][i], soa->scale[2][i] };
+	mat4x4_from_trs(model, t, q, s);
+}
+
+static float max_error(mat4x4 const a, mat4x4 const b) {
+	float worst = 0.0f;
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			worst = std::max(worst, std::fabs(a[c][r] - b[c][r]) / std::max(1.0f, std::fabs(b[c][r])));
+		}
+	}
+	return worst;
+}
+
+static void check_range(const ktransform_soa_t * soa, uint32_t first, uint32_t count, uint32_t threads) {
+	mat4x4 view_proj;
+	mat4x4_perspective(view_proj, 1.0f, 4.0f / 3.0f, 0.1f, 1000.0f);
+
+	// one past the range on each side, which has to stay untouched
+	std::vector<mat4x4> models(count + 1);
+	std::vector<mat4x4> mvps(count + 1);
+	memset(models.data(), 0x7F, sizeof(mat4x4) * models.size());
+	memset(mvps.data(), 0x7F, sizeof(mat4x4) * mvps.size());
+	ktransform_build(soa, first, count, models.data(), view_proj, mvps.data(), threads);
+
+	float worst = 0.0f;
+	float worst_mvp = 0.0f;
+	for (uint32_t k = 0; k < count; ++k) {
+		mat4x4 expected;
+		reference(soa, first + k, expected);
+		worst = std::max(worst, max_error(models[k], expected));
+
+		mat4x4 expected_mvp;
+		mat4x4_mul(expected_mvp, view_proj, expected);
+		worst_mvp = std::max(worst_mvp, max_error(mvps[k], expected_mvp));
+	}
+	if (!(worst <= tolerance)) {
+		fail("models", first, count, worst);
+	}
+	if (!(worst_mvp <= tolerance)) {
+		fail("mvps", first, count, worst_mvp);
+	}
+
+	const unsigned char * past = reinterpret_cast<const unsigned char *>(models[count]);
+	if (std::any_of(past, past + sizeof(mat4x4), [](unsigned char b) { return b != 0x7F; })) {
+		fail("wrote past the range", first, count);
+	}
+}
+
+// ktransform_build_touched has to list exactly the slots in expected, in order, and rebuild only those
+static void check_touched(ktransform_soa_t * soa, std::vector<uint32_t> expected) {
+	std::vector<mat4x4> models(soa->count);
+	std::vector<uint32_t> slots(soa->count);
+	memset(models.data(), 0x7F, sizeof(mat4x4) * models.size());
+	uint32_t count = ktransform_build_touched(soa, models.data(), slots.data(), 1);
+
+	slots.resize(count);
+	if (slots != expected) {
+		fail("touched slots", expected.empty() ? 0 : expected[0], static_cast<uint32_t>(expected.size()));
+		return;
+	}
+
+	float worst = 0.0f;
+	for (uint32_t i = 0, k = 0; i < soa->count; ++i) {
+		if (k < count && slots[k] == i) {
+			mat4x4 expected_model;
+			reference(soa, i, expected_model);
+			worst = std::max(worst, max_error(models[i], expected_model));
+			++k;
+			continue;
+		}
+		const unsigned char * bytes = reinterpret_cast<const unsigned char *>(models[i]);
+		if (std::any_of(bytes, bytes + sizeof(mat4x4), [](unsigned char b) { return b != 0x7F; })) {
+			fail("rebuilt an untouched slot", i, 1);
+			return;
+		}
+	}
+	if (!(worst <= tolerance)) {
+		fail("touched models", slots.empty() ? 0 : slots[0], count, worst);
+	}
+	if (soa->touched_count != 0) {
+		fail("touched list left over", 0, soa->touched_count);
+	}
+}
+
+// a refused range leaves the output as it was
+static void check_refused(const ktransform_soa_t * soa, uint32_t first, uint32_t count) {
+	mat4x4 models[4];
+	memset(models, 0x7F, sizeof(models));
+	ktransform_build(soa, first, count, models, nullptr, nullptr, 1);
+
+	const unsigned char * bytes = reinterpret_cast<const unsigned char *>(models);
+	if (std::any_of(bytes, bytes + sizeof(models), [](unsigned char b) { return b != 0x7F; })) {
+		fail("out of range build wrote", first, count);
+	}
+}
+
+int main() {
+	ktransform_soa_t soa;
+	random_soa(&soa, 37);
+
+	check_range(&soa, 0, 37, 1);
+	check_range(&soa, 0, 36, 1);
+	check_range(&soa, 5, 19, 1);
+	check_range(&soa, 1, 3, 1);
+	check_range(&soa, 34, 3, 1);
+	check_range(&soa, 36, 1, 1);
+
+	// first + count used to wrap past the end and look in range
+	check_refused(&soa, 0xFFFFFFF0u, 0x20);
+	check_refused(&soa, 1, 37);
+	check_refused(&soa, 38, 1);
+	check_refused(&soa, 0, 38);
+	check_refused(&soa, 0xFFFFFFFFu, 1);
+	ktransform_soa_destroy(&soa);
+
+	// a new soa has every slot touched, after that only what changed is rebuilt
+	random_soa(&soa, 64);
+	std::vector<uint32_t> all(64);
+	for (uint32_t i = 0; i < 64; ++i) {
+		all[i] = i;
+	}
+	check_touched(&soa, all);
+	check_touched(&soa, {});
+
+	// few enough to go through the sorted list, 7 twice to make sure it's listed once
+	float spin[4] = { 0.0f, 0.6f, 0.0f, 0.8f };
+	float zero[3] = { 0.0f, 0.0f, 0.0f };
+	float one[3] = { 1.0f, 1.0f, 1.0f };
+	ktransform_soa_set(&soa, 7, zero, spin, one);
+	ktransform_soa_set(&soa, 2, zero, spin, one);
+	soa.position[1][8] = 3.0f;
+	ktransform_soa_touch(&soa, 8);
+	ktransform_soa_touch(&soa, 7);
+	check_touched(&soa, { 2, 7, 8 });
+
+	// more than an eighth, which scans the flags instead
+	std::vector<uint32_t> odd;
+	for (uint32_t i = 63; i < 64; i -= 2) {
+		soa.position[0][i] += 1.0f;
+		ktransform_soa_touch(&soa, i);
+		odd.insert(odd.begin(), i);
+	}
+	check_touched(&soa, odd);
+	ktransform_soa_destroy(&soa);
+
+	// enough for several threads, whose chunks start wherever first puts them
+	random_soa(&soa, 3 * KTRANSFORM_MIN_CHUNK + 7);
+	check_range(&soa, 0, soa.count, 4);
+	check_range(&soa, 3, soa.count - 5, 4);
+	ktransform_soa_destroy(&soa);
+
+	if (failures != 0) {
+		std::cout << failures << " failures\n";
+		return 1;
+	}
+	std::cout << "ok\n";
+	return 0;
+}
\ No newline at end of file
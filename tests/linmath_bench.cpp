@@ -0,0 +1,125 @@
+#include "linmath_kernels.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// ns per call of each linmath path, so a SIMD change can be weighed against the scalar code it replaces.
+// usage: linmath_bench [iterations], from a Release build since the default one is unoptimized
+
+static const int batch_count = 1024;
+
+struct bench_result_t {
+	double mul_ns;
+	double mul_vec4_ns;
+	double invert_ns;
+	double rotate_ns;
+	double batch_ns;
+	float checksum;
+};
+
+template<typename F>
+static double time_ns(int iterations, F && f) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; ++i) {
+		f(i);
+	}
+	auto end = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+static bench_result_t bench(const linmath_kernels_t & kernels, int iterations, const std::vector<mat4x4> & mats, const std::vector<vec4> & vecs) {
+	bench_result_t result = {};
+	size_t mask = mats.size() - 1;
+
+	// every result is summed into the checksum so none of the calls are dead, and the inputs stay
+	// independent so the chain can't blow up into infs that run at a different speed
+	mat4x4 M;
+	result.mul_ns = time_ns(iterations, [&](int i) {
+		kernels.mul(M, mats[i & mask], mats[(i + 1) & mask]);
+		result.checksum += M[i & 3][(i >> 2) & 3];
+	});
+
+	vec4 r;
+	result.mul_vec4_ns = time_ns(iterations, [&](int i) {
+		kernels.mul_vec4(r, mats[i & mask], vecs[i & (batch_count - 1)]);
+		result.checksum += r[i & 3];
+	});
+
+	result.invert_ns = time_ns(iterations, [&](int i) {
+		kernels.invert(M, mats[i & mask]);
+		result.checksum += M[i & 3][(i >> 2) & 3];
+	});
+
+	// sinf/cosf are part of the call, the same in every path
+	result.rotate_ns = time_ns(iterations, [&](int i) {
+		const float * axis = vecs[i & (batch_count - 1)];
+		kernels.rotate(M, mats[i & mask], axis[0], axis[1], axis[2], 0.001f * (i & 1023));
+		result.checksum += M[i & 3][(i >> 2) & 3];
+	});
+
+	std::vector<vec4> out(batch_count);
+	int batches = iterations / 64 + 1;
+	result.batch_ns = time_ns(batches, [&](int i) {
+		kernels.mul_vec4_batch(out.data(), mats[i & mask], vecs.data(), batch_count);
+	}) / batch_count;
+	result.checksum += out[batch_count - 1][0];
+
+	return result;
+}
+
+int main(int argc, char ** argv) {
+	int iterations = 1000000;
+	if (argc > 1) {
+		iterations = std::atoi(argv[1]);
+	}
+	if (iterations <= 0) {
+		std::cout << "usage: linmath_bench [iterations]\n";
+		return 1;
+	}
+
+	// well conditioned so the invert chain stays finite
+	std::mt19937 rng(0x6B6D6174);
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::vector<mat4x4> mats(64);
+	for (mat4x4 & m : mats) {
+		for (int c = 0; c < 4; ++c) {
+			for (int r = 0; r < 4; ++r) {
+				m[c][r] = dist(rng) * 0.25f + (c == r ? 1.0f : 0.0f);
+			}
+		}
+	}
+	std::vector<vec4> vecs(batch_count);
+	for (vec4 & v : vecs) {
+		for (int i = 0; i < 4; ++i) {
+			v[i] = dist(rng);
+		}
+	}
+
+	std::vector<const linmath_kernels_t *> kernels = { &linmath_scalar, &linmath_simd };
+	#ifdef LINMATH_TEST_AVX
+	if (__builtin_cpu_supports("avx")) {
+		kernels.push_back(&linmath_avx);
+	}
+	#endif
+
+	bench_result_t scalar = {};
+	std::cout << "iterations " << iterations << ", ns per call (speedup over scalar), mul_vec4_batch per vector\n";
+	for (const linmath_kernels_t * k : kernels) {
+		bench_result_t r = bench(*k, iterations, mats, vecs);
+		if (k == &linmath_scalar) {
+			scalar = r;
+		}
+		std::cout << k->name
+			<< ": mat4x4_mul " << r.mul_ns << " (" << scalar.mul_ns / r.mul_ns << "x)"
+			<< ", mat4x4_mul_vec4 " << r.mul_vec4_ns << " (" << scalar.mul_vec4_ns / r.mul_vec4_ns << "x)"
+			<< ", mat4x4_invert " << r.invert_ns << " (" << scalar.invert_ns / r.invert_ns << "x)"
+			<< ", mat4x4_rotate " << r.rotate_ns << " (" << scalar.rotate_ns / r.rotate_ns << "x)"
+			<< ", mat4x4_mul_vec4_batch " << r.batch_ns << " (" << scalar.batch_ns / r.batch_ns << "x)"
+			<< ", checksum " << r.checksum << "\n";
+	}
+
+	return 0;
+}
\ No newline at end of file
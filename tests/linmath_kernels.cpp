@@ -0,0 +1,14 @@
+#include "linmath_kernels.hpp"
+
+/* LINMATH_TEST_KERNELS names this copy, LINMATH_NO_SIMD or -mavx pick the path it wraps */
+#define LINMATH_TEST_STRING(x) #x
+#define LINMATH_TEST_NAME(x) LINMATH_TEST_STRING(x)
+
+extern const linmath_kernels_t LINMATH_TEST_KERNELS = {
+	.name = LINMATH_TEST_NAME(LINMATH_TEST_KERNELS),
+	.mul = mat4x4_mul,
+	.mul_vec4 = mat4x4_mul_vec4,
+	.invert = mat4x4_invert,
+	.rotate = mat4x4_rotate,
+	.mul_vec4_batch = mat4x4_mul_vec4_batch,
+};
\ No newline at end of file
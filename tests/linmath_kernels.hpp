@@ -0,0 +1,23 @@
+#ifndef KRISVERS_LINMATH_KERNELS_HPP
+#define KRISVERS_LINMATH_KERNELS_HPP
+
+#include "linmath.h"
+
+/* linmath_kernels.cpp is built once per instruction set, each copy exports the linmath paths it was
+   compiled with under its own name so one binary can hold them side by side */
+struct linmath_kernels_t {
+	const char * name;
+	void (*mul)(mat4x4 M, mat4x4 const a, mat4x4 const b);
+	void (*mul_vec4)(vec4 r, mat4x4 const M, vec4 const v);
+	void (*invert)(mat4x4 T, mat4x4 const M);
+	void (*rotate)(mat4x4 R, mat4x4 const M, float x, float y, float z, float angle);
+	void (*mul_vec4_batch)(vec4 * r, mat4x4 const M, vec4 const * v, int count);
+};
+
+extern const linmath_kernels_t linmath_scalar;
+extern const linmath_kernels_t linmath_simd;
+#ifdef LINMATH_TEST_AVX
+extern const linmath_kernels_t linmath_avx;
+#endif
+
+#endif
\ No newline at end of file
@@ -0,0 +1,213 @@
+#include "linmath_kernels.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// every SIMD path is checked against the scalar one on the same random inputs. The paths keep the scalar
+// evaluation order, so differences only come from the compiler contracting into FMAs.
+static const float mul_tolerance = 1e-5f;
+static const float invert_tolerance = 1e-4f;
+
+static std::mt19937 rng(0x6B6D6174);
+
+static void random_mat4x4(mat4x4 M) {
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	for (int c = 0; c < 4; ++c) {
+		for (int r = 0; r < 4; ++r) {
+			M[c][r] = dist(rng);
+		}
+	}
+}
+
+// diagonally dominant, so the inverse is well conditioned and the tolerance means something
+static void random_invertible(mat4x4 M) {
+	random_mat4x4(M);
+	for (int i = 0; i < 4; ++i) {
+		M[i][i] += M[i][i] < 0.0f ? -4.0f : 4.0f;
+	}
+}
+
+// relative to the value for large ones, absolute near zero
+static float error(float value, float expected) {
+	return std::fabs(value - expected) / std::max(1.0f, std::fabs(expected));
+}
+
+static float max_error(const float * values, const float * expected, int count) {
+	float worst = 0.0f;
+	for (int i = 0; i < count; ++i) {
+		worst = std::max(worst, error(values[i], expected[i]));
+	}
+	return worst;
+}
+
+static bool check(const char * kernels, const char * what, float worst, float tolerance) {
+	bool ok = worst <= tolerance;
+	std::cout << (ok ? "ok   " : "FAIL ") << kernels << " " << what << ": max error " << worst << ", tolerance " << tolerance << "\n";
+	return ok;
+}
+
+static bool test_mul(const linmath_kernels_t & kernels) {
+	float worst = 0.0f;
+	float worst_alias = 0.0f;
+	for (int i = 0; i < 10000; ++i) {
+		mat4x4 a;
+		mat4x4 b;
+		random_mat4x4(a);
+		random_mat4x4(b);
+
+		mat4x4 expected;
+		mat4x4 M;
+		linmath_scalar.mul(expected, a, b);
+		kernels.mul(M, a, b);
+		worst = std::max(worst, max_error(&M[0][0], &expected[0][0], 16));
+
+		// M may be a or b
+		mat4x4_dup(M, a);
+		kernels.mul(M, M, b);
+		worst_alias = std::max(worst_alias, max_error(&M[0][0], &expected[0][0], 16));
+		mat4x4_dup(M, b);
+		kernels.mul(M, a, M);
+		worst_alias = std::max(worst_alias, max_error(&M[0][0], &expected[0][0], 16));
+	}
+
+	bool ok = check(kernels.name, "mat4x4_mul", worst, mul_tolerance);
+	return check(kernels.name, "mat4x4_mul aliased", worst_alias, mul_tolerance) && ok;
+}
+
+static bool test_mul_vec4(const linmath_kernels_t & kernels) {
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	float worst = 0.0f;
+	for (int i = 0; i < 10000; ++i) {
+		mat4x4 M;
+		random_mat4x4(M);
+		vec4 v = { dist(rng), dist(rng), dist(rng), dist(rng) };
+
+		vec4 expected;
+		vec4 r;
+		linmath_scalar.mul_vec4(expected, M, v);
+		kernels.mul_vec4(r, M, v);
+		worst = std::max(worst, max_error(r, expected, 4));
+	}
+
+	return check(kernels.name, "mat4x4_mul_vec4", worst, mul_tolerance);
+}
+
+static bool test_invert(const linmath_kernels_t & kernels) {
+	float worst = 0.0f;
+	float worst_identity = 0.0f;
+	mat4x4 identity;
+	mat4x4_identity(identity);
+	for (int i = 0; i < 10000; ++i) {
+		mat4x4 M;
+		random_invertible(M);
+
+		mat4x4 expected;
+		mat4x4 T;
+		linmath_scalar.invert(expected, M);
+		kernels.invert(T, M);
+		worst = std::max(worst, max_error(&T[0][0], &expected[0][0], 16));
+
+		// and it has to actually be the inverse, not just agree with the scalar code
+		mat4x4 product;
+		linmath_scalar.mul(product, M, T);
+		worst_identity = std::max(worst_identity, max_error(&product[0][0], &identity[0][0], 16));
+	}
+
+	bool ok = check(kernels.name, "mat4x4_invert", worst, invert_tolerance);
+	return check(kernels.name, "mat4x4_invert M * T = I", worst_identity, invert_tolerance) && ok;
+}
+
+static bool test_rotate(const linmath_kernels_t & kernels) {
+	std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> angles(-6.3f, 6.3f);
+	float worst = 0.0f;
+	float worst_alias = 0.0f;
+	for (int i = 0; i < 10000; ++i) {
+		mat4x4 M;
+		random_mat4x4(M);
+
+		// random axes, the unit axes, and ones short enough to take the no rotation branch
+		vec3 axis = { dist(rng), dist(rng), dist(rng) };
+		if (i % 16 == 0) {
+			axis[0] = axis[1] = axis[2] = 0.0f;
+			axis[(i / 16) % 3] = 1.0f;
+		} else if (i % 16 == 1) {
+			vec3_scale(axis, axis, 1e-5f);
+		}
+		float angle = angles(rng);
+
+		mat4x4 expected;
+		mat4x4 R;
+		linmath_scalar.rotate(expected, M, axis[0], axis[1], axis[2], angle);
+		kernels.rotate(R, M, axis[0], axis[1], axis[2], angle);
+		worst = std::max(worst, max_error(&R[0][0], &expected[0][0], 16));
+
+		// R may be M
+		kernels.rotate(M, M, axis[0], axis[1], axis[2], angle);
+		worst_alias = std::max(worst_alias, max_error(&M[0][0], &expected[0][0], 16));
+	}
+
+	bool ok = check(kernels.name, "mat4x4_rotate", worst, mul_tolerance);
+	return check(kernels.name, "mat4x4_rotate in place", worst_alias, mul_tolerance) && ok;
+}
+
+static bool test_mul_vec4_batch(const linmath_kernels_t & kernels) {
+	float worst = 0.0f;
+	float worst_alias = 0.0f;
+
+	// odd counts leave a tail behind the two at a time AVX loop
+	for (int count = 0; count <= 33; ++count) {
+		mat4x4 M;
+		random_mat4x4(M);
+
+		std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+		std::vector<vec4> v(count);
+		for (vec4 & x : v) {
+			for (int i = 0; i < 4; ++i) {
+				x[i] = dist(rng);
+			}
+		}
+
+		std::vector<vec4> expected(count);
+		std::vector<vec4> r(count);
+		linmath_scalar.mul_vec4_batch(expected.data(), M, v.data(), count);
+		kernels.mul_vec4_batch(r.data(), M, v.data(), count);
+		if (count != 0) {
+			worst = std::max(worst, max_error(&r[0][0], &expected[0][0], count * 4));
+		}
+
+		// r may be v
+		kernels.mul_vec4_batch(v.data(), M, v.data(), count);
+		if (count != 0) {
+			worst_alias = std::max(worst_alias, max_error(&v[0][0], &expected[0][0], count * 4));
+		}
+	}
+
+	bool ok = check(kernels.name, "mat4x4_mul_vec4_batch", worst, mul_tolerance);
+	return check(kernels.name, "mat4x4_mul_vec4_batch in place", worst_alias, mul_tolerance) && ok;
+}
+
+int main() {
+	std::vector<const linmath_kernels_t *> kernels = { &linmath_scalar, &linmath_simd };
+	#ifdef LINMATH_TEST_AVX
+	if (__builtin_cpu_supports("avx")) {
+		kernels.push_back(&linmath_avx);
+	} else {
+		std::cout << "skip " << linmath_avx.name << ": the cpu has no AVX\n";
+	}
+	#endif
+
+	bool ok = true;
+	for (const linmath_kernels_t * k : kernels) {
+		ok = test_mul(*k) && ok;
+		ok = test_mul_vec4(*k) && ok;
+		ok = test_invert(*k) && ok;
+		ok = test_rotate(*k) && ok;
+		ok = test_mul_vec4_batch(*k) && ok;
+	}
+
+	return ok ? 0 : 1;
+}
\ No newline at end of file
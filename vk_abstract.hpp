@@ -2,6 +2,7 @@
 #define VK_ABSTRACT_HPP
 
 #include "common.hpp"
+#include "ktransform.hpp"
 #include <vector>
 
 struct vk_buffer_t {
@@ -43,10 +44,21 @@ struct vk_pipeline_t {
 
 struct transform_t {
 	vec3 position;
-	vec3 rotation;
+	quat rotation;
 	vec3 scale;
 };
 
+inline void transform_init(transform_t & transform) {
+	transform.position[0] = transform.position[1] = transform.position[2] = 0.0f;
+	quat_identity(transform.rotation);
+	transform.scale[0] = transform.scale[1] = transform.scale[2] = 1.0f;
+}
+
+/* models are built from the soa, a slot set this way is rebuilt and uploaded on the next update */
+inline void transform_to_soa(ktransform_soa_t & soa, uint32_t index, const transform_t & transform) {
+	ktransform_soa_set(&soa, index, transform.position, transform.rotation, transform.scale);
+}
+
 struct mesh_t {
 	vk_mesh_t mesh;
 	vk_pipeline_t * pipeline;
@@ -0,0 +1,5227 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <limits>
+#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "vk_abstract.hpp"
+#include "kobj.hpp"
+#include "kstats.hpp"
+
+#include <cstring>
+#include <cstdlib>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static void vk_destroy_frame_cmds(vulkan_t & vulkan, vk_frame_cmds_t & frame_cmds);
+static void vk_stream_begin(vulkan_t & vulkan, VkDeviceSize frame_budget);
+
+float counter = 0;
+
+static void vk_next_frame(vulkan_t & vulkan) {
+	++vulkan.current_frame;
+	if (vulkan.current_frame >= vulkan.frames_in_flight) {
+		vulkan.current_frame = 0;
+	}
+}
+
+// the graph has the offscreen image in TRANSFER_SRC_OPTIMAL by now, the host reads the buffer once the frame is done
+static void vk_record_readback(vulkan_t & vulkan, VkCommandBuffer cmd) {
+	VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+		.imageOffset = { 0, 0, 0 },
+		.imageExtent = { vulkan.swapchain_extent.width, vulkan.swapchain_extent.height, 1 },
+	};
+	vkCmdCopyImageToBuffer(cmd, vulkan.offscreen.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, vulkan.readback_buffer, 1, &region);
+
+	vk_barrier_batch_t barriers;
+	barriers.memory.push_back({
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT,
+		.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT,
+	});
+	vk_barrier_flush(vulkan, barriers, cmd);
+}
+
+void vk_draw_frame(vulkan_t & vulkan) {
+	++counter;
+	// headless runs only start the clock once the assets are in, so every run draws the same frames
+	if (vulkan.headless && !vk_loader_idle(vulkan)) {
+		counter = 0;
+	}
+	#ifdef _WIN32
+	if (!vulkan.headless) {
+		RECT rect;
+		RECT borders;
+		if (GetWindowRect(vulkan.hwnd, &rect) == 0) { return; }
+		AdjustWindowRectEx(&borders, WS_OVERLAPPEDWINDOW, FALSE, 0);
+		LONG bw = (borders.right - borders.left);
+		LONG bh = (borders.bottom - borders.top);
+		LONG wwb = rect.right - rect.left;
+		LONG hwb = rect.bottom - rect.top;
+		LONG width = wwb - bw;
+		LONG height = hwb - bh;
+
+		vulkan.window_width = static_cast<uint32_t>(width);
+		vulkan.window_height = static_cast<uint32_t>(height);
+
+		if (width <= 0 || height <= 0 || wwb <= 0 || hwb <= 0) {
+			return;
+		}
+	}
+	#endif
+
+	vk_timeline_wait(vulkan, vulkan.graphics_timeline, vulkan.frame_values[vulkan.current_frame]);
+
+	vk_reset_frame_cmds(vulkan);
+
+	// the gpu is done with this frame's slice of the ring now
+	vk_uniform_ring_begin(vulkan);
+	vk_query_memory_budget(vulkan);
+	vk_defrag_step(vulkan);
+	vk_loader_update(vulkan);
+
+	vulkan.draws.clear();
+	if (vulkan.bench != nullptr) {
+		vk_bench_scene(vulkan, *vulkan.bench, counter / 15);
+	} else {
+		{
+			ktransform_soa_t & soa = vulkan.transforms;
+			quat spin;
+			vec3 up = { 0, 1, 0 };
+			quat_rotate(spin, counter / 15, up);
+			for (uint32_t i = 0; i < 4; ++i) {
+				soa.rotation[i][0] = spin[i];
+			}
+			ktransform_soa_touch(&soa, 0);
+
+			mat4x4 view;
+			mat4x4_identity(view);
+			view[1][1] *= -1;
+			mat4x4 proj;
+			float aspect = static_cast<float>(vulkan.swapchain_extent.width) / static_cast<float>(vulkan.swapchain_extent.height);
+			mat4x4_perspective(proj, 1, aspect, 0.05f, 100.0f);
+			//mat4x4_ortho(proj, -1, 1, 1 / -aspect, 1 / aspect, -100, 100);
+
+			// the slot keeps its uniform between frames, it's only rewritten in the frames that have an older one
+			vk_update_object_uniforms(vulkan, vulkan.object_uniforms, soa, vulkan.models, view, proj, 1);
+		}
+
+		// the mesh is still loading, the pass only clears
+		if (vulkan.mesh_index_count != 0) {
+			vulkan.draws.push_back({
+				.mesh_buffer = vulkan.mesh_buffer,
+				.index_offset = sizeof(vertex_t) * vulkan.mesh_vertex_count,
+				.index_count = vulkan.mesh_index_count,
+				.first_index = 0,
+				.vertex_offset = 0,
+				.unif_offset = vk_object_uniform_offset(vulkan, vulkan.object_uniforms, 0),
+				.desc_set = VK_NULL_HANDLE,
+			});
+		}
+	}
+
+	vk_stream_textures(vulkan);
+
+	uint32_t image_index = 0;
+	std::vector<vk_timeline_wait_t> waits;
+	if (!vulkan.headless) {
+		vkAcquireNextImageKHR(vulkan.device, vulkan.swapchain, std::numeric_limits<uint64_t>::max(), vulkan.semaphores_img_avail[vulkan.current_frame], VK_NULL_HANDLE, &image_index);
+		waits.push_back({ vulkan.semaphores_img_avail[vulkan.current_frame], 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+	}
+
+	VkCommandBuffer cmd = vk_frame_cmd(vulkan);
+	vk_begin_cmd(vulkan, cmd);
+	vk_frame_timestamp(vulkan, cmd, false);
+
+	// ownership acquires for what finished uploading go out with the first pass's barriers
+	vk_graph_t & graph = vulkan.frame_graph;
+	vk_graph_begin(vulkan, graph);
+	vk_staging_acquire(vulkan, graph.barriers, waits);
+
+	uint32_t backbuffer;
+	if (vulkan.headless) {
+		// the offscreen image carries over what the previous frame left it in, ready to be copied out
+		backbuffer = vk_graph_import(graph, vulkan.offscreen.image, vulkan.offscreen.view, vulkan.swapchain_format, vulkan.swapchain_extent, vulkan.offscreen.state, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+	} else {
+		// the acquire semaphore is waited on at color output, so the image's last use is ordered there
+		kgraph_state_t acquired = {
+			.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+			.write_stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+			.write_access = 0,
+			.read_stages = 0,
+			.visible_stages = 0,
+			.visible_access = 0,
+		};
+		backbuffer = vk_graph_import(graph, vulkan.swapchain_images[image_index], vulkan.swapchain_views[image_index], vulkan.swapchain_format, vulkan.swapchain_extent, acquired, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	}
+	uint32_t depth = vk_graph_transient(graph, VK_FORMAT_D32_SFLOAT, vulkan.swapchain_extent);
+
+	VkClearValue clears[2] = {
+		{ { { 0.1f, 0.1f, 0.1f, 1.0f } } },
+		{ 1.0f, 0.0f },
+	};
+
+	uint32_t main_pass = vk_graph_pass(graph, "main", false, [](vulkan_t & vulkan, VkCommandBuffer cmd, const VkRenderPassBeginInfo * rp_info) {
+		vk_record_pass(vulkan, cmd, *rp_info);
+	});
+	kgraph_write(&graph.graph, main_pass, backbuffer, KGRAPH_USAGE_COLOR_ATTACHMENT, &clears[0]);
+	kgraph_write(&graph.graph, main_pass, depth, KGRAPH_USAGE_DEPTH_ATTACHMENT, &clears[1]);
+
+	if (vulkan.readback) {
+		uint32_t readback_pass = vk_graph_pass(graph, "readback", true, [](vulkan_t & vulkan, VkCommandBuffer cmd, const VkRenderPassBeginInfo * rp_info) {
+			vk_record_readback(vulkan, cmd);
+		});
+		kgraph_read(&graph.graph, readback_pass, backbuffer, KGRAPH_USAGE_TRANSFER_SRC);
+	}
+
+	vulkan.scissor = {
+		.offset = { 0, 0 },
+		.extent = vulkan.swapchain_extent,
+	};
+
+	vulkan.viewport = {
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(vulkan.swapchain_extent.width),
+		.height = static_cast<float>(vulkan.swapchain_extent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
+	};
+
+	vk_graph_run(vulkan, graph, cmd);
+	vk_frame_timestamp(vulkan, cmd, true);
+	vk_end_cmd(vulkan, cmd);
+
+	std::chrono::steady_clock::time_point submit_start = std::chrono::steady_clock::now();
+	VkSemaphore render_finished = vulkan.headless ? VK_NULL_HANDLE : vulkan.semaphores_render_finished[vulkan.current_frame];
+	vulkan.frame_values[vulkan.current_frame] = vk_timeline_submit(vulkan, vulkan.graphics_timeline, cmd, waits, render_finished);
+	vulkan.submit_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - submit_start).count();
+
+	if (vulkan.headless) {
+		vulkan.offscreen.state = graph.graph.states[backbuffer];
+		vk_next_frame(vulkan);
+		return;
+	}
+
+	VkPresentInfoKHR present_info = {
+		.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+		.pNext = nullptr,
+		.waitSemaphoreCount = 1,
+		.pWaitSemaphores = &vulkan.semaphores_render_finished[vulkan.current_frame],
+		.swapchainCount = 1,
+		.pSwapchains = &vulkan.swapchain,
+		.pImageIndices = &image_index,
+		.pResults = nullptr,
+	};
+
+	VK_CALL(vkQueuePresentKHR(vulkan.present_queue, &present_info));
+
+	vk_next_frame(vulkan);
+}
+
+void vk_init(vulkan_t & vulkan) {
+	VkApplicationInfo app_info = {
+		.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+		.pNext = nullptr,
+		.pApplicationName = "krisvers' Vulkan playground",
+		.applicationVersion = VK_MAKE_VERSION(1, 0, 0),
+		.pEngineName = "none",
+		.engineVersion = VK_MAKE_VERSION(1, 3, 0),
+		.apiVersion = VK_API_VERSION_1_3,
+	};
+
+	std::vector<layer_t> requested_instance_layers;
+	std::vector<extension_t> requested_instance_extensions;
+
+	#ifdef VK_DEBUG
+	requested_instance_layers.push_back({ "VK_LAYER_KHRONOS_validation", false });
+	requested_instance_extensions.push_back({ VK_EXT_DEBUG_UTILS_EXTENSION_NAME, false });
+	#endif
+
+	if (!vulkan.headless) {
+		requested_instance_extensions.push_back({ VK_KHR_SURFACE_EXTENSION_NAME, true });
+		#ifdef _WIN32
+		requested_instance_extensions.push_back({ "VK_KHR_win32_surface", true });
+		#endif
+	}
+
+	vk_create_instance(vulkan, app_info, requested_instance_layers, requested_instance_extensions);
+
+	std::vector<layer_t> requested_device_layers;
+	std::vector<extension_t> requested_device_extensions = { { VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, false } };
+	if (!vulkan.headless) {
+		requested_device_extensions.push_back({ VK_KHR_SWAPCHAIN_EXTENSION_NAME, true });
+	}
+
+	#ifdef VK_DEBUG
+	requested_device_layers.push_back({ "VK_LAYER_KHRONOS_validation", false });
+	#endif
+
+	if (!vulkan.headless) {
+		vk_create_surface(vulkan);
+	}
+
+	vk_create_physical(
+		vulkan,
+
+		[](const VkPhysicalDevice & device) {
+			int64_t score = 0;
+
+			VkPhysicalDeviceProperties props;
+			vkGetPhysicalDeviceProperties(device, &props);
+
+			if (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
+				score += 1000;
+			}
+
+			score += props.limits.maxImageDimension2D;
+			score += static_cast<int64_t>(props.limits.maxFramebufferWidth * props.limits.maxFramebufferHeight) * 0.01f;
+
+			return score;
+		}
+	);
+
+	vk_create_device(vulkan, requested_device_layers, requested_device_extensions);
+
+	if (vulkan.headless) {
+		vk_create_offscreen(vulkan);
+	} else {
+		vk_create_swapchain(
+			vulkan,
+
+			[](const std::vector<VkSurfaceFormatKHR> & formats) {
+				for (size_t i = 0; i < formats.size(); ++i) {
+					if (formats[i].format == VK_FORMAT_B8G8R8A8_SRGB && formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+						return i;
+					}
+				}
+
+				return static_cast<size_t>(0);
+			},
+
+			[](const std::vector<VkPresentModeKHR> & modes) {
+				size_t fifo_index = 0ULL;
+				for (size_t i = 0; i < modes.size(); ++i) {
+					switch (modes[i]) {
+					case VK_PRESENT_MODE_FIFO_KHR:
+						fifo_index = i;
+						break;
+					case VK_PRESENT_MODE_MAILBOX_KHR:
+						return i;
+					default: break;
+					}
+				}
+
+				return fifo_index;
+			},
+
+			[](const VkSurfaceCapabilitiesKHR & capabilities) {
+				return VkExtent2D{ capabilities.currentExtent.width, capabilities.currentExtent.height };
+			},
+
+			[](uint32_t min, uint32_t max) {
+				uint32_t target = 2;
+				return std::max(std::min(target, max), min);
+			}
+		);
+	}
+
+	vk_init_render_pass(vulkan);
+
+	std::vector<unsigned char> v_spv;
+	std::vector<unsigned char> f_spv;
+	{
+		std::ifstream file("vert.spv", std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "Failed to open vert.spv\n";
+			throw std::runtime_error("Failed to open vert.spv");
+		}
+
+		size_t size = file.tellg();
+		v_spv.resize(size);
+		file.seekg(0);
+		file.read(reinterpret_cast<char *>(v_spv.data()), size);
+		file.close();
+
+		file.open("frag.spv", std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			std::cout << "Failed to open frag.spv\n";
+			throw std::runtime_error("Failed to open frag.spv");
+		}
+
+		size = file.tellg();
+		f_spv.resize(size);
+		file.seekg(0);
+		file.read(reinterpret_cast<char *>(f_spv.data()), size);
+		file.close();
+	}
+
+	vk_init_pipeline(vulkan, v_spv, f_spv);
+	vk_create_command_utils(vulkan);
+	vk_create_staging(vulkan);
+	bool textured = vk_create_texture_container(vulkan, "test.ktx2");
+	vk_create_placeholders(vulkan);
+	vk_create_uniform_ring(vulkan);
+	vk_create_descriptor_utilities(vulkan);
+	vk_create_semaphores(vulkan);
+
+	if (ktransform_soa_create(&vulkan.transforms, 1) != 0) {
+		std::cout << "Failed to create the scene transforms\n";
+		throw std::runtime_error("Failed to create the scene transforms");
+	}
+	vulkan.models = new mat4x4[vulkan.transforms.count];
+	{
+		float position[3] = { 0.0f, 0.0f, -1.0f };
+		float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float scale[3] = { 0.1f, 0.1f, 0.1f };
+		ktransform_soa_set(&vulkan.transforms, 0, position, rotation, scale);
+	}
+	vk_create_object_uniforms(vulkan, vulkan.object_uniforms, vulkan.transforms.count);
+
+	// the first frames draw with the placeholders while these are read and uploaded
+	vk_loader_start(vulkan);
+	vk_loader_queue(vulkan, ASSET_KIND_MESH, "test.obj");
+	if (!textured) {
+		vk_loader_queue(vulkan, ASSET_KIND_TEXTURE, "test.tga");
+	}
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan memory after init: " << vk_memory_stats_json(vulkan) << "\n";
+	#endif
+}
+
+void vk_deinit(vulkan_t & vulkan) {
+	vkDeviceWaitIdle(vulkan.device);
+
+	vk_loader_stop(vulkan);
+
+	vk_defrag_flush(vulkan);
+	vulkan.defrag.movables.clear();
+
+	for (uint32_t i = 0; i < vulkan.frames_in_flight; ++i) {
+		vkDestroySemaphore(vulkan.device, vulkan.semaphores_render_finished[i], vulkan.allocator);
+		vkDestroySemaphore(vulkan.device, vulkan.semaphores_img_avail[i], vulkan.allocator);
+	}
+	vulkan.frame_values.clear();
+
+	vkDestroyDescriptorPool(vulkan.device, vulkan.desc_pool, vulkan.allocator);
+
+	vkDestroySampler(vulkan.device, vulkan.texture_sampler, vulkan.allocator);
+	vkDestroyImageView(vulkan.device, vulkan.texture_view, vulkan.allocator);
+
+	for (std::pair<VkSampler, uint64_t> & retired : vulkan.texture_stream.retired_samplers) {
+		vkDestroySampler(vulkan.device, retired.first, vulkan.allocator);
+	}
+
+	if (vulkan.texture_stream.file.data != nullptr) {
+		ktex_destroy(&vulkan.texture_stream.ktex);
+		unmap_file(vulkan.texture_stream.file);
+	}
+
+	vkDestroyImage(vulkan.device, vulkan.texture, vulkan.allocator);
+	vk_free_memory(vulkan, vulkan.texture_memory);
+
+	vk_destroy_uniform_ring(vulkan);
+
+	vkDestroyBuffer(vulkan.device, vulkan.mesh_buffer, vulkan.allocator);
+	vk_free_memory(vulkan, vulkan.mesh_memory);
+
+	ktransform_soa_destroy(&vulkan.transforms);
+	delete[] vulkan.models;
+	vulkan.models = nullptr;
+
+	vk_destroy_graph_cache(vulkan);
+	if (vulkan.headless) {
+		vk_destroy_offscreen(vulkan);
+	}
+
+	vk_destroy_staging(vulkan);
+	vk_destroy_memory_pools(vulkan);
+
+	vkDestroyCommandPool(vulkan.device, vulkan.transfer_cmd_pool, vulkan.allocator);
+	for (vk_frame_cmds_t & frame_cmds : vulkan.frame_cmds) {
+		vk_destroy_frame_cmds(vulkan, frame_cmds);
+	}
+	vulkan.frame_cmds.clear();
+
+	vkDestroyPipeline(vulkan.device, vulkan.pipeline, vulkan.allocator);
+	vkDestroyPipelineLayout(vulkan.device, vulkan.pipeline_layout, vulkan.allocator);
+	vkDestroyDescriptorSetLayout(vulkan.device, vulkan.desc_layout, vulkan.allocator);
+
+	vkDestroyShaderModule(vulkan.device, vulkan.fragment_shader, vulkan.allocator);
+	vkDestroyShaderModule(vulkan.device, vulkan.vertex_shader, vulkan.allocator);
+
+	for (uint32_t i = 0; i < vulkan.swapchain_image_count; ++i) {
+		vkDestroyImageView(vulkan.device, vulkan.swapchain_views[i], vulkan.allocator);
+	}
+
+	vk_destroy_timeline(vulkan, vulkan.transfer_timeline);
+	vk_destroy_timeline(vulkan, vulkan.graphics_timeline);
+
+	if (!vulkan.headless) {
+		vkDestroySwapchainKHR(vulkan.device, vulkan.swapchain, vulkan.allocator);
+	}
+	vkDestroyDevice(vulkan.device, vulkan.allocator);
+	if (!vulkan.headless) {
+		vkDestroySurfaceKHR(vulkan.instance, vulkan.surface, vulkan.allocator);
+	}
+
+	if (vulkan.debug_messenger != VK_NULL_HANDLE) {
+		PFN_vkDestroyDebugUtilsMessengerEXT vkDestroyDebugUtilsMessengerEXT = reinterpret_cast<PFN_vkDestroyDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(vulkan.instance, "vkDestroyDebugUtilsMessengerEXT"));
+		if (vkDestroyDebugUtilsMessengerEXT == nullptr) {
+			std::cout << "Failed to find vkDestroyDebugUtilsMessengerEXT\n";
+			throw std::runtime_error("Failed to find vkDestroyDebugUtilsMessengerEXT");
+		}
+
+		vkDestroyDebugUtilsMessengerEXT(vulkan.instance, vulkan.debug_messenger, vulkan.allocator);
+	}
+
+	vkDestroyInstance(vulkan.instance, vulkan.allocator);
+}
+
+void vk_create_instance(vulkan_t & vulkan, VkApplicationInfo app_info, const std::vector<layer_t> & requested_layers, const std::vector<extension_t> & requested_extensions) {
+	uint32_t layer_prop_count = 0;
+	VK_CALL(vkEnumerateInstanceLayerProperties(&layer_prop_count, nullptr));
+
+	std::vector<VkLayerProperties> layer_properties(layer_prop_count);
+	VK_CALL(vkEnumerateInstanceLayerProperties(&layer_prop_count, layer_properties.data()));
+
+	std::vector<const char *> layer_names;
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Requested Vulkan instance layers:\n";
+	for (const layer_t & layer : requested_layers) {
+		std::cout << "    " << (layer.required ? "(required) " : "") << layer.name << "\n";
+	}
+	std::cout << '\n';
+	#endif
+
+	for (const layer_t & layer : requested_layers) {
+		bool found = false;
+		for (VkLayerProperties & prop : layer_properties) {
+			if (strcmp(prop.layerName, layer.name) == 0) {
+				found = true;
+				layer_names.push_back(layer.name);
+				break;
+			}
+		}
+
+		if (!found) {
+			if (layer.required) {
+				std::cout << "Failed to find required Vulkan instance layer: " << layer.name << "\n";
+				throw std::runtime_error("Failed to find required Vulkan instance layer");
+			}
+		}
+	}
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan instance layers:\n";
+	for (VkLayerProperties & prop : layer_properties) {
+		char c = ' ';
+		for (const char *& name : layer_names) {
+			if (strcmp(prop.layerName, name) == 0) {
+				c = 'X';
+				break;
+			}
+		}
+
+		std::cout << '[' << c << ']' << " " << prop.layerName << "\n";
+		std::cout << "     " << prop.description << "\n";
+		std::cout << "     Specification version: " << VK_UNMAKE_VERSION_MAJOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_MINOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_PATCH(prop.specVersion) << ", implementation version: " << VK_UNMAKE_VERSION_MAJOR(prop.implementationVersion) << "." << VK_UNMAKE_VERSION_MINOR(prop.implementationVersion) << "." << VK_UNMAKE_VERSION_PATCH(prop.implementationVersion) << "\n\n";
+	}
+	#endif
+
+	uint32_t extension_prop_count = 0;
+	VK_CALL(vkEnumerateInstanceExtensionProperties(nullptr, &extension_prop_count, nullptr));
+
+	std::vector<VkExtensionProperties> extension_props(extension_prop_count);
+	VK_CALL(vkEnumerateInstanceExtensionProperties(nullptr, &extension_prop_count, extension_props.data()));
+
+	std::vector<const char *> extension_names;
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Requested Vulkan instance extension:\n";
+	for (const extension_t & extension : requested_extensions) {
+		std::cout << "    " << (extension.required ? "(required) " : "") << extension.name << "\n";
+	}
+	std::cout << '\n';
+	#endif
+
+	for (const extension_t & extension : requested_extensions) {
+		bool found = false;
+		for (VkExtensionProperties & prop : extension_props) {
+			if (strcmp(prop.extensionName, extension.name) == 0) {
+				found = true;
+				extension_names.push_back(extension.name);
+				break;
+			}
+		}
+
+
+		if (!found) {
+			if (extension.required) {
+				std::cout << "Failed to find required Vulkan instance extension: " << extension.name << "\n";
+				throw std::runtime_error("Failed to find required Vulkan instance extension");
+			}
+		}
+	}
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan instance extensions:\n";
+	for (VkExtensionProperties & prop : extension_props) {
+		char c = ' ';
+		for (const char *& name : extension_names) {
+			if (strcmp(prop.extensionName, name) == 0) {
+				c = 'X';
+				break;
+			}
+		}
+
+		std::cout << '[' << c << ']' << " " << prop.extensionName << "\n";
+		std::cout << "     Specification version: " << VK_UNMAKE_VERSION_MAJOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_MINOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_PATCH(prop.specVersion) << "\n\n";
+	}
+	#endif
+
+	VkInstanceCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.pApplicationInfo = &app_info,
+		.enabledLayerCount = static_cast<uint32_t>(layer_names.size()),
+		.ppEnabledLayerNames = layer_names.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(extension_names.size()),
+		.ppEnabledExtensionNames = extension_names.data(),
+	};
+
+	VK_CALL(vkCreateInstance(&create_info, vulkan.allocator, &vulkan.instance));
+
+	if (extension_names.size() > 0) {
+		for (const char *& name : extension_names) {
+			if (strcmp(name, VK_EXT_DEBUG_UTILS_EXTENSION_NAME) == 0) {
+				PFN_vkCreateDebugUtilsMessengerEXT vkCreateDebugUtilsMessengerEXT = reinterpret_cast<PFN_vkCreateDebugUtilsMessengerEXT>(vkGetInstanceProcAddr(vulkan.instance, "vkCreateDebugUtilsMessengerEXT"));
+				if (vkCreateDebugUtilsMessengerEXT == nullptr) {
+					std::cout << "Failed to find vkCreateDebugUtilsMessengerEXT\n";
+					throw std::runtime_error("Failed to find vkCreateDebugUtilsMessengerEXT");
+				}
+
+				VkDebugUtilsMessengerCreateInfoEXT create_info = {
+					.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+					.pNext = nullptr,
+					.flags = 0,
+					.messageSeverity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT,
+					.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+
+					.pfnUserCallback = [](VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT * callback_data, void * user_data) -> VkBool32 {
+						std::cout << "Vulkan debug message: " << callback_data->pMessage << "\n";
+
+						if (message_severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+							return VK_TRUE;
+						}
+
+						return VK_FALSE;
+					},
+
+					.pUserData = nullptr,
+				};
+
+				VK_CALL(vkCreateDebugUtilsMessengerEXT(vulkan.instance, &create_info, vulkan.allocator, &vulkan.debug_messenger));
+				#ifdef VK_DEBUG_INFO
+				std::cout << "Registered Vulkan debug messenger\n";
+				#endif
+			}
+		}
+	}
+}
+
+void vk_create_physical(vulkan_t & vulkan, std::function<int64_t(const VkPhysicalDevice &)> score_func) {
+	uint32_t physical_count = 0;
+	vkEnumeratePhysicalDevices(vulkan.instance, &physical_count, nullptr);
+
+	if (physical_count == 0) {
+		std::cout << "Failed to find any Vulkan physical devices\n";
+		throw std::runtime_error("Failed to find any Vulkan physical devices");
+	}
+
+	std::vector<VkPhysicalDevice> physical_devices(physical_count);
+	vkEnumeratePhysicalDevices(vulkan.instance, &physical_count, physical_devices.data());
+
+	int64_t best_score = -1;
+	size_t best_index = std::numeric_limits<size_t>::max();
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan physical devices:\n";
+	#endif
+	for (size_t i = 0; i < physical_devices.size(); ++i) {
+		int64_t score = score_func(physical_devices[i]);
+
+		if (score != -1) {
+			if (score > best_score) {
+				best_score = score;
+				best_index = i;
+			}
+		}
+
+		#ifdef VK_DEBUG_INFO
+		VkPhysicalDevice & dev = physical_devices[i];
+
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(dev, &props);
+
+		uint32_t queue_family_count = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(dev, &queue_family_count, nullptr);
+
+		std::vector<VkQueueFamilyProperties> queue_family_props(queue_family_count);
+		vkGetPhysicalDeviceQueueFamilyProperties(dev, &queue_family_count, queue_family_props.data());
+
+		char c = ' ';
+		if (&physical_devices[best_index] == &dev) {
+			c = 'X';
+		}
+		std::cout << "    " << props.deviceName << " [" << score << "]";
+		switch (props.deviceType) {
+			case VK_PHYSICAL_DEVICE_TYPE_OTHER:
+				std::cout << " (Other)\n";
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+				std::cout << " (Integrated GPU)\n";
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+				std::cout << " (Discrete GPU)\n";
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+				std::cout << " (Virtual GPU)\n";
+				break;
+			case VK_PHYSICAL_DEVICE_TYPE_CPU:
+				std::cout << " (CPU)\n";
+				break;
+			default:
+				std::cout << " (Unknown)\n";
+				break;
+		}
+
+		std::cout << "     Vendor ID: " << props.vendorID << "\n";
+		std::cout << "     Device ID: " << props.deviceID << "\n";
+		std::cout << "     API version: " << VK_UNMAKE_VERSION_MAJOR(props.apiVersion) << "." << VK_UNMAKE_VERSION_MINOR(props.apiVersion) << "." << VK_UNMAKE_VERSION_PATCH(props.apiVersion) << "\n";
+		std::cout << "     Driver version: " << VK_UNMAKE_VERSION_MAJOR(props.driverVersion) << "." << VK_UNMAKE_VERSION_MINOR(props.driverVersion) << "." << VK_UNMAKE_VERSION_PATCH(props.driverVersion) << "\n";
+		std::cout << "     Limits:\n";
+		std::cout << "       Max image dimension 1D: " << props.limits.maxImageDimension1D << "\n";
+		std::cout << "       Max image dimension 2D: " << props.limits.maxImageDimension2D << "\n";
+		std::cout << "       Max image dimension 3D: " << props.limits.maxImageDimension3D << "\n\n";
+		std::cout << "     Queue families:\n";
+		for (size_t i = 0; i < queue_family_props.size(); ++i) {
+			VkQueueFamilyProperties & prop = queue_family_props[i];
+			std::cout << "       Family " << i << "\n";
+			std::cout << "         Count: " << prop.queueCount << "\n";
+			c = ' ';
+			if (prop.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				c = 'X';
+			}
+			std::cout << "           [" << c << "] Graphics\n";
+
+			c = ' ';
+			if (prop.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+				c = 'X';
+			}
+			std::cout << "           [" << c << "] Compute\n";
+
+			c = ' ';
+			if (prop.queueFlags & VK_QUEUE_TRANSFER_BIT) {
+				c = 'X';
+			}
+			std::cout << "           [" << c << "] Transfer\n";
+
+			c = ' ';
+			if (prop.queueFlags & VK_QUEUE_PROTECTED_BIT) {
+				c = 'X';
+			}
+			std::cout << "           [" << c << "] Protected\n";
+
+			c = ' ';
+			if (prop.queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) {
+				c = 'X';
+			}
+			std::cout << "           [" << c << "] Sparse Binding\n";
+
+			VkBool32 present = VK_FALSE;
+			if (!vulkan.headless) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(dev, i, vulkan.surface, &present);
+			}
+
+			c = ' ';
+			if (present) {
+				c = 'X';
+			}
+			std::cout << "           [" << c << "] Present\n";
+		}
+		std::cout << '\n';
+		#endif
+	}
+
+	if (best_index == std::numeric_limits<size_t>::max()) {
+		std::cout << "Failed to find any suitable Vulkan physical devices\n";
+		throw std::runtime_error("Failed to find any suitable Vulkan physical devices");
+	}
+
+	vulkan.physical = physical_devices[best_index];
+	vk_query_device_caps(vulkan);
+}
+
+// -1 if the type can't serve the usage at all, otherwise higher is better
+static int32_t vk_memory_type_score(VkMemoryPropertyFlags flags, vk_memory_usage_t usage) {
+	if (flags & VK_MEMORY_PROPERTY_PROTECTED_BIT) {
+		return -1;
+	}
+
+	// lazily allocated types only take transient attachments, which can still use anything device local
+	bool lazily_allocated = flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	if (lazily_allocated && usage != MEMORY_USAGE_TRANSIENT) {
+		return -1;
+	}
+
+	bool device_local = flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	bool host_visible = flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+	bool host_coherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	bool host_cached = flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+
+	switch (usage) {
+		case MEMORY_USAGE_DEVICE:
+			// host visible device memory is the bar window, leave it to the usages that map it
+			return (device_local ? 4 : 0) + (!host_visible ? 2 : 0) + (!host_cached ? 1 : 0);
+		case MEMORY_USAGE_UPLOAD:
+			// mapped pointers are written without flushes, so everything the cpu touches has to be coherent
+			if (!host_visible || !host_coherent) {
+				return -1;
+			}
+			return (!device_local ? 2 : 0) + (!host_cached ? 1 : 0);
+		case MEMORY_USAGE_READBACK:
+			if (!host_visible || !host_coherent) {
+				return -1;
+			}
+			return (host_cached ? 2 : 0) + (!device_local ? 1 : 0);
+		case MEMORY_USAGE_REBAR:
+			if (!host_visible || !host_coherent) {
+				return -1;
+			}
+			return (device_local ? 2 : 0) + (!host_cached ? 1 : 0);
+		case MEMORY_USAGE_TRANSIENT:
+			return (lazily_allocated ? 8 : 0) + (device_local ? 4 : 0) + (!host_visible ? 2 : 0) + (!host_cached ? 1 : 0);
+		default:
+			return -1;
+	}
+}
+
+void vk_query_device_caps(vulkan_t & vulkan) {
+	vk_device_caps_t & caps = vulkan.caps;
+	vkGetPhysicalDeviceProperties(vulkan.physical, &caps.props);
+	vkGetPhysicalDeviceFeatures(vulkan.physical, &caps.feats);
+	vkGetPhysicalDeviceMemoryProperties(vulkan.physical, &caps.memory);
+
+	// core since 1.2 and 1.3, but only as features the device may leave out
+	caps.timeline_semaphore = false;
+	caps.synchronization2 = false;
+	if (caps.props.apiVersion >= VK_API_VERSION_1_2) {
+		VkPhysicalDeviceSynchronization2Features sync2_feats = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+			.pNext = nullptr,
+		};
+		VkPhysicalDeviceTimelineSemaphoreFeatures timeline_feats = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+			.pNext = caps.props.apiVersion >= VK_API_VERSION_1_3 ? &sync2_feats : nullptr,
+		};
+		VkPhysicalDeviceFeatures2 feats2 = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+			.pNext = &timeline_feats,
+		};
+		vkGetPhysicalDeviceFeatures2(vulkan.physical, &feats2);
+		caps.timeline_semaphore = timeline_feats.timelineSemaphore == VK_TRUE;
+		caps.synchronization2 = sync2_feats.synchronization2 == VK_TRUE;
+	}
+	vkGetPhysicalDeviceFormatProperties(vulkan.physical, VK_FORMAT_D32_SFLOAT, &caps.depth_format);
+
+	// types are ranked by score, ties keep the driver's order which the spec sorts by performance
+	for (uint32_t usage = 0; usage < MEMORY_USAGE_COUNT; ++usage) {
+		int32_t scores[VK_MAX_MEMORY_TYPES];
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < caps.memory.memoryTypeCount; ++i) {
+			scores[i] = vk_memory_type_score(caps.memory.memoryTypes[i].propertyFlags, static_cast<vk_memory_usage_t>(usage));
+			if (scores[i] >= 0) {
+				caps.usage_types[usage][count++] = i;
+			}
+		}
+
+		std::stable_sort(caps.usage_types[usage], caps.usage_types[usage] + count, [&scores](uint32_t a, uint32_t b) {
+			return scores[a] > scores[b];
+		});
+		caps.usage_type_count[usage] = count;
+	}
+
+	// without resizable bar the device local host visible heap is a 256MB window
+	caps.rebar = false;
+	for (uint32_t i = 0; i < caps.memory.memoryTypeCount; ++i) {
+		VkMemoryPropertyFlags flags = caps.memory.memoryTypes[i].propertyFlags;
+		if ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && caps.memory.memoryHeaps[caps.memory.memoryTypes[i].heapIndex].size > 256 * 1024 * 1024) {
+			caps.rebar = true;
+		}
+	}
+
+	// integrated and cpu devices can map all of their memory, a discrete one only with resizable bar
+	caps.direct_upload = false;
+	if (caps.usage_type_count[MEMORY_USAGE_REBAR] != 0) {
+		VkMemoryPropertyFlags flags = caps.memory.memoryTypes[caps.usage_types[MEMORY_USAGE_REBAR][0]].propertyFlags;
+		bool uma = caps.props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || caps.props.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+		caps.direct_upload = (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) && (caps.rebar || uma);
+	}
+
+	#ifdef VK_DEBUG_INFO
+	const char * usage_names[MEMORY_USAGE_COUNT] = { "device", "upload", "readback", "rebar", "transient" };
+	std::cout << "Vulkan memory types by usage (resizable bar: " << (caps.rebar ? "yes" : "no") << ", direct upload: " << (caps.direct_upload ? "yes" : "no") << "):\n";
+	for (uint32_t usage = 0; usage < MEMORY_USAGE_COUNT; ++usage) {
+		std::cout << "    " << usage_names[usage] << ":";
+		for (uint32_t i = 0; i < caps.usage_type_count[usage]; ++i) {
+			std::cout << " " << caps.usage_types[usage][i];
+		}
+		std::cout << "\n";
+	}
+	#endif
+}
+
+void vk_create_device(vulkan_t & vulkan, std::vector<layer_t> & requested_layers, std::vector<extension_t> & requested_extensions) {
+	uint32_t queue_family_count = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(vulkan.physical, &queue_family_count, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queue_family_props(queue_family_count);
+	vkGetPhysicalDeviceQueueFamilyProperties(vulkan.physical, &queue_family_count, queue_family_props.data());
+
+	vulkan.graphics_family = std::numeric_limits<uint32_t>::max();
+	vulkan.present_family = std::numeric_limits<uint32_t>::max();
+	for (uint32_t i = 0; i < queue_family_props.size(); ++i) {
+		if (queue_family_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+			vulkan.graphics_family = i;
+			#ifdef VK_DEBUG_INFO
+			std::cout << "Found Vulkan graphics queue family: " << i << "\n";
+			#endif
+		}
+
+		// nothing is presented headless, the graphics family stands in so the queue setup stays the same
+		VkBool32 present = VK_FALSE;
+		if (vulkan.headless) {
+			present = (queue_family_props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) ? VK_TRUE : VK_FALSE;
+		} else {
+			vkGetPhysicalDeviceSurfaceSupportKHR(vulkan.physical, i, vulkan.surface, &present);
+		}
+
+		if (present) {
+			vulkan.present_family = i;
+			#ifdef VK_DEBUG_INFO
+			std::cout << "Found Vulkan present queue family: " << i << "\n";
+			#endif
+		}
+
+		if (vulkan.graphics_family != std::numeric_limits<uint32_t>::max() && vulkan.present_family != std::numeric_limits<uint32_t>::max()) {
+			break;
+		}
+	}
+
+	if (vulkan.graphics_family == std::numeric_limits<uint32_t>::max()) {
+		std::cout << "Failed to find any Vulkan graphics queue family\n";
+		throw std::runtime_error("Failed to find any Vulkan graphics queue family");
+	}
+
+	if (vulkan.present_family == std::numeric_limits<uint32_t>::max()) {
+		std::cout << "Failed to find any Vulkan present queue family\n";
+		throw std::runtime_error("Failed to find any Vulkan present queue family");
+	}
+
+	vulkan.caps.timestamp_bits = queue_family_props[vulkan.graphics_family].timestampValidBits;
+	
+	uint32_t layer_prop_count = 0;
+	vkEnumerateDeviceLayerProperties(vulkan.physical, &layer_prop_count, nullptr);
+
+	std::vector<VkLayerProperties> layer_props(layer_prop_count);
+	vkEnumerateDeviceLayerProperties(vulkan.physical, &layer_prop_count, layer_props.data());
+
+	std::vector<const char *> layer_names;
+	for (layer_t & layer : requested_layers) {
+		bool found = false;
+		for (VkLayerProperties & prop : layer_props) {
+			if (strcmp(prop.layerName, layer.name) == 0) {
+				found = true;
+				layer_names.push_back(layer.name);
+				break;
+			}
+		}
+
+		if (!found) {
+			if (layer.required) {
+				std::cout << "Failed to find required Vulkan device layer: " << layer.name << "\n";
+				throw std::runtime_error("Failed to find required Vulkan device layer");
+			}
+		}
+	}
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan device layer:\n";
+	for (VkLayerProperties & prop : layer_props) {
+		char c = ' ';
+		for (const char *& name : layer_names) {
+			if (strcmp(prop.layerName, name) == 0) {
+				c = 'X';
+				break;
+			}
+		}
+
+		std::cout << '[' << c << ']' << " " << prop.layerName << "\n";
+		std::cout << "     " << prop.description << "\n";
+		std::cout << "     Specification version: " << VK_UNMAKE_VERSION_MAJOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_MINOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_PATCH(prop.specVersion) << "\n";
+		std::cout << "     Implementation version: " << VK_UNMAKE_VERSION_MAJOR(prop.implementationVersion) << "." << VK_UNMAKE_VERSION_MINOR(prop.implementationVersion) << "." << VK_UNMAKE_VERSION_PATCH(prop.implementationVersion) << "\n\n";
+	}
+	#endif
+
+	uint32_t extension_prop_count = 0;
+	vkEnumerateDeviceExtensionProperties(vulkan.physical, nullptr, &extension_prop_count, nullptr);
+
+	std::vector<VkExtensionProperties> extension_props(extension_prop_count);
+	vkEnumerateDeviceExtensionProperties(vulkan.physical, nullptr, &extension_prop_count, extension_props.data());
+
+	std::vector<const char *> extension_names;
+	for (extension_t & extension : requested_extensions) {
+		bool found = false;
+		for (VkExtensionProperties & prop : extension_props) {
+			if (strcmp(prop.extensionName, extension.name) == 0) {
+				found = true;
+				extension_names.push_back(extension.name);
+				break;
+			}
+		}
+
+		if (!found) {
+			if (extension.required) {
+				std::cout << "Failed to find required Vulkan device extension: " << extension.name << "\n";
+				throw std::runtime_error("Failed to find required Vulkan device extension");
+			}
+		}
+	}
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan device extensions:\n";
+	for (VkExtensionProperties & prop : extension_props) {
+		char c = ' ';
+		for (const char *& name : extension_names) {
+			if (strcmp(prop.extensionName, name) == 0) {
+				c = 'X';
+				break;
+			}
+		}
+
+		std::cout << '[' << c << ']' << " " << prop.extensionName << "\n";
+		std::cout << "     Specification version: " << VK_UNMAKE_VERSION_MAJOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_MINOR(prop.specVersion) << "." << VK_UNMAKE_VERSION_PATCH(prop.specVersion) << "\n\n";
+	}
+	#endif
+
+	// transfer without graphics or compute is a dma engine that copies alongside rendering, but only
+	// one that takes any texel offset can run the banded image uploads
+	vulkan.transfer_family = vulkan.graphics_family;
+	for (uint32_t i = 0; i < queue_family_props.size(); ++i) {
+		const VkQueueFamilyProperties & props = queue_family_props[i];
+		const VkExtent3D & granularity = props.minImageTransferGranularity;
+		if ((props.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(props.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && granularity.width == 1 && granularity.height == 1 && granularity.depth == 1) {
+			vulkan.transfer_family = i;
+			#ifdef VK_DEBUG_INFO
+			std::cout << "Found Vulkan transfer queue family: " << i << "\n";
+			#endif
+			break;
+		}
+	}
+
+	std::vector<uint32_t> queue_families = { vulkan.graphics_family, vulkan.present_family, vulkan.transfer_family };
+
+	float priority = 1.0f;
+	std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
+
+	for (uint32_t family : queue_families) {
+		bool found = false;
+		for (VkDeviceQueueCreateInfo & create_info : queue_create_infos) {
+			if (create_info.queueFamilyIndex == family) {
+				found = true;
+			}
+		}
+
+		if (!found) {
+			queue_create_infos.push_back({
+				.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = 0,
+				.queueFamilyIndex = family,
+				.queueCount = 1,
+				.pQueuePriorities = &priority,
+			});
+		}
+	}
+
+	// the budget is read through vkGetPhysicalDeviceMemoryProperties2, core since 1.1
+	vulkan.caps.memory_budget = false;
+	for (const char * name : extension_names) {
+		if (strcmp(name, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0 && vulkan.caps.props.apiVersion >= VK_API_VERSION_1_1) {
+			vulkan.caps.memory_budget = true;
+		}
+	}
+
+	// 1.2 is the minimum, every queue submit signals a timeline and there is no fallback to fences
+	if (vulkan.caps.props.apiVersion < VK_API_VERSION_1_2) {
+		std::cout << "Device only has Vulkan " << VK_UNMAKE_VERSION_MAJOR(vulkan.caps.props.apiVersion) << "." << VK_UNMAKE_VERSION_MINOR(vulkan.caps.props.apiVersion) << ", 1.2 is required\n";
+		throw std::runtime_error("Device doesn't support Vulkan 1.2");
+	}
+	if (!vulkan.caps.timeline_semaphore) {
+		std::cout << "Device doesn't support timeline semaphores\n";
+		throw std::runtime_error("Device doesn't support timeline semaphores");
+	}
+
+	// barriers are recorded with vkCmdPipelineBarrier2 where there is synchronization2, vkCmdPipelineBarrier otherwise
+	if (!vulkan.caps.synchronization2 && !vulkan.legacy_barriers) {
+		std::cout << "Device doesn't support synchronization2, recording legacy barriers\n";
+		vulkan.legacy_barriers = true;
+	}
+
+	VkPhysicalDeviceFeatures physical_feats = {
+		.samplerAnisotropy = vulkan.caps.feats.samplerAnisotropy,
+	};
+
+	VkPhysicalDeviceSynchronization2Features sync2_feats = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+		.pNext = nullptr,
+		.synchronization2 = VK_TRUE,
+	};
+
+	VkPhysicalDeviceTimelineSemaphoreFeatures timeline_feats = {
+		.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES,
+		.pNext = vulkan.legacy_barriers ? nullptr : &sync2_feats,
+		.timelineSemaphore = VK_TRUE,
+	};
+
+	VkDeviceCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+		.pNext = &timeline_feats,
+		.flags = 0,
+		.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size()),
+		.pQueueCreateInfos = queue_create_infos.data(),
+		.enabledLayerCount = static_cast<uint32_t>(layer_names.size()),
+		.ppEnabledLayerNames = layer_names.data(),
+		.enabledExtensionCount = static_cast<uint32_t>(extension_names.size()),
+		.ppEnabledExtensionNames = extension_names.data(),
+		.pEnabledFeatures = &physical_feats,
+	};
+
+	VK_CALL(vkCreateDevice(vulkan.physical, &create_info, vulkan.allocator, &vulkan.device));
+	vkGetDeviceQueue(vulkan.device, vulkan.present_family, 0, &vulkan.present_queue);
+	vkGetDeviceQueue(vulkan.device, vulkan.graphics_family, 0, &vulkan.graphics_queue);
+	vkGetDeviceQueue(vulkan.device, vulkan.transfer_family, 0, &vulkan.transfer_queue);
+
+	vk_create_timeline(vulkan, vulkan.graphics_queue, vulkan.graphics_timeline);
+	vk_create_timeline(vulkan, vulkan.transfer_queue, vulkan.transfer_timeline);
+
+	vk_query_memory_budget(vulkan);
+}
+
+void vk_create_surface(vulkan_t & vulkan) {
+	#ifdef _WIN32
+	VkWin32SurfaceCreateInfoKHR create_info = {
+		.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
+		.pNext = nullptr,
+		.flags = 0,
+		.hinstance = vulkan.hinstance,
+		.hwnd = vulkan.hwnd,
+	};
+
+	VK_CALL(vkCreateWin32SurfaceKHR(vulkan.instance, &create_info, vulkan.allocator, &vulkan.surface));
+	#else
+	std::cout << "Windows are only supported on Win32, run with --headless or --bench\n";
+	throw std::runtime_error("No window surface on this platform");
+	#endif
+}
+
+void vk_create_swapchain(vulkan_t & vulkan, std::function<size_t(const std::vector<VkSurfaceFormatKHR> &)> choose_fmt_func, std::function<size_t(const std::vector<VkPresentModeKHR> &)> choose_mode_func, std::function<VkExtent2D(const VkSurfaceCapabilitiesKHR &)> choose_extent_func, std::function<uint32_t(uint32_t, uint32_t)> choose_image_count_func) {
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vulkan.physical, vulkan.surface, &vulkan.surface_capabilities);
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan surface capabilities:\n";
+	std::cout << "    Min image count: " << vulkan.surface_capabilities.minImageCount << "\n";
+	std::cout << "    Max image count: " << vulkan.surface_capabilities.maxImageCount << "\n";
+	std::cout << "    Current extent: " << vulkan.surface_capabilities.currentExtent.width << "x" << vulkan.surface_capabilities.currentExtent.height << "\n";
+	std::cout << "    Min extent: " << vulkan.surface_capabilities.minImageExtent.width << "x" << vulkan.surface_capabilities.minImageExtent.height << "\n";
+	std::cout << "    Max extent: " << vulkan.surface_capabilities.maxImageExtent.width << "x" << vulkan.surface_capabilities.maxImageExtent.height << "\n";
+	std::cout << "    Max image array layers: " << vulkan.surface_capabilities.maxImageArrayLayers << "\n";
+	std::cout << "    Supported transforms: " << vulkan.surface_capabilities.supportedTransforms << "\n";
+	std::cout << "    Current transform: " << vulkan.surface_capabilities.currentTransform << "\n";
+	std::cout << "    Supported composite alpha flags: " << vulkan.surface_capabilities.supportedCompositeAlpha << "\n";
+	std::cout << "    Supported usage flags: " << vulkan.surface_capabilities.supportedUsageFlags << "\n\n";
+	std::cout << '\n';
+	#endif
+
+	uint32_t formats_count = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(vulkan.physical, vulkan.surface, &formats_count, nullptr);
+
+	if (formats_count == 0) {
+		std::cout << "Failed to find any Vulkan surface formats\n";
+		throw std::runtime_error("Failed to find any Vulkan surface formats");
+	}
+
+	std::vector<VkSurfaceFormatKHR> surface_formats(formats_count);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(vulkan.physical, vulkan.surface, &formats_count, surface_formats.data());
+
+	size_t format_index = choose_fmt_func(surface_formats);
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan surface formats:\n";
+	for (size_t i = 0; i < surface_formats.size(); ++i) {
+		VkSurfaceFormatKHR & format = surface_formats[i];
+		char c = ' ';
+		if (i == format_index) {
+			c = 'X';
+		}
+
+		std::cout << "    [" << c << "] "
+			<< [format]() {
+				switch (format.format) {
+					case VK_FORMAT_R8G8B8A8_UNORM:
+						return "R8G8B8A8 unsigned normalized";
+					case VK_FORMAT_R8G8B8A8_SNORM:
+						return "R8G8B8A8 signed normalized";
+					case VK_FORMAT_R8G8B8A8_UINT:
+						return "R8G8B8A8 unsigned integer";
+					case VK_FORMAT_R8G8B8A8_SINT:
+						return "R8G8B8A8 signed integer";
+					case VK_FORMAT_R8G8B8A8_SRGB:
+						return "R8G8B8A8 sRGB";
+					case VK_FORMAT_B8G8R8A8_UINT:
+						return "B8G8R8A8 unsigned integer";
+					case VK_FORMAT_B8G8R8A8_SINT:
+						return "B8G8R8A8 signed integer";
+					case VK_FORMAT_B8G8R8A8_SRGB:
+						return "B8G8R8A8 sRGB";
+					default:
+						return "Unknown/Unsupported";
+				}
+			}() << "\n        "
+			<< [format]() {
+				switch (format.colorSpace) {
+					case VK_COLOR_SPACE_SRGB_NONLINEAR_KHR:
+						return "sRGB nonlinear";
+					default:
+						return "Unknown/Unsupported";
+				}
+			}() << "\n\n";
+	}
+	#endif
+
+	uint32_t modes_count = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(vulkan.physical, vulkan.surface, &modes_count, nullptr);
+
+	if (modes_count == 0) {
+		std::cout << "Failed to find any Vulkan present modes\n";
+		throw std::runtime_error("Failed to find any Vulkan present modes");
+	}
+
+	std::vector<VkPresentModeKHR> present_modes(modes_count);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(vulkan.physical, vulkan.surface, &modes_count, present_modes.data());
+
+	size_t mode_index = choose_mode_func(present_modes);
+
+	#ifdef VK_DEBUG_INFO
+	std::cout << "Vulkan present modes:\n";
+	for (size_t i = 0; i < present_modes.size(); ++i) {
+		VkPresentModeKHR & mode = present_modes[i];
+		char c = ' ';
+		if (i == mode_index) {
+			c = 'X';
+		}
+
+		std::cout << "    [" << c << ']' << " "
+			<< [mode]() {
+				switch (mode) {
+					case VK_PRESENT_MODE_IMMEDIATE_KHR:
+						return "Immediate";
+					case VK_PRESENT_MODE_MAILBOX_KHR:
+						return "Mailbox";
+					case VK_PRESENT_MODE_FIFO_KHR:
+						return "FIFO";
+					case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+						return "FIFO relaxed";
+					default:
+						return "Unknown";
+				}
+			}() << "\n";
+	}
+	std::cout << '\n';
+	#endif
+	vulkan.swapchain_format = surface_formats[format_index].format;
+	vulkan.swapchain_extent = choose_extent_func(vulkan.surface_capabilities);
+	vulkan.swapchain_image_count = choose_image_count_func(vulkan.surface_capabilities.minImageCount, vulkan.surface_capabilities.maxImageCount);
+
+	VkSwapchainCreateInfoKHR create_info = {
+		.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
+		.pNext = nullptr,
+		.flags = 0,
+		.surface = vulkan.surface,
+		.minImageCount = vulkan.swapchain_image_count,
+		.imageFormat = vulkan.swapchain_format,
+		.imageColorSpace = surface_formats[format_index].colorSpace,
+		.imageExtent = vulkan.swapchain_extent,
+		.imageArrayLayers = 1,
+		.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+		.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.preTransform = vulkan.surface_capabilities.currentTransform,
+		.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
+		.presentMode = present_modes[mode_index],
+		.clipped = VK_TRUE,
+		.oldSwapchain = VK_NULL_HANDLE,
+	};
+
+	uint32_t indices[2] = { vulkan.graphics_family, vulkan.present_family };
+
+	if (vulkan.graphics_family != vulkan.present_family) {
+		create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		create_info.queueFamilyIndexCount = 2;
+		create_info.pQueueFamilyIndices = indices;
+	}
+
+	VK_CALL(vkCreateSwapchainKHR(vulkan.device, &create_info, vulkan.allocator, &vulkan.swapchain));
+
+	vkGetSwapchainImagesKHR(vulkan.device, vulkan.swapchain, &vulkan.swapchain_image_count, nullptr);
+	vulkan.swapchain_images.resize(vulkan.swapchain_image_count);
+	vkGetSwapchainImagesKHR(vulkan.device, vulkan.swapchain, &vulkan.swapchain_image_count, vulkan.swapchain_images.data());
+
+	vulkan.swapchain_views.resize(vulkan.swapchain_image_count);
+	for (uint32_t i = 0; i < vulkan.swapchain_image_count; ++i) {
+		VkImageViewCreateInfo view_create_info = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.image = vulkan.swapchain_images[i],
+			.viewType = VK_IMAGE_VIEW_TYPE_2D,
+			.format = vulkan.swapchain_format,
+			.components = {
+				.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+				.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+				.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+				.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+			},
+			.subresourceRange = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		};
+
+		VK_CALL(vkCreateImageView(vulkan.device, &view_create_info, vulkan.allocator, &vulkan.swapchain_views[i]));
+	}
+}
+
+// stands in for the swapchain: one image at the window size in the format the swapchain usually gets,
+// so the render pass and pipeline are the same ones either way
+void vk_create_offscreen(vulkan_t & vulkan) {
+	vulkan.swapchain_format = VK_FORMAT_B8G8R8A8_SRGB;
+	vulkan.swapchain_extent = { vulkan.window_width, vulkan.window_height };
+	vulkan.swapchain_image_count = 0;
+
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(vulkan.physical, vulkan.swapchain_format, &props);
+	if ((props.optimalTilingFeatures & (VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT)) != (VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT)) {
+		std::cout << "Failed to find an offscreen format the device renders to and copies from\n";
+		throw std::runtime_error("Failed to find an offscreen format the device renders to and copies from");
+	}
+
+	vk_graph_image_t & offscreen = vulkan.offscreen;
+	offscreen = {
+		.desc = {},
+		.image = VK_NULL_HANDLE,
+		.view = VK_NULL_HANDLE,
+		.memory = {},
+		.state = {},
+		.used = false,
+	};
+	offscreen.state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	offscreen.image = vk_create_image(
+		vulkan,
+		{
+			.width = vulkan.swapchain_extent.width,
+			.height = vulkan.swapchain_extent.height,
+			.depth = 1,
+		},
+		VK_IMAGE_TYPE_2D, vulkan.swapchain_format,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		MEMORY_USAGE_DEVICE, MEMORY_CATEGORY_TEXTURE, offscreen.memory
+	);
+	if (offscreen.image == VK_NULL_HANDLE) {
+		std::cout << "Failed to allocate the offscreen image\n";
+		throw std::runtime_error("Failed to allocate the offscreen image");
+	}
+
+	VkImageViewCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = offscreen.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = vulkan.swapchain_format,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+	VK_CALL(vkCreateImageView(vulkan.device, &create_info, vulkan.allocator, &offscreen.view));
+
+	VkDeviceSize size = static_cast<VkDeviceSize>(vulkan.swapchain_extent.width) * vulkan.swapchain_extent.height * 4;
+	vulkan.readback_buffer = vk_create_buffer(vulkan, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, MEMORY_USAGE_READBACK, MEMORY_CATEGORY_STAGING, vulkan.readback_memory);
+}
+
+void vk_destroy_offscreen(vulkan_t & vulkan) {
+	vkDestroyBuffer(vulkan.device, vulkan.readback_buffer, vulkan.allocator);
+	vk_free_memory(vulkan, vulkan.readback_memory);
+	vulkan.readback_buffer = VK_NULL_HANDLE;
+
+	vkDestroyImageView(vulkan.device, vulkan.offscreen.view, vulkan.allocator);
+	vkDestroyImage(vulkan.device, vulkan.offscreen.image, vulkan.allocator);
+	vk_free_memory(vulkan, vulkan.offscreen.memory);
+	vulkan.offscreen.image = VK_NULL_HANDLE;
+	vulkan.offscreen.view = VK_NULL_HANDLE;
+}
+
+// the last frame drawn with readback set, rows top to bottom in swapchain_format
+void vk_read_offscreen(vulkan_t & vulkan, std::vector<unsigned char> & out_pixels) {
+	vk_timeline_wait(vulkan, vulkan.graphics_timeline, vulkan.graphics_timeline.submitted);
+
+	VkDeviceSize size = static_cast<VkDeviceSize>(vulkan.swapchain_extent.width) * vulkan.swapchain_extent.height * 4;
+	out_pixels.resize(size);
+	memcpy(out_pixels.data(), vulkan.readback_memory.mapped, size);
+}
+
+void vk_init_pipeline(vulkan_t & vulkan, const std::vector<unsigned char> & vertex_spv, const std::vector<unsigned char> & fragment_spv) {
+	VkShaderModuleCreateInfo vertex_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = vertex_spv.size(),
+		.pCode = reinterpret_cast<const uint32_t *>(vertex_spv.data()),
+	};
+
+	VK_CALL(vkCreateShaderModule(vulkan.device, &vertex_create_info, vulkan.allocator, &vulkan.vertex_shader));
+
+	VkShaderModuleCreateInfo fragment_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.codeSize = fragment_spv.size(),
+		.pCode = reinterpret_cast<const uint32_t *>(fragment_spv.data()),
+	};
+
+	VK_CALL(vkCreateShaderModule(vulkan.device, &fragment_create_info, vulkan.allocator, &vulkan.fragment_shader));
+
+	VkPipelineShaderStageCreateInfo vertex_stage_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stage = VK_SHADER_STAGE_VERTEX_BIT,
+		.module = vulkan.vertex_shader,
+		.pName = "main",
+		.pSpecializationInfo = nullptr,
+	};
+
+	VkPipelineShaderStageCreateInfo fragment_stage_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+		.module = vulkan.fragment_shader,
+		.pName = "main",
+		.pSpecializationInfo = nullptr,
+	};
+
+	VkPipelineShaderStageCreateInfo stages[] = { vertex_stage_create_info, fragment_stage_create_info };
+
+	std::vector<VkDynamicState> dynamic_states = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR,
+	};
+
+	VkPipelineDynamicStateCreateInfo ds_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.dynamicStateCount = static_cast<uint32_t>(dynamic_states.size()),
+		.pDynamicStates = dynamic_states.data(),
+	};
+
+	VkVertexInputBindingDescription binding_desc = vertex_binding_desc();
+	auto attr_desc = vertex_attr_desc();
+
+	VkPipelineVertexInputStateCreateInfo vis_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.vertexBindingDescriptionCount = 1,
+		.pVertexBindingDescriptions = &binding_desc,
+		.vertexAttributeDescriptionCount = attr_desc.size(),
+		.pVertexAttributeDescriptions = attr_desc.data(),
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo ias_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+		.primitiveRestartEnable = VK_FALSE,
+	};
+
+	vulkan.viewport = {
+		.x = 0.0f,
+		.y = 0.0f,
+		.width = static_cast<float>(vulkan.swapchain_extent.width),
+		.height = static_cast<float>(vulkan.swapchain_extent.height),
+		.minDepth = 0.0f,
+		.maxDepth = 1.0f,
+	};
+
+	vulkan.scissor = {
+		.offset = { 0, 0 },
+		.extent = vulkan.swapchain_extent,
+	};
+
+	VkPipelineViewportStateCreateInfo vs_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.viewportCount = 1,
+		.pViewports = &vulkan.viewport,
+		.scissorCount = 1,
+		.pScissors = &vulkan.scissor,
+	};
+
+	VkPipelineRasterizationStateCreateInfo rs_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.depthClampEnable = VK_FALSE,
+		.rasterizerDiscardEnable = VK_FALSE,
+		.polygonMode = VK_POLYGON_MODE_FILL,
+		.cullMode = VK_CULL_MODE_NONE,
+		.frontFace = VK_FRONT_FACE_CLOCKWISE,
+		.depthBiasEnable = VK_FALSE,
+		.depthBiasConstantFactor = 0.0f,
+		.depthBiasClamp = 0.0f,
+		.depthBiasSlopeFactor = 0.0f,
+		.lineWidth = 1.0f,
+	};
+
+	VkPipelineMultisampleStateCreateInfo ms_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+		.sampleShadingEnable = VK_FALSE,
+		.minSampleShading = 1.0f,
+		.pSampleMask = nullptr,
+		.alphaToCoverageEnable = VK_FALSE,
+		.alphaToOneEnable = VK_FALSE,
+	};
+
+	VkPipelineColorBlendAttachmentState cba_state = {
+		.blendEnable = VK_FALSE,
+		.srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+		.colorBlendOp = VK_BLEND_OP_ADD,
+		.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+		.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+		.alphaBlendOp = VK_BLEND_OP_ADD,
+		.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+	};
+
+	VkPipelineColorBlendStateCreateInfo cb_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.logicOpEnable = VK_FALSE,
+		.logicOp = VK_LOGIC_OP_COPY,
+		.attachmentCount = 1,
+		.pAttachments = &cba_state,
+		.blendConstants = { 0.0f, 0.0f, 0.0f, 0.0f },
+	};
+
+	{
+		VkDescriptorSetLayoutBinding bindings[2] = {
+			{
+				.binding = 0,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+				.pImmutableSamplers = nullptr,
+			},
+			{
+				.binding = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = 1,
+				.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+				.pImmutableSamplers = nullptr,
+			},
+		};
+
+		VkDescriptorSetLayoutCreateInfo layout_create_info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.bindingCount = 2,
+			.pBindings = bindings,
+		};
+
+		VK_CALL(vkCreateDescriptorSetLayout(vulkan.device, &layout_create_info, vulkan.allocator, &vulkan.desc_layout));
+	}
+
+	VkPipelineLayoutCreateInfo layout_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.setLayoutCount = 1,
+		.pSetLayouts = &vulkan.desc_layout,
+		.pushConstantRangeCount = 0,
+		.pPushConstantRanges = nullptr,
+	};
+
+	VK_CALL(vkCreatePipelineLayout(vulkan.device, &layout_create_info, vulkan.allocator, &vulkan.pipeline_layout));
+
+	VkPipelineDepthStencilStateCreateInfo dss_create_info = {
+		.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.depthTestEnable = VK_TRUE,
+		.depthWriteEnable = VK_TRUE,
+		.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL,
+		.depthBoundsTestEnable = VK_FALSE,
+		.stencilTestEnable = VK_FALSE,
+		.front = {},
+		.back = {},
+	};
+
+	VkGraphicsPipelineCreateInfo pipeline_create_info = {
+		.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.stageCount = 2,
+		.pStages = stages,
+		.pVertexInputState = &vis_create_info,
+		.pInputAssemblyState = &ias_create_info,
+		.pTessellationState = nullptr,
+		.pViewportState = &vs_create_info,
+		.pRasterizationState = &rs_create_info,
+		.pMultisampleState = &ms_create_info,
+		.pDepthStencilState = &dss_create_info,
+		.pColorBlendState = &cb_create_info,
+		.pDynamicState = &ds_create_info,
+		.layout = vulkan.pipeline_layout,
+		.renderPass = vulkan.render_pass,
+		.subpass = 0,
+		.basePipelineHandle = VK_NULL_HANDLE,
+		.basePipelineIndex = -1,
+	};
+
+	VK_CALL(vkCreateGraphicsPipelines(vulkan.device, VK_NULL_HANDLE, 1, &pipeline_create_info, vulkan.allocator, &vulkan.pipeline));
+}
+
+static VkAttachmentDescription vk_graph_attachment(VkFormat format, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op, VkImageLayout layout) {
+	return {
+		.flags = 0,
+		.format = format,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.loadOp = load_op,
+		.storeOp = store_op,
+		.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+		.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+		.initialLayout = layout,
+		.finalLayout = layout,
+	};
+}
+
+void vk_init_render_pass(vulkan_t & vulkan) {
+	// the main pass's attachments as the frame graph works them out, so the graph gets this one back from the cache
+	vulkan.render_pass = vk_graph_render_pass(vulkan, {
+		vk_graph_attachment(vulkan.swapchain_format, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL),
+		vk_graph_attachment(VK_FORMAT_D32_SFLOAT, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL),
+	});
+}
+
+// attachments stay in one layout, the graph's barriers do every transition and dependency outside the pass
+VkRenderPass vk_graph_render_pass(vulkan_t & vulkan, const std::vector<VkAttachmentDescription> & attachments) {
+	for (vk_graph_render_pass_t & cached : vulkan.graph_render_passes) {
+		if (cached.attachments.size() == attachments.size() && memcmp(cached.attachments.data(), attachments.data(), attachments.size() * sizeof(VkAttachmentDescription)) == 0) {
+			return cached.render_pass;
+		}
+	}
+
+	std::vector<VkAttachmentReference> colors;
+	VkAttachmentReference depth = {
+		.attachment = VK_ATTACHMENT_UNUSED,
+		.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+	for (uint32_t i = 0; i < attachments.size(); ++i) {
+		VkImageLayout layout = attachments[i].initialLayout;
+		if (layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL || layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL) {
+			depth = { i, layout };
+		} else {
+			colors.push_back({ i, layout });
+		}
+	}
+
+	VkSubpassDescription subpass_desc = {
+		.flags = 0,
+		.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+		.inputAttachmentCount = 0,
+		.pInputAttachments = nullptr,
+		.colorAttachmentCount = static_cast<uint32_t>(colors.size()),
+		.pColorAttachments = colors.data(),
+		.pResolveAttachments = nullptr,
+		.pDepthStencilAttachment = depth.attachment != VK_ATTACHMENT_UNUSED ? &depth : nullptr,
+		.preserveAttachmentCount = 0,
+		.pPreserveAttachments = nullptr,
+	};
+
+	VkRenderPassCreateInfo rp_create_info = {
+		.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.attachmentCount = static_cast<uint32_t>(attachments.size()),
+		.pAttachments = attachments.data(),
+		.subpassCount = 1,
+		.pSubpasses = &subpass_desc,
+		.dependencyCount = 0,
+		.pDependencies = nullptr,
+	};
+
+	vk_graph_render_pass_t cached = {
+		.attachments = attachments,
+		.render_pass = VK_NULL_HANDLE,
+	};
+	VK_CALL(vkCreateRenderPass(vulkan.device, &rp_create_info, vulkan.allocator, &cached.render_pass));
+	vulkan.graph_render_passes.push_back(cached);
+
+	return cached.render_pass;
+}
+
+static VkFramebuffer vk_graph_framebuffer(vulkan_t & vulkan, VkRenderPass render_pass, const std::vector<VkImageView> & views, VkExtent2D extent) {
+	for (vk_graph_framebuffer_t & cached : vulkan.graph_framebuffers) {
+		if (cached.render_pass == render_pass && cached.views == views && cached.extent.width == extent.width && cached.extent.height == extent.height) {
+			return cached.framebuffer;
+		}
+	}
+
+	VkFramebufferCreateInfo fb_create_info = {
+		.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.renderPass = render_pass,
+		.attachmentCount = static_cast<uint32_t>(views.size()),
+		.pAttachments = views.data(),
+		.width = extent.width,
+		.height = extent.height,
+		.layers = 1,
+	};
+
+	vk_graph_framebuffer_t cached = {
+		.render_pass = render_pass,
+		.views = views,
+		.extent = extent,
+		.framebuffer = VK_NULL_HANDLE,
+	};
+	VK_CALL(vkCreateFramebuffer(vulkan.device, &fb_create_info, vulkan.allocator, &cached.framebuffer));
+	vulkan.graph_framebuffers.push_back(cached);
+
+	return cached.framebuffer;
+}
+
+// a pooled image this frame hasn't handed out yet that fits the slot, a new one when there is none
+static uint32_t vk_graph_acquire_image(vulkan_t & vulkan, const kgraph_slot_t & slot) {
+	for (uint32_t i = 0; i < vulkan.graph_images.size(); ++i) {
+		vk_graph_image_t & image = vulkan.graph_images[i];
+		if (!image.used && image.desc.format == slot.format && image.desc.extent.width == slot.extent.width && image.desc.extent.height == slot.extent.height && (image.desc.usage & slot.usage) == slot.usage) {
+			image.used = true;
+			return i;
+		}
+	}
+
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(vulkan.physical, slot.format, &props);
+	VkFormatFeatureFlags features = 0;
+	features |= (slot.usage & VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT) ? VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT : 0;
+	features |= (slot.usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ? VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT : 0;
+	features |= (slot.usage & VK_IMAGE_USAGE_SAMPLED_BIT) ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0;
+	features |= (slot.usage & VK_IMAGE_USAGE_STORAGE_BIT) ? VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT : 0;
+	if ((props.optimalTilingFeatures & features) != features) {
+		throw std::runtime_error("Format Unsupported");
+	}
+
+	// images only ever used as attachments can live in lazily allocated memory
+	VkImageUsageFlags usage = slot.usage;
+	bool transient = (usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT)) == 0;
+	if (transient) {
+		usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+
+	vk_graph_image_t image = {
+		.desc = slot,
+		.image = VK_NULL_HANDLE,
+		.view = VK_NULL_HANDLE,
+		.memory = {},
+		.state = {},
+		.used = true,
+	};
+
+	image.image = vk_create_image(
+		vulkan,
+		{
+			.width = slot.extent.width,
+			.height = slot.extent.height,
+			.depth = 1,
+		},
+		VK_IMAGE_TYPE_2D, slot.format,
+		VK_IMAGE_TILING_OPTIMAL, usage,
+		transient ? MEMORY_USAGE_TRANSIENT : MEMORY_USAGE_DEVICE, (slot.aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? MEMORY_CATEGORY_DEPTH : MEMORY_CATEGORY_TEXTURE, image.memory
+	);
+	if (image.image == VK_NULL_HANDLE) {
+		std::cout << "Failed to allocate a frame graph image\n";
+		throw std::runtime_error("Failed to allocate a frame graph image");
+	}
+
+	VkImageViewCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = image.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = slot.format,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = slot.aspect,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	VK_CALL(vkCreateImageView(vulkan.device, &create_info, vulkan.allocator, &image.view));
+	vulkan.graph_images.push_back(image);
+
+	return static_cast<uint32_t>(vulkan.graph_images.size() - 1);
+}
+
+static void vk_graph_barriers(vk_graph_t & graph, const std::vector<kgraph_barrier_t> & barriers) {
+	for (const kgraph_barrier_t & barrier : barriers) {
+		graph.barriers.images.push_back({
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.pNext = nullptr,
+			.srcStageMask = barrier.src_stages,
+			.srcAccessMask = barrier.src_access,
+			.dstStageMask = barrier.dst_stages,
+			.dstAccessMask = barrier.dst_access,
+			.oldLayout = barrier.old_layout,
+			.newLayout = barrier.new_layout,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = graph.images[barrier.image],
+			.subresourceRange = {
+				.aspectMask = graph.graph.images[barrier.image].aspect,
+				.baseMipLevel = 0,
+				.levelCount = 1,
+				.baseArrayLayer = 0,
+				.layerCount = 1,
+			},
+		});
+	}
+}
+
+void vk_graph_begin(vulkan_t & vulkan, vk_graph_t & graph) {
+	kgraph_reset(&graph.graph);
+	graph.executes.clear();
+	graph.barriers = {};
+	graph.images.clear();
+	graph.views.clear();
+
+	for (vk_graph_image_t & image : vulkan.graph_images) {
+		image.used = false;
+	}
+}
+
+uint32_t vk_graph_import(vk_graph_t & graph, VkImage image, VkImageView view, VkFormat format, VkExtent2D extent, const kgraph_state_t & state, VkImageLayout final_layout) {
+	graph.images.push_back(image);
+	graph.views.push_back(view);
+	return kgraph_import(&graph.graph, format, extent, &state, final_layout);
+}
+
+uint32_t vk_graph_transient(vk_graph_t & graph, VkFormat format, VkExtent2D extent) {
+	graph.images.push_back(VK_NULL_HANDLE);
+	graph.views.push_back(VK_NULL_HANDLE);
+	return kgraph_transient(&graph.graph, format, extent);
+}
+
+uint32_t vk_graph_pass(vk_graph_t & graph, const char * name, bool side_effect, vk_graph_execute_t execute) {
+	graph.executes.push_back(std::move(execute));
+	return kgraph_pass(&graph.graph, name, side_effect);
+}
+
+void vk_graph_run(vulkan_t & vulkan, vk_graph_t & graph, VkCommandBuffer cmd) {
+	kgraph_t & kg = graph.graph;
+	int ret = kgraph_compile(&kg);
+	if (ret != 0) {
+		std::cout << "Failed to compile the frame graph: " << ret << "\n";
+		throw std::runtime_error("Failed to compile the frame graph");
+	}
+
+	// each slot starts from whatever its pooled image went through last, most likely the previous frame
+	std::vector<uint32_t> slot_images(kg.slots.size());
+	for (size_t s = 0; s < kg.slots.size(); ++s) {
+		slot_images[s] = vk_graph_acquire_image(vulkan, kg.slots[s]);
+		kg.slots[s].state = vulkan.graph_images[slot_images[s]].state;
+	}
+	for (size_t i = 0; i < kg.images.size(); ++i) {
+		if (!kg.images[i].imported && kg.images[i].slot != KGRAPH_NONE) {
+			const vk_graph_image_t & image = vulkan.graph_images[slot_images[kg.images[i].slot]];
+			graph.images[i] = image.image;
+			graph.views[i] = image.view;
+		}
+	}
+
+	kgraph_schedule(&kg);
+
+	std::vector<VkAttachmentDescription> attachments;
+	std::vector<VkImageView> views;
+	std::vector<VkClearValue> clears;
+	for (size_t p = 0; p < kg.passes.size(); ++p) {
+		const kgraph_pass_t & pass = kg.passes[p];
+		if (pass.culled) {
+			continue;
+		}
+
+		// a pass's barriers all go in front of it in one call, nothing at all when kgraph found no hazard
+		vk_graph_barriers(graph, pass.barriers);
+		vk_barrier_flush(vulkan, graph.barriers, cmd);
+
+		attachments.clear();
+		views.clear();
+		clears.clear();
+		VkExtent2D extent = { 0, 0 };
+		for (const kgraph_access_t & access : pass.accesses) {
+			if (access.usage != KGRAPH_USAGE_COLOR_ATTACHMENT && access.usage != KGRAPH_USAGE_DEPTH_ATTACHMENT && access.usage != KGRAPH_USAGE_DEPTH_READ) {
+				continue;
+			}
+
+			const kgraph_image_t & image = kg.images[access.image];
+			attachments.push_back(vk_graph_attachment(image.format, access.load_op, access.store_op, kgraph_usage_layout(access.usage)));
+			views.push_back(graph.views[access.image]);
+			clears.push_back(access.clear_value);
+			extent = image.extent;
+		}
+
+		if (attachments.empty()) {
+			graph.executes[p](vulkan, cmd, nullptr);
+			continue;
+		}
+
+		VkRenderPass render_pass = vk_graph_render_pass(vulkan, attachments);
+		VkRenderPassBeginInfo rp_info = {
+			.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+			.pNext = nullptr,
+			.renderPass = render_pass,
+			.framebuffer = vk_graph_framebuffer(vulkan, render_pass, views, extent),
+			.renderArea = {
+				.offset = { 0, 0 },
+				.extent = extent,
+			},
+			.clearValueCount = static_cast<uint32_t>(clears.size()),
+			.pClearValues = clears.data(),
+		};
+
+		graph.executes[p](vulkan, cmd, &rp_info);
+	}
+
+	vk_graph_barriers(graph, kg.final_barriers);
+	vk_barrier_flush(vulkan, graph.barriers, cmd);
+
+	for (size_t s = 0; s < kg.slots.size(); ++s) {
+		vulkan.graph_images[slot_images[s]].state = kg.slots[s].state;
+	}
+}
+
+void vk_destroy_graph_images(vulkan_t & vulkan) {
+	for (vk_graph_framebuffer_t & cached : vulkan.graph_framebuffers) {
+		vkDestroyFramebuffer(vulkan.device, cached.framebuffer, vulkan.allocator);
+	}
+	vulkan.graph_framebuffers.clear();
+
+	for (vk_graph_image_t & image : vulkan.graph_images) {
+		vkDestroyImageView(vulkan.device, image.view, vulkan.allocator);
+		vkDestroyImage(vulkan.device, image.image, vulkan.allocator);
+		vk_free_memory(vulkan, image.memory);
+	}
+	vulkan.graph_images.clear();
+}
+
+void vk_destroy_graph_cache(vulkan_t & vulkan) {
+	vk_destroy_graph_images(vulkan);
+
+	for (vk_graph_render_pass_t & cached : vulkan.graph_render_passes) {
+		vkDestroyRenderPass(vulkan.device, cached.render_pass, vulkan.allocator);
+	}
+	vulkan.graph_render_passes.clear();
+	vulkan.render_pass = VK_NULL_HANDLE;
+}
+
+static void vk_create_cmd_pool(vulkan_t & vulkan, vk_cmd_pool_t & pool) {
+	VkCommandPoolCreateInfo pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+		.queueFamilyIndex = vulkan.graphics_family,
+	};
+
+	VK_CALL(vkCreateCommandPool(vulkan.device, &pool_create_info, vulkan.allocator, &pool.pool));
+	pool.cmds.clear();
+	pool.used = 0;
+}
+
+static void vk_create_frame_cmds(vulkan_t & vulkan, vk_frame_cmds_t & frame_cmds) {
+	vk_create_cmd_pool(vulkan, frame_cmds.primary);
+	uint32_t thread_count = vulkan.record_thread_count != 0 ? vulkan.record_thread_count : std::thread::hardware_concurrency();
+	frame_cmds.secondary.resize(std::max(thread_count, 1u));
+	for (vk_cmd_pool_t & pool : frame_cmds.secondary) {
+		vk_create_cmd_pool(vulkan, pool);
+	}
+
+	frame_cmds.timestamps = VK_NULL_HANDLE;
+	frame_cmds.timestamps_written = false;
+	if (vulkan.gpu_timestamps && vulkan.caps.timestamp_bits != 0) {
+		VkQueryPoolCreateInfo create_info = {
+			.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.queryType = VK_QUERY_TYPE_TIMESTAMP,
+			.queryCount = 2,
+			.pipelineStatistics = 0,
+		};
+		VK_CALL(vkCreateQueryPool(vulkan.device, &create_info, vulkan.allocator, &frame_cmds.timestamps));
+	}
+}
+
+// destroying the pools frees every buffer allocated from them
+static void vk_destroy_frame_cmds(vulkan_t & vulkan, vk_frame_cmds_t & frame_cmds) {
+	vkDestroyCommandPool(vulkan.device, frame_cmds.primary.pool, vulkan.allocator);
+	for (vk_cmd_pool_t & pool : frame_cmds.secondary) {
+		vkDestroyCommandPool(vulkan.device, pool.pool, vulkan.allocator);
+	}
+	frame_cmds.secondary.clear();
+
+	if (frame_cmds.timestamps != VK_NULL_HANDLE) {
+		vkDestroyQueryPool(vulkan.device, frame_cmds.timestamps, vulkan.allocator);
+		frame_cmds.timestamps = VK_NULL_HANDLE;
+	}
+}
+
+void vk_create_command_utils(vulkan_t & vulkan) {
+	vulkan.frame_cmds.resize(vulkan.frames_in_flight);
+	for (vk_frame_cmds_t & frame_cmds : vulkan.frame_cmds) {
+		vk_create_frame_cmds(vulkan, frame_cmds);
+	}
+
+	// staging batches finish out of step with frames, so their buffers are reset one at a time as they retire
+	VkCommandPoolCreateInfo pool_create_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+		.queueFamilyIndex = vulkan.transfer_family,
+	};
+
+	VK_CALL(vkCreateCommandPool(vulkan.device, &pool_create_info, vulkan.allocator, &vulkan.transfer_cmd_pool));
+}
+
+static VkCommandBuffer vk_pool_cmd(vulkan_t & vulkan, vk_cmd_pool_t & pool, VkCommandBufferLevel level) {
+	if (pool.used == pool.cmds.size()) {
+		VkCommandBufferAllocateInfo alloc_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.commandPool = pool.pool,
+			.level = level,
+			.commandBufferCount = 1,
+		};
+
+		VkCommandBuffer cmd;
+		VK_CALL(vkAllocateCommandBuffers(vulkan.device, &alloc_info, &cmd));
+		pool.cmds.push_back(cmd);
+	}
+
+	return pool.cmds[pool.used++];
+}
+
+// everything the frame recorded last time around is done, so its buffers go back one call per pool
+void vk_reset_frame_cmds(vulkan_t & vulkan) {
+	vk_frame_cmds_t & frame_cmds = vulkan.frame_cmds[vulkan.current_frame];
+	VK_CALL(vkResetCommandPool(vulkan.device, frame_cmds.primary.pool, 0));
+	frame_cmds.primary.used = 0;
+	for (vk_cmd_pool_t & pool : frame_cmds.secondary) {
+		VK_CALL(vkResetCommandPool(vulkan.device, pool.pool, 0));
+		pool.used = 0;
+	}
+
+	// done along with the buffers, so the results are there without waiting
+	if (frame_cmds.timestamps_written) {
+		uint64_t ticks[2];
+		VK_CALL(vkGetQueryPoolResults(vulkan.device, frame_cmds.timestamps, 0, 2, sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT));
+
+		uint64_t mask = vulkan.caps.timestamp_bits >= 64 ? ~0ull : (1ull << vulkan.caps.timestamp_bits) - 1;
+		vulkan.gpu_time = static_cast<double>((ticks[1] - ticks[0]) & mask) * vulkan.caps.props.limits.timestampPeriod * 1e-9;
+		frame_cmds.timestamps_written = false;
+	}
+}
+
+// brackets everything the frame's primary records, the start also resets the pair for this frame
+void vk_frame_timestamp(vulkan_t & vulkan, VkCommandBuffer cmd, bool end) {
+	vk_frame_cmds_t & frame_cmds = vulkan.frame_cmds[vulkan.current_frame];
+	if (frame_cmds.timestamps == VK_NULL_HANDLE) {
+		return;
+	}
+
+	if (!end) {
+		vkCmdResetQueryPool(cmd, frame_cmds.timestamps, 0, 2);
+		if (vulkan.legacy_barriers) {
+			vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame_cmds.timestamps, 0);
+		} else {
+			vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frame_cmds.timestamps, 0);
+		}
+		return;
+	}
+
+	if (vulkan.legacy_barriers) {
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame_cmds.timestamps, 1);
+	} else {
+		vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, frame_cmds.timestamps, 1);
+	}
+	frame_cmds.timestamps_written = true;
+}
+
+VkCommandBuffer vk_frame_cmd(vulkan_t & vulkan) {
+	return vk_pool_cmd(vulkan, vulkan.frame_cmds[vulkan.current_frame].primary, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+}
+
+// secondaries and inline recording both start with nothing bound, so every range binds for itself
+static void vk_record_draws(vulkan_t & vulkan, VkCommandBuffer cmd, const vk_draw_t * draws, size_t count) {
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan.pipeline);
+	vkCmdSetViewport(cmd, 0, 1, &vulkan.viewport);
+	vkCmdSetScissor(cmd, 0, 1, &vulkan.scissor);
+
+	// consecutive draws of the same mesh share its bind
+	VkBuffer bound = VK_NULL_HANDLE;
+	for (size_t i = 0; i < count; ++i) {
+		if (draws[i].mesh_buffer != bound) {
+			VkDeviceSize offset = 0;
+			vkCmdBindVertexBuffers(cmd, 0, 1, &draws[i].mesh_buffer, &offset);
+			vkCmdBindIndexBuffer(cmd, draws[i].mesh_buffer, draws[i].index_offset, VK_INDEX_TYPE_UINT32);
+			bound = draws[i].mesh_buffer;
+		}
+
+		VkDescriptorSet set = draws[i].desc_set != VK_NULL_HANDLE ? draws[i].desc_set : vulkan.desc_sets[vulkan.current_frame];
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan.pipeline_layout, 0, 1, &set, 1, &draws[i].unif_offset);
+		vkCmdDrawIndexed(cmd, draws[i].index_count, 1, draws[i].first_index, draws[i].vertex_offset, 0);
+	}
+}
+
+void vk_record_pass(vulkan_t & vulkan, VkCommandBuffer cmd, const VkRenderPassBeginInfo & rp_info) {
+	vk_frame_cmds_t & frame_cmds = vulkan.frame_cmds[vulkan.current_frame];
+	size_t count = vulkan.draws.size();
+
+	uint32_t min_draws = std::max(vulkan.record_min_draws, 1u);
+	uint32_t thread_count = static_cast<uint32_t>(std::min<size_t>(frame_cmds.secondary.size(), count / min_draws));
+	if (thread_count <= 1) {
+		vkCmdBeginRenderPass(cmd, &rp_info, VK_SUBPASS_CONTENTS_INLINE);
+		if (count != 0) {
+			vk_record_draws(vulkan, cmd, vulkan.draws.data(), count);
+		}
+		vkCmdEndRenderPass(cmd);
+		return;
+	}
+
+	VkCommandBufferInheritanceInfo inheritance = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+		.pNext = nullptr,
+		.renderPass = rp_info.renderPass,
+		.subpass = 0,
+		.framebuffer = rp_info.framebuffer,
+		.occlusionQueryEnable = VK_FALSE,
+		.queryFlags = 0,
+		.pipelineStatistics = 0,
+	};
+
+	// a thread's exception would end the process, so each one is carried back and rethrown after the join
+	size_t chunk = (count + thread_count - 1) / thread_count;
+	std::vector<VkCommandBuffer> secondaries(thread_count);
+	std::vector<std::exception_ptr> errors(thread_count);
+	auto record = [&](uint32_t t) {
+		try {
+			size_t first = std::min(chunk * t, count);
+			size_t last = std::min(first + chunk, count);
+			VkCommandBuffer secondary = vk_pool_cmd(vulkan, frame_cmds.secondary[t], VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+			VkCommandBufferBeginInfo begin_info = {
+				.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+				.pNext = nullptr,
+				.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT,
+				.pInheritanceInfo = &inheritance,
+			};
+
+			VK_CALL(vkBeginCommandBuffer(secondary, &begin_info));
+			vk_record_draws(vulkan, secondary, vulkan.draws.data() + first, last - first);
+			VK_CALL(vkEndCommandBuffer(secondary));
+			secondaries[t] = secondary;
+		} catch (...) {
+			errors[t] = std::current_exception();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(thread_count - 1);
+	for (uint32_t t = 1; t < thread_count; ++t) {
+		threads.emplace_back(record, t);
+	}
+	record(0);
+
+	for (std::thread & thread : threads) {
+		thread.join();
+	}
+	for (std::exception_ptr & error : errors) {
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	// executed in split order, so draws land in the same order as when recorded inline
+	vkCmdBeginRenderPass(cmd, &rp_info, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+	vkCmdExecuteCommands(cmd, thread_count, secondaries.data());
+	vkCmdEndRenderPass(cmd);
+}
+
+void vk_begin_cmd(vulkan_t & vulkan, VkCommandBuffer & buffer) {
+	VkCommandBufferBeginInfo begin_info = {
+		.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+		.pNext = nullptr,
+		.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+		.pInheritanceInfo = nullptr,
+	};
+
+	VK_CALL(vkBeginCommandBuffer(buffer, &begin_info));
+}
+
+void vk_end_cmd(vulkan_t & vulkan, VkCommandBuffer & buffer) {
+	VK_CALL(vkEndCommandBuffer(buffer));
+}
+
+// the finer sync2 stages above the first 32 bits fold into the coarse ones they split, none has no legacy
+// bit so it becomes the end of the pipe that waits on or blocks nothing
+static VkPipelineStageFlags vk_legacy_stages(VkPipelineStageFlags2 stages, bool src) {
+	VkPipelineStageFlags legacy = static_cast<VkPipelineStageFlags>(stages & 0xFFFFFFFFULL);
+	if (stages & (VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_RESOLVE_BIT | VK_PIPELINE_STAGE_2_BLIT_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT)) {
+		legacy |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+	}
+	if (stages & (VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT | VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT)) {
+		legacy |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+	}
+	// the only pre rasterization stage the pipelines have
+	if (stages & VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT) {
+		legacy |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT;
+	}
+
+	if (legacy == 0) {
+		legacy = src ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+	return legacy;
+}
+
+static VkAccessFlags vk_legacy_access(VkAccessFlags2 access) {
+	VkAccessFlags legacy = static_cast<VkAccessFlags>(access & 0xFFFFFFFFULL);
+	if (access & (VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT)) {
+		legacy |= VK_ACCESS_SHADER_READ_BIT;
+	}
+	if (access & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT) {
+		legacy |= VK_ACCESS_SHADER_WRITE_BIT;
+	}
+	return legacy;
+}
+
+struct vk_legacy_barrier_group_t {
+	VkPipelineStageFlags src_stages;
+	VkPipelineStageFlags dst_stages;
+	std::vector<VkMemoryBarrier> memory;
+	std::vector<VkBufferMemoryBarrier> buffers;
+	std::vector<VkImageMemoryBarrier> images;
+};
+
+// vkCmdPipelineBarrier has one pair of stage masks for all of its barriers, so the batch is split into one
+// call per distinct pair rather than widened to their union
+static void vk_barrier_flush_legacy(vulkan_t & vulkan, vk_barrier_batch_t & batch, VkCommandBuffer cmd) {
+	std::vector<vk_legacy_barrier_group_t> groups;
+	auto group_for = [&](VkPipelineStageFlags2 src_stages, VkPipelineStageFlags2 dst_stages) -> vk_legacy_barrier_group_t & {
+		VkPipelineStageFlags src = vk_legacy_stages(src_stages, true);
+		VkPipelineStageFlags dst = vk_legacy_stages(dst_stages, false);
+		for (vk_legacy_barrier_group_t & group : groups) {
+			if (group.src_stages == src && group.dst_stages == dst) {
+				return group;
+			}
+		}
+		groups.push_back({ .src_stages = src, .dst_stages = dst });
+		return groups.back();
+	};
+
+	for (const VkMemoryBarrier2 & barrier : batch.memory) {
+		group_for(barrier.srcStageMask, barrier.dstStageMask).memory.push_back({
+			.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = vk_legacy_access(barrier.srcAccessMask),
+			.dstAccessMask = vk_legacy_access(barrier.dstAccessMask),
+		});
+	}
+	for (const VkBufferMemoryBarrier2 & barrier : batch.buffers) {
+		group_for(barrier.srcStageMask, barrier.dstStageMask).buffers.push_back({
+			.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = vk_legacy_access(barrier.srcAccessMask),
+			.dstAccessMask = vk_legacy_access(barrier.dstAccessMask),
+			.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+			.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+			.buffer = barrier.buffer,
+			.offset = barrier.offset,
+			.size = barrier.size,
+		});
+	}
+	for (const VkImageMemoryBarrier2 & barrier : batch.images) {
+		group_for(barrier.srcStageMask, barrier.dstStageMask).images.push_back({
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+			.pNext = nullptr,
+			.srcAccessMask = vk_legacy_access(barrier.srcAccessMask),
+			.dstAccessMask = vk_legacy_access(barrier.dstAccessMask),
+			.oldLayout = barrier.oldLayout,
+			.newLayout = barrier.newLayout,
+			.srcQueueFamilyIndex = barrier.srcQueueFamilyIndex,
+			.dstQueueFamilyIndex = barrier.dstQueueFamilyIndex,
+			.image = barrier.image,
+			.subresourceRange = barrier.subresourceRange,
+		});
+	}
+
+	for (const vk_legacy_barrier_group_t & group : groups) {
+		vkCmdPipelineBarrier(
+			cmd, group.src_stages, group.dst_stages, 0,
+			static_cast<uint32_t>(group.memory.size()), group.memory.data(),
+			static_cast<uint32_t>(group.buffers.size()), group.buffers.data(),
+			static_cast<uint32_t>(group.images.size()), group.images.data()
+		);
+	}
+	vulkan.barrier_stats.commands += groups.size();
+}
+
+void vk_barrier_flush(vulkan_t & vulkan, vk_barrier_batch_t & batch, VkCommandBuffer cmd) {
+	if (batch.memory.empty() && batch.buffers.empty() && batch.images.empty()) {
+		return;
+	}
+
+	if (vulkan.legacy_barriers) {
+		vk_barrier_flush_legacy(vulkan, batch, cmd);
+	} else {
+		VkDependencyInfo dependency = {
+			.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+			.pNext = nullptr,
+			.dependencyFlags = 0,
+			.memoryBarrierCount = static_cast<uint32_t>(batch.memory.size()),
+			.pMemoryBarriers = batch.memory.data(),
+			.bufferMemoryBarrierCount = static_cast<uint32_t>(batch.buffers.size()),
+			.pBufferMemoryBarriers = batch.buffers.data(),
+			.imageMemoryBarrierCount = static_cast<uint32_t>(batch.images.size()),
+			.pImageMemoryBarriers = batch.images.data(),
+		};
+		vkCmdPipelineBarrier2(cmd, &dependency);
+		++vulkan.barrier_stats.commands;
+	}
+
+	++vulkan.barrier_stats.flushes;
+	vulkan.barrier_stats.memory += batch.memory.size();
+	vulkan.barrier_stats.buffers += batch.buffers.size();
+	vulkan.barrier_stats.images += batch.images.size();
+
+	batch.memory.clear();
+	batch.buffers.clear();
+	batch.images.clear();
+}
+
+void vk_create_timeline(vulkan_t & vulkan, VkQueue queue, vk_timeline_t & timeline) {
+	VkSemaphoreTypeCreateInfo type_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+		.pNext = nullptr,
+		.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+		.initialValue = 0,
+	};
+
+	VkSemaphoreCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = &type_create_info,
+		.flags = 0,
+	};
+
+	timeline.queue = queue;
+	timeline.submitted = 0;
+	timeline.completed = 0;
+	VK_CALL(vkCreateSemaphore(vulkan.device, &create_info, vulkan.allocator, &timeline.semaphore));
+}
+
+void vk_destroy_timeline(vulkan_t & vulkan, vk_timeline_t & timeline) {
+	vkDestroySemaphore(vulkan.device, timeline.semaphore, vulkan.allocator);
+	timeline.semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t vk_timeline_submit(vulkan_t & vulkan, vk_timeline_t & timeline, VkCommandBuffer cmd, const std::vector<vk_timeline_wait_t> & waits, VkSemaphore signal) {
+	std::vector<VkSemaphore> wait_semaphores(waits.size());
+	std::vector<uint64_t> wait_values(waits.size());
+	std::vector<VkPipelineStageFlags> wait_stages(waits.size());
+	for (size_t i = 0; i < waits.size(); ++i) {
+		wait_semaphores[i] = waits[i].semaphore;
+		wait_values[i] = waits[i].value;
+		wait_stages[i] = waits[i].stage;
+	}
+
+	// the binary semaphore's value is ignored, it only has to be there to keep the arrays the same length
+	uint64_t value = timeline.submitted + 1;
+	VkSemaphore signal_semaphores[2] = { timeline.semaphore, signal };
+	uint64_t signal_values[2] = { value, 0 };
+	uint32_t signal_count = signal != VK_NULL_HANDLE ? 2 : 1;
+
+	VkTimelineSemaphoreSubmitInfo timeline_info = {
+		.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+		.pNext = nullptr,
+		.waitSemaphoreValueCount = static_cast<uint32_t>(wait_values.size()),
+		.pWaitSemaphoreValues = wait_values.data(),
+		.signalSemaphoreValueCount = signal_count,
+		.pSignalSemaphoreValues = signal_values,
+	};
+
+	VkSubmitInfo submit_info = {
+		.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+		.pNext = &timeline_info,
+		.waitSemaphoreCount = static_cast<uint32_t>(wait_semaphores.size()),
+		.pWaitSemaphores = wait_semaphores.data(),
+		.pWaitDstStageMask = wait_stages.data(),
+		.commandBufferCount = 1,
+		.pCommandBuffers = &cmd,
+		.signalSemaphoreCount = signal_count,
+		.pSignalSemaphores = signal_semaphores,
+	};
+
+	VK_CALL(vkQueueSubmit(timeline.queue, 1, &submit_info, VK_NULL_HANDLE));
+	timeline.submitted = value;
+	return value;
+}
+
+// only asks the driver when the cached value isn't far enough along yet
+bool vk_timeline_done(vulkan_t & vulkan, vk_timeline_t & timeline, uint64_t value) {
+	if (value <= timeline.completed) {
+		return true;
+	}
+
+	VK_CALL(vkGetSemaphoreCounterValue(vulkan.device, timeline.semaphore, &timeline.completed));
+	return value <= timeline.completed;
+}
+
+void vk_timeline_wait(vulkan_t & vulkan, vk_timeline_t & timeline, uint64_t value) {
+	if (vk_timeline_done(vulkan, timeline, value)) {
+		return;
+	}
+
+	VkSemaphoreWaitInfo wait_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.semaphoreCount = 1,
+		.pSemaphores = &timeline.semaphore,
+		.pValues = &value,
+	};
+
+	VK_CALL(vkWaitSemaphores(vulkan.device, &wait_info, std::numeric_limits<uint64_t>::max()));
+	timeline.completed = value;
+}
+
+void vk_create_semaphores(vulkan_t & vulkan) {
+	vulkan.semaphores_img_avail.resize(vulkan.frames_in_flight);
+	vulkan.semaphores_render_finished.resize(vulkan.frames_in_flight);
+	vulkan.frame_values.assign(vulkan.frames_in_flight, 0);
+
+	VkSemaphoreCreateInfo semaphore_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+	};
+
+	for (uint32_t i = 0; i < vulkan.frames_in_flight; ++i) {
+		VK_CALL(vkCreateSemaphore(vulkan.device, &semaphore_create_info, vulkan.allocator, &vulkan.semaphores_img_avail[i]));
+		VK_CALL(vkCreateSemaphore(vulkan.device, &semaphore_create_info, vulkan.allocator, &vulkan.semaphores_render_finished[i]));
+	}
+}
+
+void vk_frames_in_flight(vulkan_t & vulkan, uint32_t new_count) {
+	if (new_count == 0 || new_count == vulkan.frames_in_flight) {
+		return;
+	}
+
+	vkDeviceWaitIdle(vulkan.device);
+
+	// with the device idle everything retired can go now
+	vk_defrag_flush(vulkan);
+
+	if (new_count < vulkan.frames_in_flight) {
+		for (uint32_t i = new_count; i < vulkan.frames_in_flight; ++i) {
+			vkDestroySemaphore(vulkan.device, vulkan.semaphores_img_avail[i], vulkan.allocator);
+			vkDestroySemaphore(vulkan.device, vulkan.semaphores_render_finished[i], vulkan.allocator);
+			vk_destroy_frame_cmds(vulkan, vulkan.frame_cmds[i]);
+		}
+	}
+
+	vulkan.semaphores_img_avail.resize(new_count);
+	vulkan.semaphores_render_finished.resize(new_count);
+	// a value of 0 is always reached, new frames have nothing to wait for
+	vulkan.frame_values.resize(new_count, 0);
+	vulkan.frame_cmds.resize(new_count);
+
+	if (new_count > vulkan.frames_in_flight) {
+		for (uint32_t i = vulkan.frames_in_flight; i < new_count; ++i) {
+			VkSemaphoreCreateInfo semaphore_create_info = {
+				.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+				.pNext = nullptr,
+				.flags = 0,
+			};
+
+			VK_CALL(vkCreateSemaphore(vulkan.device, &semaphore_create_info, vulkan.allocator, &vulkan.semaphores_img_avail[i]));
+			VK_CALL(vkCreateSemaphore(vulkan.device, &semaphore_create_info, vulkan.allocator, &vulkan.semaphores_render_finished[i]));
+			vk_create_frame_cmds(vulkan, vulkan.frame_cmds[i]);
+		}
+	}
+
+	if (vulkan.current_frame >= new_count) {
+		vulkan.current_frame = 0;
+	}
+
+	vulkan.frames_in_flight = new_count;
+
+	// the ring has one slice per frame
+	vk_destroy_uniform_ring(vulkan);
+	vk_create_uniform_ring(vulkan);
+
+	vkDestroyDescriptorPool(vulkan.device, vulkan.desc_pool, vulkan.allocator);
+	vk_create_descriptor_utilities(vulkan);
+
+	// every set was just rewritten with the current sampler and the device is idle
+	for (std::pair<VkSampler, uint64_t> & retired : vulkan.texture_stream.retired_samplers) {
+		vkDestroySampler(vulkan.device, retired.first, vulkan.allocator);
+	}
+	vulkan.texture_stream.retired_samplers.clear();
+	vulkan.texture_stream.stale_frames = 0;
+}
+
+void vk_recreate_swapchain(vulkan_t & vulkan) {
+	if (vulkan.window_width == 0 || vulkan.window_height == 0) {
+		return;
+	}
+	vkDeviceWaitIdle(vulkan.device);
+
+	// the framebuffers reference the swapchain views and the pooled images are the old size
+	vk_destroy_graph_images(vulkan);
+
+	for (uint32_t i = 0; i < vulkan.swapchain_image_count; ++i) {
+		vkDestroyImageView(vulkan.device, vulkan.swapchain_views[i], vulkan.allocator);
+	}
+
+	vkDestroySwapchainKHR(vulkan.device, vulkan.swapchain, vulkan.allocator);
+
+	vk_create_swapchain(
+		vulkan,
+
+		[](const std::vector<VkSurfaceFormatKHR> & formats) {
+			for (size_t i = 0; i < formats.size(); ++i) {
+				if (formats[i].format == VK_FORMAT_B8G8R8A8_SRGB && formats[i].colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+					return i;
+				}
+			}
+
+			return static_cast<size_t>(0);
+		},
+
+		[](const std::vector<VkPresentModeKHR> & modes) {
+			size_t fifo_index = 0ULL;
+			for (size_t i = 0; i < modes.size(); ++i) {
+				switch (modes[i]) {
+				case VK_PRESENT_MODE_FIFO_KHR:
+					fifo_index = i;
+					break;
+				case VK_PRESENT_MODE_MAILBOX_KHR:
+					return i;
+				default: break;
+				}
+			}
+
+			return fifo_index;
+		},
+
+		[](const VkSurfaceCapabilitiesKHR & capabilities) {
+			return VkExtent2D{ capabilities.currentExtent.width, capabilities.currentExtent.height };
+		},
+
+		[](uint32_t min, uint32_t max) {
+			uint32_t target = 2;
+			return std::max(std::min(target, max), min);
+		}
+	);
+}
+
+static constexpr VkBufferUsageFlags mesh_usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+// runs on a loader thread, so it must not touch vulkan_t
+static int vk_decode_mesh(std::vector<unsigned char> & bytes, vk_asset_t & asset) {
+	kobj_t kobj;
+	int ret = kobj_load(&kobj, (void *) bytes.data(), bytes.size());
+	if (ret != 0) {
+		return ret;
+	}
+
+	std::vector<vertex_t> & vertices = asset.vertices;
+	std::vector<uint32_t> & indices = asset.indices;
+	vertices.resize(kobj.vcount);
+	indices.resize(kobj.fcount * 3);
+
+	for (size_t i = 0; i < kobj.vcount; ++i) {
+		vertices[i].pos = {
+			kobj.vertices[i * 3 + 0],
+			kobj.vertices[i * 3 + 1],
+			kobj.vertices[i * 3 + 2],
+		};
+
+		vertices[i].color = { 1.0f, 1.0f, 1.0f };
+	}
+
+	for (size_t i = 0; i < kobj.fcount; ++i) {
+		if (kobj.faces[i].v1 != 0) {
+			indices[i * 3 + 0] = kobj.faces[i].v1 - 1;
+		}
+		if (kobj.faces[i].v2 != 0) {
+			indices[i * 3 + 1] = kobj.faces[i].v2 - 1;
+		}
+		if (kobj.faces[i].v3 != 0) {
+			indices[i * 3 + 2] = kobj.faces[i].v3 - 1;
+		}
+
+		if (kobj.faces[i].vt1 != 0) {
+			vertices[kobj.faces[i].v1 - 1].uv = { kobj.uvs[(kobj.faces[i].vt1 - 1) * 2 + 0], kobj.uvs[(kobj.faces[i].vt1 - 1) * 2 + 1] };
+		}
+		if (kobj.faces[i].vt2 != 0) {
+			vertices[kobj.faces[i].v2 - 1].uv = { kobj.uvs[(kobj.faces[i].vt2 - 1) * 2 + 0], kobj.uvs[(kobj.faces[i].vt2 - 1) * 2 + 1] };
+		}
+		if (kobj.faces[i].vt3 != 0) {
+			vertices[kobj.faces[i].v3 - 1].uv = { kobj.uvs[(kobj.faces[i].vt3 - 1) * 2 + 0], kobj.uvs[(kobj.faces[i].vt3 - 1) * 2 + 1] };
+		}
+	}
+
+	kobj_destroy(&kobj);
+	return 0;
+}
+
+// records the upload into the open staging batch, asset.buffer is null when the memory didn't fit
+static void vk_upload_mesh(vulkan_t & vulkan, vk_asset_t & asset) {
+	VkDeviceSize vsize = asset.vertices.size() * sizeof(vertex_t);
+	VkDeviceSize isize = asset.indices.size() * sizeof(uint32_t);
+	asset.size = vsize + isize;
+	asset.vertex_count = static_cast<uint32_t>(asset.vertices.size());
+	asset.index_count = static_cast<uint32_t>(asset.indices.size());
+
+	vk_memory_usage_t mesh_memory_usage = vulkan.caps.direct_upload ? MEMORY_USAGE_REBAR : MEMORY_USAGE_DEVICE;
+	asset.buffer = vk_create_buffer(vulkan, asset.size, mesh_usage, mesh_memory_usage, MEMORY_CATEGORY_MESH, asset.memory);
+	if (asset.buffer != VK_NULL_HANDLE) {
+		vk_upload_buffer(vulkan, asset.buffer, asset.memory, 0, asset.vertices.data(), vsize);
+		vk_upload_buffer(vulkan, asset.buffer, asset.memory, vsize, asset.indices.data(), isize);
+	}
+
+	asset.vertices.clear();
+	asset.vertices.shrink_to_fit();
+	asset.indices.clear();
+	asset.indices.shrink_to_fit();
+}
+
+void vk_create_uniform_ring(vulkan_t & vulkan) {
+	vk_uniform_ring_t & ring = vulkan.unif_ring;
+	ring.alignment = std::max<VkDeviceSize>(vulkan.caps.props.limits.minUniformBufferOffsetAlignment, 1);
+	ring.slice_size = (vulkan.unif_slice_size + ring.alignment - 1) & ~(ring.alignment - 1);
+	ring.base = 0;
+	ring.head = ring.reserved;
+	++ring.generation;
+
+	ring.buffer = vk_create_buffer(vulkan, ring.slice_size * vulkan.frames_in_flight, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, MEMORY_USAGE_REBAR, MEMORY_CATEGORY_UNIFORM, ring.memory);
+}
+
+void vk_destroy_uniform_ring(vulkan_t & vulkan) {
+	vkDestroyBuffer(vulkan.device, vulkan.unif_ring.buffer, vulkan.allocator);
+	vk_free_memory(vulkan, vulkan.unif_ring.memory);
+	vulkan.unif_ring.buffer = VK_NULL_HANDLE;
+}
+
+void vk_create_object_uniforms(vulkan_t & vulkan, vk_object_uniforms_t & uniforms, uint32_t count) {
+	vk_uniform_ring_t & ring = vulkan.unif_ring;
+	uniforms.stride = (sizeof(uniform_t) + ring.alignment - 1) & ~(ring.alignment - 1);
+	uniforms.offset = vk_uniform_reserve(vulkan, uniforms.stride * count);
+	uniforms.count = count;
+	uniforms.stale.assign(count, 0);
+	uniforms.pending.clear();
+	uniforms.pending.reserve(count);
+	uniforms.moved.resize(count);
+	// never matches, so the first update writes every slot
+	uniforms.ring_generation = ring.generation - 1;
+}
+
+// rebuilds the models that moved and writes this frame's copy of every slot it doesn't have yet
+void vk_update_object_uniforms(vulkan_t & vulkan, vk_object_uniforms_t & uniforms, ktransform_soa_t & soa, mat4x4 * models, mat4x4 const view, mat4x4 const proj, uint32_t thread_count) {
+	vk_uniform_ring_t & ring = vulkan.unif_ring;
+	uint32_t all_frames = vulkan.frames_in_flight >= 32 ? 0xFFFFFFFF : (1u << vulkan.frames_in_flight) - 1;
+
+	// assigning rather than or-ing also drops bits of frames a smaller frames_in_flight no longer has
+	if (uniforms.ring_generation != ring.generation || memcmp(uniforms.view, view, sizeof(mat4x4)) != 0 || memcmp(uniforms.proj, proj, sizeof(mat4x4)) != 0) {
+		uniforms.pending.clear();
+		for (uint32_t i = 0; i < uniforms.count; ++i) {
+			uniforms.stale[i] = all_frames;
+			uniforms.pending.push_back(i);
+		}
+		mat4x4_dup(uniforms.view, view);
+		mat4x4_dup(uniforms.proj, proj);
+		uniforms.ring_generation = ring.generation;
+	}
+
+	uint32_t moved = ktransform_build_touched(&soa, models, uniforms.moved.data(), thread_count);
+	for (uint32_t k = 0; k < moved; ++k) {
+		uint32_t i = uniforms.moved[k];
+		if (uniforms.stale[i] == 0) {
+			uniforms.pending.push_back(i);
+		}
+		uniforms.stale[i] = all_frames;
+	}
+
+	uint32_t frame_bit = 1u << vulkan.current_frame;
+	char * slots = static_cast<char *>(ring.memory.mapped) + ring.slice_size * vulkan.current_frame + uniforms.offset;
+	for (size_t k = 0; k < uniforms.pending.size();) {
+		uint32_t i = uniforms.pending[k];
+		if (uniforms.stale[i] & frame_bit) {
+			uniform_t * ubo = reinterpret_cast<uniform_t *>(slots + uniforms.stride * i);
+			mat4x4_dup(ubo->model, models[i]);
+			mat4x4_dup(ubo->view, view);
+			mat4x4_dup(ubo->proj, proj);
+			uniforms.stale[i] &= ~frame_bit;
+		}
+
+		if (uniforms.stale[i] == 0) {
+			uniforms.pending[k] = uniforms.pending.back();
+			uniforms.pending.pop_back();
+		} else {
+			++k;
+		}
+	}
+}
+
+VkBuffer vk_create_buffer(vulkan_t & vulkan, VkDeviceSize size, VkBufferUsageFlags usage, vk_memory_usage_t memory_usage, vk_memory_category_t category, vk_allocation_t & memory) {
+	VkBufferCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.size = size,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+	};
+
+	VkBuffer buffer;
+	VK_CALL(vkCreateBuffer(vulkan.device, &create_info, vulkan.allocator, &buffer));
+
+	VkMemoryRequirements reqs;
+	vkGetBufferMemoryRequirements(vulkan.device, buffer, &reqs);
+
+	memory = vk_alloc_memory(vulkan, reqs, memory_usage, category, false);
+	if (memory.memory == VK_NULL_HANDLE) {
+		vkDestroyBuffer(vulkan.device, buffer, vulkan.allocator);
+		return VK_NULL_HANDLE;
+	}
+	VK_CALL(vkBindBufferMemory(vulkan.device, buffer, memory.memory, memory.offset));
+
+	return buffer;
+}
+
+// places the allocation in one of the pool's existing shared blocks, allocation.pool has to be set already
+static bool vk_alloc_in_blocks(vk_memory_pool_t & pool, const VkMemoryRequirements & reqs, bool skip_empty, vk_allocation_t & allocation) {
+	for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+		vk_memory_block_t & block = pool.blocks[i];
+		if (block.memory == VK_NULL_HANDLE || block.dedicated || block.draining || (skip_empty && block.ranges.allocation_count == 0)) {
+			continue;
+		}
+
+		if (kalloc_alloc(&block.ranges, reqs.size, reqs.alignment, &allocation.offset, &allocation.handle) == 0) {
+			allocation.memory = block.memory;
+			allocation.size = reqs.size;
+			allocation.block = i;
+			allocation.mapped = block.mapped != nullptr ? static_cast<char *>(block.mapped) + allocation.offset : nullptr;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static void vk_memory_account(vulkan_t & vulkan, const vk_allocation_t & allocation, bool add) {
+	vk_memory_stats_t & stats = vulkan.memory_stats;
+	if (add) {
+		stats.category_bytes[allocation.category] += allocation.size;
+		++stats.category_count[allocation.category];
+	} else {
+		stats.category_bytes[allocation.category] -= allocation.size;
+		--stats.category_count[allocation.category];
+	}
+}
+
+// hands back the heap's spare empty blocks that vk_free_memory keeps around
+static bool vk_release_empty_blocks(vulkan_t & vulkan, uint32_t heap) {
+	bool released = false;
+	for (vk_memory_pool_t & pool : vulkan.memory_pools) {
+		if (vulkan.caps.memory.memoryTypes[pool.memory_type].heapIndex != heap) {
+			continue;
+		}
+
+		for (vk_memory_block_t & block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE || block.ranges.allocation_count != 0) {
+				continue;
+			}
+
+			vkFreeMemory(vulkan.device, block.memory, vulkan.allocator);
+			vulkan.memory_stats.heap_allocated[heap] -= block.ranges.size;
+			kalloc_destroy(&block.ranges);
+			block.memory = VK_NULL_HANDLE;
+			block.mapped = nullptr;
+			released = true;
+		}
+	}
+
+	return released;
+}
+
+vk_allocation_t vk_alloc_memory(vulkan_t & vulkan, const VkMemoryRequirements & reqs, vk_memory_usage_t usage, vk_memory_category_t category, bool optimal) {
+	uint32_t memory_type = vk_memory_type(vulkan, reqs.memoryTypeBits, usage);
+
+	// linear and optimal resources only have to be kept apart if they could share a granularity page
+	if (vulkan.caps.props.limits.bufferImageGranularity <= 1) {
+		optimal = false;
+	}
+
+	uint32_t pool_index = 0;
+	while (pool_index < vulkan.memory_pools.size() && (vulkan.memory_pools[pool_index].memory_type != memory_type || vulkan.memory_pools[pool_index].optimal != optimal)) {
+		++pool_index;
+	}
+
+	if (pool_index == vulkan.memory_pools.size()) {
+		const VkPhysicalDeviceMemoryProperties & mem_props = vulkan.caps.memory;
+		VkDeviceSize block_size = vulkan.memory_block_size;
+		VkDeviceSize heap_size = mem_props.memoryHeaps[mem_props.memoryTypes[memory_type].heapIndex].size;
+		while (block_size > heap_size / 8 && block_size > 1024 * 1024) {
+			block_size /= 2;
+		}
+
+		vulkan.memory_pools.push_back({
+			.memory_type = memory_type,
+			.optimal = optimal,
+			.block_size = block_size,
+			.blocks = {},
+		});
+	}
+
+	vk_memory_pool_t & pool = vulkan.memory_pools[pool_index];
+	vk_allocation_t allocation = {
+		.memory = VK_NULL_HANDLE,
+		.offset = 0,
+		.size = reqs.size,
+		.mapped = nullptr,
+		.pool = pool_index,
+		.block = 0,
+		.handle = KALLOC_NONE,
+		.category = category,
+	};
+
+	// anything over half a block gets its own allocation so it can't strand the rest of one
+	bool dedicated = reqs.size > pool.block_size / 2;
+	if (!dedicated && vk_alloc_in_blocks(pool, reqs, false, allocation)) {
+		vk_memory_account(vulkan, allocation, true);
+		return allocation;
+	}
+
+	VkDeviceSize block_size = dedicated ? reqs.size : pool.block_size;
+	uint32_t heap = vulkan.caps.memory.memoryTypes[memory_type].heapIndex;
+	vk_memory_stats_t & stats = vulkan.memory_stats;
+
+	// lazily allocated blocks only take up what the driver commits to them, which may be nothing
+	bool lazily_allocated = vulkan.caps.memory.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	if (!lazily_allocated && vk_memory_heap_usage(vulkan, heap) + block_size > stats.heap_budget[heap]) {
+		// the budget moves with other processes, so look again before evicting anything
+		vk_query_memory_budget(vulkan);
+	}
+
+	while (!lazily_allocated && vk_memory_heap_usage(vulkan, heap) + block_size > stats.heap_budget[heap]) {
+		VkDeviceSize excess = vk_memory_heap_usage(vulkan, heap) + block_size - stats.heap_budget[heap];
+		if (!vk_release_empty_blocks(vulkan, heap) && (!vulkan.memory_evict || !vulkan.memory_evict(vulkan, heap, excess))) {
+			#ifdef VK_DEBUG_INFO
+			std::cout << "Warning: memory heap " << heap << " is " << excess << " bytes over budget\n";
+			#endif
+			if (vulkan.memory_soft_fail) {
+				return allocation;
+			}
+			break;
+		}
+
+		// what was evicted may have left room in a block that is already there
+		if (!dedicated && vk_alloc_in_blocks(pool, reqs, false, allocation)) {
+			vk_memory_account(vulkan, allocation, true);
+			return allocation;
+		}
+	}
+
+	uint32_t block_index = 0;
+	while (block_index < pool.blocks.size() && pool.blocks[block_index].memory != VK_NULL_HANDLE) {
+		++block_index;
+	}
+	if (block_index == pool.blocks.size()) {
+		pool.blocks.push_back({});
+	}
+
+	vk_memory_block_t & block = pool.blocks[block_index];
+	VkMemoryAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.allocationSize = block_size,
+		.memoryTypeIndex = memory_type,
+	};
+
+	VkResult result = vkAllocateMemory(vulkan.device, &alloc_info, vulkan.allocator, &block.memory);
+	if (vulkan.memory_soft_fail && (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY)) {
+		block.memory = VK_NULL_HANDLE;
+		return allocation;
+	}
+	VK_CALL(result);
+	stats.heap_allocated[heap] += block_size;
+
+	block.dedicated = dedicated;
+	block.draining = false;
+	block.mapped = nullptr;
+	if (vulkan.caps.memory.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		VK_CALL(vkMapMemory(vulkan.device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mapped));
+	}
+
+	if (kalloc_create(&block.ranges, alloc_info.allocationSize) != 0 || kalloc_alloc(&block.ranges, reqs.size, reqs.alignment, &allocation.offset, &allocation.handle) != 0) {
+		std::cout << "Failed to sub-allocate a fresh memory block\n";
+		throw std::runtime_error("Failed to sub-allocate a fresh memory block");
+	}
+
+	allocation.memory = block.memory;
+	allocation.block = block_index;
+	allocation.mapped = block.mapped != nullptr ? static_cast<char *>(block.mapped) + allocation.offset : nullptr;
+	vk_memory_account(vulkan, allocation, true);
+	return allocation;
+}
+
+void vk_free_memory(vulkan_t & vulkan, vk_allocation_t & allocation) {
+	if (allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vk_memory_pool_t & pool = vulkan.memory_pools[allocation.pool];
+	vk_memory_block_t & block = pool.blocks[allocation.block];
+	kalloc_free(&block.ranges, allocation.handle);
+	vk_memory_account(vulkan, allocation, false);
+	allocation.memory = VK_NULL_HANDLE;
+	allocation.mapped = nullptr;
+
+	if (block.ranges.allocation_count != 0) {
+		return;
+	}
+	block.draining = false;
+
+	// keep one empty shared block around so a free/alloc pair at the boundary doesn't thrash the driver
+	bool spare = false;
+	for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+		vk_memory_block_t & other = pool.blocks[i];
+		if (i != allocation.block && other.memory != VK_NULL_HANDLE && !other.dedicated && other.ranges.allocation_count == 0) {
+			spare = true;
+		}
+	}
+
+	if (block.dedicated || spare) {
+		vkFreeMemory(vulkan.device, block.memory, vulkan.allocator);
+		vulkan.memory_stats.heap_allocated[vulkan.caps.memory.memoryTypes[pool.memory_type].heapIndex] -= block.ranges.size;
+		kalloc_destroy(&block.ranges);
+		block.memory = VK_NULL_HANDLE;
+		block.mapped = nullptr;
+	}
+}
+
+void vk_destroy_memory_pools(vulkan_t & vulkan) {
+	for (vk_memory_pool_t & pool : vulkan.memory_pools) {
+		for (vk_memory_block_t & block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			#ifdef VK_DEBUG_INFO
+			if (block.ranges.allocation_count != 0) {
+				std::cout << "Warning: memory block of type " << pool.memory_type << " still has " << block.ranges.allocation_count << " live allocations\n";
+			}
+			#endif
+
+			vkFreeMemory(vulkan.device, block.memory, vulkan.allocator);
+			vulkan.memory_stats.heap_allocated[vulkan.caps.memory.memoryTypes[pool.memory_type].heapIndex] -= block.ranges.size;
+			kalloc_destroy(&block.ranges);
+		}
+	}
+
+	vulkan.memory_pools.clear();
+}
+
+void vk_query_memory_budget(vulkan_t & vulkan) {
+	const VkPhysicalDeviceMemoryProperties & mem_props = vulkan.caps.memory;
+	vk_memory_stats_t & stats = vulkan.memory_stats;
+
+	if (vulkan.caps.memory_budget) {
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+			.pNext = nullptr,
+		};
+		VkPhysicalDeviceMemoryProperties2 props = {
+			.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+			.pNext = &budget,
+		};
+		vkGetPhysicalDeviceMemoryProperties2(vulkan.physical, &props);
+
+		for (uint32_t i = 0; i < mem_props.memoryHeapCount; ++i) {
+			stats.heap_usage[i] = budget.heapUsage[i];
+			stats.heap_budget[i] = std::min(budget.heapBudget[i], mem_props.memoryHeaps[i].size);
+			stats.heap_allocated_at_query[i] = stats.heap_allocated[i];
+		}
+		return;
+	}
+
+	for (uint32_t i = 0; i < mem_props.memoryHeapCount; ++i) {
+		stats.heap_usage[i] = 0;
+		stats.heap_budget[i] = mem_props.memoryHeaps[i].size / 10 * 8;
+		stats.heap_allocated_at_query[i] = 0;
+	}
+}
+
+std::string vk_memory_stats_json(vulkan_t & vulkan) {
+	const char * category_names[MEMORY_CATEGORY_COUNT] = { "mesh", "texture", "uniform", "depth", "staging" };
+	const VkPhysicalDeviceMemoryProperties & mem_props = vulkan.caps.memory;
+	const vk_memory_stats_t & stats = vulkan.memory_stats;
+
+	std::ostringstream json;
+	json << std::boolalpha << "{\"budget_extension\":" << vulkan.caps.memory_budget << ",\"categories\":{";
+	for (uint32_t i = 0; i < MEMORY_CATEGORY_COUNT; ++i) {
+		json << (i == 0 ? "" : ",") << "\"" << category_names[i] << "\":{\"bytes\":" << stats.category_bytes[i] << ",\"allocations\":" << stats.category_count[i] << "}";
+	}
+
+	json << "},\"heaps\":[";
+	for (uint32_t i = 0; i < mem_props.memoryHeapCount; ++i) {
+		json << (i == 0 ? "" : ",")
+			<< "{\"size\":" << mem_props.memoryHeaps[i].size
+			<< ",\"device_local\":" << ((mem_props.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0)
+			<< ",\"allocated\":" << stats.heap_allocated[i]
+			<< ",\"usage\":" << vk_memory_heap_usage(vulkan, i)
+			<< ",\"budget\":" << stats.heap_budget[i] << "}";
+	}
+
+	json << "],\"pools\":[";
+	for (size_t i = 0; i < vulkan.memory_pools.size(); ++i) {
+		const vk_memory_pool_t & pool = vulkan.memory_pools[i];
+		json << (i == 0 ? "" : ",")
+			<< "{\"memory_type\":" << pool.memory_type
+			<< ",\"heap\":" << mem_props.memoryTypes[pool.memory_type].heapIndex
+			<< ",\"optimal\":" << pool.optimal
+			<< ",\"block_size\":" << pool.block_size << ",\"blocks\":[";
+
+		bool first = true;
+		for (const vk_memory_block_t & block : pool.blocks) {
+			if (block.memory == VK_NULL_HANDLE) {
+				continue;
+			}
+			VkDeviceSize committed = block.ranges.size;
+			if (mem_props.memoryTypes[pool.memory_type].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+				vkGetDeviceMemoryCommitment(vulkan.device, block.memory, &committed);
+			}
+
+			json << (first ? "" : ",")
+				<< "{\"size\":" << block.ranges.size
+				<< ",\"committed\":" << committed
+				<< ",\"used\":" << block.ranges.used
+				<< ",\"allocations\":" << block.ranges.allocation_count
+				<< ",\"largest_free\":" << kalloc_largest_free(&block.ranges)
+				<< ",\"dedicated\":" << block.dedicated << "}";
+			first = false;
+		}
+		json << "]}";
+	}
+
+	json << "]}";
+	return json.str();
+}
+
+void vk_defrag_register_buffer(vulkan_t & vulkan, VkBuffer * buffer, vk_allocation_t * memory, VkDeviceSize size, VkBufferUsageFlags usage) {
+	vulkan.defrag.movables.push_back({
+		.memory = memory,
+		.buffer = buffer,
+		.image = nullptr,
+		.buffer_info = {
+			.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.size = size,
+			.usage = usage,
+			.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+			.queueFamilyIndexCount = 0,
+			.pQueueFamilyIndices = nullptr,
+		},
+		.image_info = {},
+		.layout = VK_IMAGE_LAYOUT_UNDEFINED,
+		.patch = nullptr,
+	});
+}
+
+void vk_defrag_register_image(vulkan_t & vulkan, VkImage * image, vk_allocation_t * memory, const VkImageCreateInfo & create_info, VkImageLayout layout, std::function<void(vulkan_t &)> patch) {
+	vulkan.defrag.movables.push_back({
+		.memory = memory,
+		.buffer = nullptr,
+		.image = image,
+		.buffer_info = {},
+		.image_info = create_info,
+		.layout = layout,
+		.patch = patch,
+	});
+}
+
+void vk_defrag_unregister(vulkan_t & vulkan, vk_allocation_t * memory) {
+	std::vector<vk_movable_t> & movables = vulkan.defrag.movables;
+	for (size_t i = 0; i < movables.size(); ++i) {
+		if (movables[i].memory == memory) {
+			movables.erase(movables.begin() + i);
+			return;
+		}
+	}
+}
+
+static void vk_defrag_destroy(vulkan_t & vulkan, vk_retired_t & retired) {
+	if (retired.view != VK_NULL_HANDLE) {
+		vkDestroyImageView(vulkan.device, retired.view, vulkan.allocator);
+	}
+	if (retired.buffer != VK_NULL_HANDLE) {
+		vkDestroyBuffer(vulkan.device, retired.buffer, vulkan.allocator);
+	}
+	if (retired.image != VK_NULL_HANDLE) {
+		vkDestroyImage(vulkan.device, retired.image, vulkan.allocator);
+	}
+	vk_free_memory(vulkan, retired.memory);
+}
+
+void vk_defrag_flush(vulkan_t & vulkan) {
+	for (vk_retired_t & retired : vulkan.defrag.retired) {
+		vk_defrag_destroy(vulkan, retired);
+	}
+	vulkan.defrag.retired.clear();
+}
+
+// the emptiest shared block that is under the threshold, holds only movable allocations and whose
+// contents fit in the free space of the other non-empty blocks of its pool
+static bool vk_defrag_pick(vulkan_t & vulkan) {
+	vk_defrag_t & defrag = vulkan.defrag;
+	float best_ratio = vulkan.defrag_threshold;
+	bool found = false;
+
+	for (uint32_t p = 0; p < vulkan.memory_pools.size(); ++p) {
+		vk_memory_pool_t & pool = vulkan.memory_pools[p];
+
+		VkDeviceSize free_total = 0;
+		for (vk_memory_block_t & block : pool.blocks) {
+			if (block.memory != VK_NULL_HANDLE && !block.dedicated && !block.draining && block.ranges.allocation_count != 0) {
+				free_total += block.ranges.size - block.ranges.used;
+			}
+		}
+
+		for (uint32_t b = 0; b < pool.blocks.size(); ++b) {
+			vk_memory_block_t & block = pool.blocks[b];
+			if (block.memory == VK_NULL_HANDLE || block.dedicated || block.draining || block.ranges.allocation_count == 0) {
+				continue;
+			}
+
+			float ratio = static_cast<float>(block.ranges.used) / static_cast<float>(block.ranges.size);
+			if (ratio >= best_ratio || free_total - (block.ranges.size - block.ranges.used) < block.ranges.used) {
+				continue;
+			}
+
+			uint32_t movable = 0;
+			for (vk_movable_t & m : defrag.movables) {
+				if (m.memory->memory != VK_NULL_HANDLE && m.memory->pool == p && m.memory->block == b) {
+					++movable;
+				}
+			}
+			if (movable != block.ranges.allocation_count) {
+				continue;
+			}
+
+			best_ratio = ratio;
+			defrag.pool = p;
+			defrag.block = b;
+			found = true;
+		}
+	}
+
+	if (found) {
+		vulkan.memory_pools[defrag.pool].blocks[defrag.block].draining = true;
+	}
+	return found;
+}
+
+// true while the graphics family still has to acquire m from the transfer queue, the frame that records the
+// acquire names the current handle, so it can't be copied or retired before then
+static bool vk_defrag_acquire_pending(vulkan_t & vulkan, const vk_movable_t & m) {
+	const vk_staging_t & staging = vulkan.staging;
+	for (const vk_barrier_batch_t * batch : { &staging.acquires, &staging.open_acquires }) {
+		if (m.buffer != nullptr) {
+			for (const VkBufferMemoryBarrier2 & barrier : batch->buffers) {
+				if (barrier.buffer == *m.buffer) {
+					return true;
+				}
+			}
+		} else {
+			for (const VkImageMemoryBarrier2 & barrier : batch->images) {
+				if (barrier.image == *m.image) {
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+void vk_defrag_step(vulkan_t & vulkan) {
+	vk_defrag_t & defrag = vulkan.defrag;
+
+	// once the graphics timeline is past an entry's value nothing submitted still uses it
+	for (size_t i = 0; i < defrag.retired.size();) {
+		if (vk_timeline_done(vulkan, vulkan.graphics_timeline, defrag.retired[i].value)) {
+			vk_defrag_destroy(vulkan, defrag.retired[i]);
+			defrag.retired.erase(defrag.retired.begin() + i);
+		} else {
+			++i;
+		}
+	}
+
+	// moves run on the graphics queue, so they can't overlap copies still running on the transfer queue
+	if (vulkan.transfer_family != vulkan.graphics_family && !vk_staging_done(vulkan, vulkan.transfer_timeline.submitted)) {
+		return;
+	}
+
+	if (defrag.block == KALLOC_NONE && !vk_defrag_pick(vulkan)) {
+		return;
+	}
+
+	struct move_t {
+		vk_movable_t * movable;
+		VkBuffer buffer;
+		VkImage image;
+		vk_allocation_t memory;
+	};
+
+	// new homes first, so the copies can be recorded between one pair of barriers
+	vk_memory_pool_t & pool = vulkan.memory_pools[defrag.pool];
+	std::vector<move_t> moves;
+	VkDeviceSize moved = 0;
+	bool stuck = false;
+	bool waiting = false;
+	for (vk_movable_t & m : defrag.movables) {
+		if (m.memory->memory == VK_NULL_HANDLE || m.memory->pool != defrag.pool || m.memory->block != defrag.block) {
+			continue;
+		}
+		if (moved >= vulkan.defrag_budget) {
+			break;
+		}
+		if (vulkan.transfer_family != vulkan.graphics_family && vk_defrag_acquire_pending(vulkan, m)) {
+			waiting = true;
+			continue;
+		}
+
+		move_t move = {
+			.movable = &m,
+			.buffer = VK_NULL_HANDLE,
+			.image = VK_NULL_HANDLE,
+			.memory = {},
+		};
+		move.memory.pool = defrag.pool;
+		move.memory.category = m.memory->category;
+
+		VkMemoryRequirements reqs;
+		if (m.buffer != nullptr) {
+			VK_CALL(vkCreateBuffer(vulkan.device, &m.buffer_info, vulkan.allocator, &move.buffer));
+			vkGetBufferMemoryRequirements(vulkan.device, move.buffer, &reqs);
+		} else {
+			VK_CALL(vkCreateImage(vulkan.device, &m.image_info, vulkan.allocator, &move.image));
+			vkGetImageMemoryRequirements(vulkan.device, move.image, &reqs);
+		}
+
+		// only into blocks that are already in use, moving into an empty one would free nothing
+		if (!vk_alloc_in_blocks(pool, reqs, true, move.memory)) {
+			vkDestroyBuffer(vulkan.device, move.buffer, vulkan.allocator);
+			vkDestroyImage(vulkan.device, move.image, vulkan.allocator);
+			stuck = true;
+			break;
+		}
+		vk_memory_account(vulkan, move.memory, true);
+
+		if (m.buffer != nullptr) {
+			VK_CALL(vkBindBufferMemory(vulkan.device, move.buffer, move.memory.memory, move.memory.offset));
+		} else {
+			VK_CALL(vkBindImageMemory(vulkan.device, move.image, move.memory.memory, move.memory.offset));
+		}
+
+		moves.push_back(move);
+		moved += move.memory.size;
+	}
+
+	if (stuck) {
+		// too fragmented elsewhere to take the rest, give up on this block and let it fill again
+		pool.blocks[defrag.block].draining = false;
+		defrag.block = KALLOC_NONE;
+	}
+	if (moves.empty()) {
+		// everything is out, the block is released when the last retired copy is freed. What is still waiting
+		// for its acquire is tried again next frame.
+		if (!waiting) {
+			defrag.block = KALLOC_NONE;
+		}
+		return;
+	}
+
+	// submitted ahead of this frame's own work, so the frame's pool reset already covers it
+	VkCommandBuffer cmd_buffer = vk_frame_cmd(vulkan);
+	vk_begin_cmd(vulkan, cmd_buffer);
+
+	// earlier frames may still be writing or reading the old copies, and later ones read the new ones
+	vk_barrier_batch_t before;
+	vk_barrier_batch_t after;
+	before.memory.push_back({
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+	});
+	after.memory.push_back({
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+	});
+
+	for (move_t & move : moves) {
+		if (move.image == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		// the copies are only used in their layout's stages, so the image barriers needn't cover every stage
+		VkPipelineStageFlags2 layout_stages;
+		VkAccessFlags2 layout_access;
+		if (kgraph_layout_access(move.movable->layout, &layout_stages, &layout_access) != 0) {
+			layout_stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			layout_access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+		}
+
+		const VkImageCreateInfo & info = move.movable->image_info;
+		VkImageMemoryBarrier2 barrier = {
+			.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+			.pNext = nullptr,
+			.srcStageMask = layout_stages,
+			.srcAccessMask = layout_access,
+			.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+			.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT,
+			.oldLayout = move.movable->layout,
+			.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+			.image = *move.movable->image,
+			.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, info.mipLevels, 0, info.arrayLayers },
+		};
+		before.images.push_back(barrier);
+
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_NONE;
+		barrier.srcAccessMask = VK_ACCESS_2_NONE;
+		barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.image = move.image;
+		before.images.push_back(barrier);
+
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = layout_stages;
+		barrier.dstAccessMask = layout_access;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = move.movable->layout;
+		after.images.push_back(barrier);
+	}
+
+	vk_barrier_flush(vulkan, before, cmd_buffer);
+
+	for (move_t & move : moves) {
+		vk_movable_t & m = *move.movable;
+		if (move.buffer != VK_NULL_HANDLE) {
+			VkBufferCopy copy = {
+				.srcOffset = 0,
+				.dstOffset = 0,
+				.size = m.buffer_info.size,
+			};
+			vkCmdCopyBuffer(cmd_buffer, *m.buffer, move.buffer, 1, &copy);
+			continue;
+		}
+
+		std::vector<VkImageCopy> regions(m.image_info.mipLevels);
+		for (uint32_t level = 0; level < m.image_info.mipLevels; ++level) {
+			VkImageSubresourceLayers subresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, m.image_info.arrayLayers };
+			regions[level] = {
+				.srcSubresource = subresource,
+				.srcOffset = { 0, 0, 0 },
+				.dstSubresource = subresource,
+				.dstOffset = { 0, 0, 0 },
+				.extent = {
+					std::max(m.image_info.extent.width >> level, 1u),
+					std::max(m.image_info.extent.height >> level, 1u),
+					std::max(m.image_info.extent.depth >> level, 1u),
+				},
+			};
+		}
+		vkCmdCopyImage(cmd_buffer, *m.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, move.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+	}
+
+	vk_barrier_flush(vulkan, after, cmd_buffer);
+	vk_end_cmd(vulkan, cmd_buffer);
+
+	// frames submitted from here on use the new copies, the old ones go once the move itself is done,
+	// which on the one queue also means every frame before it
+	uint64_t value = vk_timeline_submit(vulkan, vulkan.graphics_timeline, cmd_buffer, {});
+	for (move_t & move : moves) {
+		vk_movable_t & m = *move.movable;
+		defrag.retired.push_back({
+			.buffer = m.buffer != nullptr ? *m.buffer : VK_NULL_HANDLE,
+			.image = m.image != nullptr ? *m.image : VK_NULL_HANDLE,
+			.view = VK_NULL_HANDLE,
+			.memory = *m.memory,
+			.value = value,
+		});
+
+		if (m.buffer != nullptr) {
+			*m.buffer = move.buffer;
+		} else {
+			*m.image = move.image;
+		}
+		*m.memory = move.memory;
+
+		if (m.patch) {
+			m.patch(vulkan);
+		}
+	}
+}
+
+void vk_copy_buffer(vulkan_t & vulkan, VkBuffer src, VkBuffer dst, VkDeviceSize size) {
+	VkBufferCopy copy = {
+		.srcOffset = 0,
+		.dstOffset = 0,
+		.size = size,
+	};
+
+	vkCmdCopyBuffer(vk_staging_cmd(vulkan), src, dst, 1, &copy);
+}
+
+void vk_create_staging(vulkan_t & vulkan) {
+	vk_staging_t & staging = vulkan.staging;
+	staging.size = vulkan.staging_size;
+	staging.head = 0;
+	staging.cmd = VK_NULL_HANDLE;
+	staging.batch_begin = 0;
+	staging.barriers = {};
+	staging.open_acquires = {};
+	staging.open_acquire_stages = 0;
+	staging.acquires = {};
+	staging.acquire_stages = 0;
+	staging.acquire_value = 0;
+	staging.buffer = vk_create_buffer(vulkan, staging.size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, MEMORY_USAGE_UPLOAD, MEMORY_CATEGORY_STAGING, staging.memory);
+}
+
+void vk_destroy_staging(vulkan_t & vulkan) {
+	vk_staging_t & staging = vulkan.staging;
+	vk_staging_flush(vulkan);
+
+	if (!staging.spare_cmds.empty()) {
+		vkFreeCommandBuffers(vulkan.device, vulkan.transfer_cmd_pool, static_cast<uint32_t>(staging.spare_cmds.size()), staging.spare_cmds.data());
+	}
+	staging.spare_cmds.clear();
+	staging.barriers = {};
+	staging.open_acquires = {};
+	staging.acquires = {};
+
+	vkDestroyBuffer(vulkan.device, staging.buffer, vulkan.allocator);
+	vk_free_memory(vulkan, staging.memory);
+	staging.buffer = VK_NULL_HANDLE;
+}
+
+// pops finished batches off the front, when wait is set it blocks on the oldest one first
+static void vk_staging_retire(vulkan_t & vulkan, bool wait) {
+	vk_staging_t & staging = vulkan.staging;
+	while (!staging.in_flight.empty()) {
+		vk_staging_batch_t & batch = staging.in_flight.front();
+		if (wait) {
+			vk_timeline_wait(vulkan, vulkan.transfer_timeline, batch.value);
+			wait = false;
+		} else if (!vk_timeline_done(vulkan, vulkan.transfer_timeline, batch.value)) {
+			break;
+		}
+
+		staging.spare_cmds.push_back(batch.cmd);
+		staging.in_flight.erase(staging.in_flight.begin());
+	}
+}
+
+// the bytes in use run from the oldest batch's begin up to head, possibly wrapping past the end.
+// head is never allowed to catch up with that tail, so head == tail only ever means empty, which
+// batches holding only transitions leave it as
+static bool vk_staging_fit(vk_staging_t & staging, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize * out_offset) {
+	if (staging.in_flight.empty() && staging.cmd == VK_NULL_HANDLE) {
+		staging.head = 0;
+		*out_offset = 0;
+		return true;
+	}
+
+	VkDeviceSize tail = staging.in_flight.empty() ? staging.batch_begin : staging.in_flight.front().begin;
+	VkDeviceSize begin = (staging.head + alignment - 1) / alignment * alignment;
+	if (staging.head >= tail) {
+		if (begin + size <= staging.size) {
+			*out_offset = begin;
+			return true;
+		}
+		if (size < tail) {
+			*out_offset = 0;
+			return true;
+		}
+		return false;
+	}
+
+	if (begin + size < tail) {
+		*out_offset = begin;
+		return true;
+	}
+	return false;
+}
+
+// a batch that starts at head holds no bytes of the ring until something is allocated for it
+static void vk_staging_open(vulkan_t & vulkan, VkDeviceSize begin) {
+	vk_staging_t & staging = vulkan.staging;
+	if (!staging.spare_cmds.empty()) {
+		staging.cmd = staging.spare_cmds.back();
+		staging.spare_cmds.pop_back();
+	} else {
+		VkCommandBufferAllocateInfo alloc_info = {
+			.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.commandPool = vulkan.transfer_cmd_pool,
+			.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+			.commandBufferCount = 1,
+		};
+		VK_CALL(vkAllocateCommandBuffers(vulkan.device, &alloc_info, &staging.cmd));
+	}
+
+	vk_begin_cmd(vulkan, staging.cmd);
+	staging.batch_begin = begin;
+}
+
+void * vk_staging_alloc(vulkan_t & vulkan, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize * out_offset) {
+	vk_staging_t & staging = vulkan.staging;
+	if (size > staging.size) {
+		std::cout << "Staging allocation of " << size << " bytes is larger than the ring\n";
+		throw std::runtime_error("Staging allocation is larger than the ring");
+	}
+
+	vk_staging_retire(vulkan, false);
+
+	VkDeviceSize offset;
+	while (!vk_staging_fit(staging, size, alignment, &offset)) {
+		// the open batch has to be in flight before waiting can free anything it holds
+		vk_staging_submit(vulkan);
+		vk_staging_retire(vulkan, true);
+	}
+
+	if (staging.cmd == VK_NULL_HANDLE) {
+		vk_staging_open(vulkan, offset);
+	}
+
+	staging.head = offset + size;
+	*out_offset = offset;
+	return static_cast<char *>(staging.memory.mapped) + offset;
+}
+
+// whatever transitions and releases piled up since the last command go out first, in one barrier
+VkCommandBuffer vk_staging_cmd(vulkan_t & vulkan) {
+	if (vulkan.staging.cmd == VK_NULL_HANDLE) {
+		vk_staging_open(vulkan, vulkan.staging.head);
+	}
+
+	vk_barrier_flush(vulkan, vulkan.staging.barriers, vulkan.staging.cmd);
+	return vulkan.staging.cmd;
+}
+
+// returns the serial of the batch that was submitted, or of the last one when nothing was open
+uint64_t vk_staging_submit(vulkan_t & vulkan) {
+	vk_staging_t & staging = vulkan.staging;
+	if (staging.cmd == VK_NULL_HANDLE) {
+		return vulkan.transfer_timeline.submitted;
+	}
+
+	// anything submitted after this batch sees its writes without having to wait on the timeline,
+	// recorded together with the last transitions and releases
+	staging.barriers.memory.push_back({
+		.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+		.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		.dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+		.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT,
+	});
+	vk_barrier_flush(vulkan, staging.barriers, staging.cmd);
+
+	vk_end_cmd(vulkan, staging.cmd);
+
+	uint64_t value = vk_timeline_submit(vulkan, vulkan.transfer_timeline, staging.cmd, {});
+
+	// what the batch released can only be acquired once the graphics queue has waited for it, and waiting
+	// on the latest value covers every batch before it
+	if (staging.open_acquire_stages != 0) {
+		staging.acquire_value = value;
+		staging.acquires.buffers.insert(staging.acquires.buffers.end(), staging.open_acquires.buffers.begin(), staging.open_acquires.buffers.end());
+		staging.acquires.images.insert(staging.acquires.images.end(), staging.open_acquires.images.begin(), staging.open_acquires.images.end());
+		staging.acquire_stages |= staging.open_acquire_stages;
+		staging.open_acquires = {};
+		staging.open_acquire_stages = 0;
+	}
+
+	staging.in_flight.push_back({
+		.begin = staging.batch_begin,
+		.cmd = staging.cmd,
+		.value = value,
+	});
+	staging.cmd = VK_NULL_HANDLE;
+	return value;
+}
+
+// a serial past the last submitted one is the open batch, which is submitted first
+void vk_staging_wait(vulkan_t & vulkan, uint64_t serial) {
+	if (serial > vulkan.transfer_timeline.submitted) {
+		serial = vk_staging_submit(vulkan);
+	}
+
+	vk_timeline_wait(vulkan, vulkan.transfer_timeline, serial);
+	vk_staging_retire(vulkan, false);
+}
+
+bool vk_staging_done(vulkan_t & vulkan, uint64_t serial) {
+	return vk_timeline_done(vulkan, vulkan.transfer_timeline, serial);
+}
+
+// adds the acquire half of every ownership transfer submitted since the last frame to barriers, the
+// frame's submit has to wait for the transfer timeline at the added entry
+void vk_staging_acquire(vulkan_t & vulkan, vk_barrier_batch_t & barriers, std::vector<vk_timeline_wait_t> & waits) {
+	vk_staging_t & staging = vulkan.staging;
+	if (staging.acquire_stages == 0) {
+		return;
+	}
+
+	// each barrier's first scope is the stages the timeline is waited at, so it chains after the wait
+	barriers.buffers.insert(barriers.buffers.end(), staging.acquires.buffers.begin(), staging.acquires.buffers.end());
+	barriers.images.insert(barriers.images.end(), staging.acquires.images.begin(), staging.acquires.images.end());
+
+	waits.push_back({ vulkan.transfer_timeline.semaphore, staging.acquire_value, staging.acquire_stages });
+
+	staging.acquires = {};
+	staging.acquire_stages = 0;
+}
+
+void vk_staging_flush(vulkan_t & vulkan) {
+	vk_staging_submit(vulkan);
+	while (!vulkan.staging.in_flight.empty()) {
+		vk_staging_retire(vulkan, true);
+	}
+}
+
+void vk_staging_upload_buffer(vulkan_t & vulkan, VkBuffer dst, VkDeviceSize dst_offset, const void * data, VkDeviceSize size) {
+	VkDeviceSize chunk_size = vulkan.staging.size / 4;
+	for (VkDeviceSize done = 0; done < size;) {
+		VkDeviceSize chunk = std::min(chunk_size, size - done);
+		VkDeviceSize offset;
+		void * mapped = vk_staging_alloc(vulkan, chunk, 4, &offset);
+		memcpy(mapped, static_cast<const char *>(data) + done, chunk);
+
+		VkBufferCopy copy = {
+			.srcOffset = offset,
+			.dstOffset = dst_offset + done,
+			.size = chunk,
+		};
+		vkCmdCopyBuffer(vk_staging_cmd(vulkan), vulkan.staging.buffer, dst, 1, &copy);
+
+		// staged buffers are vertex and index data, handed to the graphics family in the same batch as the copy
+		if (vulkan.transfer_family != vulkan.graphics_family) {
+			VkBufferMemoryBarrier2 release = {
+				.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+				.pNext = nullptr,
+				.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT,
+				.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT,
+				.dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+				.dstAccessMask = VK_ACCESS_2_NONE,
+				.srcQueueFamilyIndex = vulkan.transfer_family,
+				.dstQueueFamilyIndex = vulkan.graphics_family,
+				.buffer = dst,
+				.offset = dst_offset + done,
+				.size = chunk,
+			};
+			vulkan.staging.barriers.buffers.push_back(release);
+
+			release.srcStageMask = VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
+			release.srcAccessMask = VK_ACCESS_2_NONE;
+			release.dstStageMask = VK_PIPELINE_STAGE_2_VERTEX_INPUT_BIT;
+			release.dstAccessMask = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT;
+			vulkan.staging.open_acquires.buffers.push_back(release);
+			vulkan.staging.open_acquire_stages |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+		}
+
+		// full chunks go to the gpu right away so it copies while the next one is filled
+		if (chunk == chunk_size) {
+			vk_staging_submit(vulkan);
+		}
+		done += chunk;
+	}
+}
+
+// mapped memory is always coherent, so writing it in place is enough and the staging copy is skipped
+void vk_upload_buffer(vulkan_t & vulkan, VkBuffer dst, const vk_allocation_t & memory, VkDeviceSize dst_offset, const void * data, VkDeviceSize size) {
+	if (memory.mapped != nullptr) {
+		memcpy(static_cast<char *>(memory.mapped) + dst_offset, data, size);
+		return;
+	}
+
+	vk_staging_upload_buffer(vulkan, dst, dst_offset, data, size);
+}
+
+// regions' bufferOffset index into data and the image has to be in TRANSFER_DST_OPTIMAL.
+// a region bigger than a chunk is split into bands of whole block rows, one slice at a time
+void vk_staging_upload_image(vulkan_t & vulkan, VkImage image, const unsigned char * data, const std::vector<VkBufferImageCopy> & regions, uint32_t block_width, uint32_t block_height, uint32_t block_bytes) {
+	// buffer offsets have to be a multiple of both 4 and the texel block size
+	VkDeviceSize alignment = block_bytes;
+	while (alignment % 4 != 0) {
+		alignment += block_bytes;
+	}
+
+	VkDeviceSize chunk_size = vulkan.staging.size / 4;
+	VkDeviceSize pending = 0;
+	auto copy = [&](VkBufferImageCopy region, VkDeviceSize src_offset, VkDeviceSize size) {
+		VkDeviceSize offset;
+		void * mapped = vk_staging_alloc(vulkan, size, alignment, &offset);
+		memcpy(mapped, data + src_offset, size);
+
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+		vkCmdCopyBufferToImage(vk_staging_cmd(vulkan), vulkan.staging.buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+		pending += size;
+		if (pending >= chunk_size) {
+			vk_staging_submit(vulkan);
+			pending = 0;
+		}
+	};
+
+	for (const VkBufferImageCopy & region : regions) {
+		VkExtent3D extent = region.imageExtent;
+		VkDeviceSize row_bytes = static_cast<VkDeviceSize>((extent.width + block_width - 1) / block_width) * block_bytes;
+		uint32_t rows = (extent.height + block_height - 1) / block_height;
+		VkDeviceSize slice_bytes = row_bytes * rows;
+
+		if (slice_bytes * extent.depth <= chunk_size) {
+			copy(region, region.bufferOffset, slice_bytes * extent.depth);
+			continue;
+		}
+
+		uint32_t band = static_cast<uint32_t>(std::max<VkDeviceSize>(chunk_size / row_bytes, 1));
+		for (uint32_t z = 0; z < extent.depth; ++z) {
+			for (uint32_t row = 0; row < rows; row += band) {
+				uint32_t count = std::min(band, rows - row);
+
+				VkBufferImageCopy part = region;
+				part.imageOffset.y += static_cast<int32_t>(row * block_height);
+				part.imageOffset.z += static_cast<int32_t>(z);
+				part.imageExtent.height = std::min(count * block_height, extent.height - row * block_height);
+				part.imageExtent.depth = 1;
+				copy(part, region.bufferOffset + slice_bytes * z + row_bytes * row, row_bytes * count);
+			}
+		}
+	}
+}
+
+void vk_create_descriptor_utilities(vulkan_t & vulkan) {
+	VkDescriptorPoolSize pool_sizes[2] = {
+		{
+			.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			.descriptorCount = vulkan.frames_in_flight,
+		},
+		{
+			.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+			.descriptorCount = vulkan.frames_in_flight,
+		},
+	};
+
+	VkDescriptorPoolCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.maxSets = vulkan.frames_in_flight,
+		.poolSizeCount = 2,
+		.pPoolSizes = pool_sizes,
+	};
+
+	VK_CALL(vkCreateDescriptorPool(vulkan.device, &create_info, vulkan.allocator, &vulkan.desc_pool));
+
+	std::vector<VkDescriptorSetLayout> layouts(vulkan.frames_in_flight, vulkan.desc_layout);
+	VkDescriptorSetAllocateInfo alloc_info = {
+		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+		.pNext = nullptr,
+		.descriptorPool = vulkan.desc_pool,
+		.descriptorSetCount = vulkan.frames_in_flight,
+		.pSetLayouts = layouts.data(),
+	};
+
+	vulkan.desc_sets.resize(vulkan.frames_in_flight);
+	VK_CALL(vkAllocateDescriptorSets(vulkan.device, &alloc_info, vulkan.desc_sets.data()));
+
+	for (uint32_t i = 0; i < vulkan.frames_in_flight; ++i) {
+		// the draw picks its slot in the ring with a dynamic offset
+		VkDescriptorBufferInfo buffer_info = {
+			.buffer = vulkan.unif_ring.buffer,
+			.offset = 0,
+			.range = sizeof(uniform_t),
+		};
+
+		VkDescriptorImageInfo image_info = {
+			.sampler = vulkan.texture_sampler,
+			.imageView = vulkan.texture_view,
+			.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		};
+
+		VkWriteDescriptorSet writes[2] = {
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = vulkan.desc_sets[i],
+				.dstBinding = 0,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.pImageInfo = nullptr,
+				.pBufferInfo = &buffer_info,
+				.pTexelBufferView = nullptr,
+			},
+			{
+				.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+				.pNext = nullptr,
+				.dstSet = vulkan.desc_sets[i],
+				.dstBinding = 1,
+				.dstArrayElement = 0,
+				.descriptorCount = 1,
+				.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.pImageInfo = &image_info,
+				.pBufferInfo = nullptr,
+				.pTexelBufferView = nullptr,
+			},
+		};
+
+		vkUpdateDescriptorSets(vulkan.device, 2, writes, 0, nullptr);
+	}
+}
+
+// the texture's view points at the old image, and every frame's set has to pick up the new view at its turn
+static void vk_texture_moved(vulkan_t & vulkan, VkImageViewCreateInfo create_info) {
+	vulkan.defrag.retired.push_back({
+		.buffer = VK_NULL_HANDLE,
+		.image = VK_NULL_HANDLE,
+		.view = vulkan.texture_view,
+		.memory = {},
+		.value = vulkan.graphics_timeline.submitted,
+	});
+
+	create_info.image = vulkan.texture;
+	VK_CALL(vkCreateImageView(vulkan.device, &create_info, vulkan.allocator, &vulkan.texture_view));
+	vulkan.texture_stream.stale_frames = (1u << vulkan.frames_in_flight) - 1;
+}
+
+// hands the current texture to the graphics timeline before something else takes its place, frames in flight
+// may still be sampling it
+static void vk_retire_texture(vulkan_t & vulkan) {
+	if (vulkan.texture == VK_NULL_HANDLE) {
+		return;
+	}
+
+	uint64_t value = vulkan.graphics_timeline.submitted;
+
+	vk_defrag_unregister(vulkan, &vulkan.texture_memory);
+	vulkan.defrag.retired.push_back({
+		.buffer = VK_NULL_HANDLE,
+		.image = vulkan.texture,
+		.view = vulkan.texture_view,
+		.memory = vulkan.texture_memory,
+		.value = value,
+	});
+	vulkan.texture_stream.retired_samplers.push_back({ vulkan.texture_sampler, value });
+}
+
+// frames draw with asset from now on, every frame's set picks it up at its turn in vk_stream_textures
+static void vk_set_texture(vulkan_t & vulkan, vk_asset_t & asset) {
+	vk_retire_texture(vulkan);
+
+	vulkan.texture = asset.image;
+	vulkan.texture_memory = asset.memory;
+	vulkan.texture_view = asset.view;
+	vulkan.texture_sampler = asset.sampler;
+
+	VkImageViewCreateInfo view_info = asset.view_info;
+	vk_defrag_register_image(vulkan, &vulkan.texture, &vulkan.texture_memory, asset.image_info, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, [view_info](vulkan_t & vulkan) {
+		vk_texture_moved(vulkan, view_info);
+	});
+	vulkan.texture_stream.stale_frames = (1u << vulkan.frames_in_flight) - 1;
+}
+
+// records the upload into the open staging batch, asset.image is null when the memory didn't fit
+static void vk_upload_texture(vulkan_t & vulkan, uint32_t width, uint32_t height, uint32_t bytes_per_pixel, const unsigned char * pixels, vk_asset_t & asset) {
+	asset.image_info = vk_image_info(
+		{
+			.width = width,
+			.height = height,
+			.depth = 1,
+		},
+		VK_IMAGE_TYPE_2D, VK_FORMAT_B8G8R8A8_SRGB,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+	);
+	asset.image = vk_create_image(vulkan, asset.image_info, MEMORY_USAGE_DEVICE, MEMORY_CATEGORY_TEXTURE, asset.memory);
+	if (asset.image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+		.imageOffset = { 0, 0, 0, },
+		.imageExtent = { width, height, 1 },
+	};
+
+	vk_transition_image(vulkan, asset.image, VK_FORMAT_B8G8R8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	vk_staging_upload_image(vulkan, asset.image, pixels, { region }, 1, 1, bytes_per_pixel);
+	vk_transition_image(vulkan, asset.image, VK_FORMAT_B8G8R8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	asset.view_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = asset.image,
+		.viewType = VK_IMAGE_VIEW_TYPE_2D,
+		.format = VK_FORMAT_B8G8R8A8_SRGB,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = 1,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+	};
+
+	VK_CALL(vkCreateImageView(vulkan.device, &asset.view_info, vulkan.allocator, &asset.view));
+
+	VkSamplerCreateInfo s_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.mipLodBias = 0.0f,
+		.anisotropyEnable = VK_FALSE,
+		.maxAnisotropy = 1.0f,
+		.compareEnable = VK_FALSE,
+		.compareOp = VK_COMPARE_OP_ALWAYS,
+		.minLod = 0.0f,
+		.maxLod = 0.0f,
+		.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+		.unnormalizedCoordinates = VK_FALSE,
+	};
+
+	VK_CALL(vkCreateSampler(vulkan.device, &s_create_info, vulkan.allocator, &asset.sampler));
+}
+
+// what frames draw with until the loader publishes the real assets: no mesh, and a 1x1 white texture so
+// the vertex colors come through. A texture created at init needs none.
+void vk_create_placeholders(vulkan_t & vulkan) {
+	vulkan.mesh_buffer = VK_NULL_HANDLE;
+	vulkan.mesh_memory = {};
+	vulkan.mesh_vertex_count = 0;
+	vulkan.mesh_index_count = 0;
+
+	if (vulkan.texture != VK_NULL_HANDLE) {
+		return;
+	}
+
+	const unsigned char white[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	vk_asset_t placeholder = {};
+	vk_upload_texture(vulkan, 1, 1, 4, white, placeholder);
+	if (placeholder.image == VK_NULL_HANDLE) {
+		std::cout << "Failed to allocate the placeholder texture\n";
+		throw std::runtime_error("Failed to allocate the placeholder texture");
+	}
+	vk_staging_submit(vulkan);
+
+	vulkan.texture = placeholder.image;
+	vulkan.texture_memory = placeholder.memory;
+	vulkan.texture_view = placeholder.view;
+	vulkan.texture_sampler = placeholder.sampler;
+}
+
+// false when the file isn't there, so the caller can fall back to another format. A container with mips is
+// streamed in under texture_stream_budget, unless another one is still streaming, and anything else goes up whole.
+bool vk_create_texture_container(vulkan_t & vulkan, const char * path) {
+	mapped_file_t file;
+	if (!map_file(path, file)) {
+		return false;
+	}
+
+	ktex_t ktex {};
+	int ret = ktex_load(&ktex, file.data, file.size);
+	if (ret != 0) {
+		unmap_file(file);
+		std::cout << "Failed to load " << path << " " << ret << "\n";
+		throw std::runtime_error(std::string("Failed to load ") + path);
+	}
+
+	if (ktex.levels > 1 && vulkan.texture_stream.file.data == nullptr) {
+		vulkan.texture_stream.file = file;
+		vulkan.texture_stream.ktex = ktex;
+		vk_stream_begin(vulkan, vulkan.texture_stream_budget);
+		return true;
+	}
+
+	vk_asset_t texture = {};
+	texture.kind = ASSET_KIND_TEXTURE;
+	vk_create_texture_ktex(vulkan, ktex, texture);
+	vk_staging_submit(vulkan);
+
+	ktex_destroy(&ktex);
+	unmap_file(file);
+
+	if (texture.image == VK_NULL_HANDLE) {
+		std::cout << "Not enough memory for " << path << "\n";
+		throw std::runtime_error(std::string("Not enough memory for ") + path);
+	}
+	vk_set_texture(vulkan, texture);
+	return true;
+}
+
+// the shaders sample a sampler2D, so only the first page of an atlas could ever be read
+void vk_create_texture_atlas(vulkan_t & vulkan, const katlas_t & atlas, vk_asset_t & asset) {
+	if (atlas.texture.layers != 1) {
+		std::cout << "Atlas has " << atlas.texture.layers << " pages, only one can be sampled\n";
+		throw std::runtime_error("Atlas has more than one page");
+	}
+
+	vk_create_texture_ktex(vulkan, atlas.texture, asset);
+}
+
+// records the upload into the open staging batch like vk_upload_texture, asset.image is null when the memory
+// didn't fit
+void vk_create_texture_ktex(vulkan_t & vulkan, const ktex_t & ktex, vk_asset_t & asset) {
+	uint32_t image_count = ktex.levels * ktex.layers;
+	std::vector<VkBufferImageCopy> regions(image_count);
+	for (uint32_t i = 0; i < image_count; ++i) {
+		const ktex_image_t & image = ktex.images[i];
+		regions[i] = {
+			.bufferOffset = image.offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = image.level,
+				.baseArrayLayer = image.layer,
+				.layerCount = 1,
+			},
+			.imageOffset = { 0, 0, 0, },
+			.imageExtent = { image.width, image.height, image.depth },
+		};
+	}
+
+	VkFormat format = static_cast<VkFormat>(ktex.vk_format);
+	VkExtent3D extent = { ktex.width, ktex.height, ktex.depth };
+	uint32_t levels = ktex.levels;
+	uint32_t layers = ktex.layers;
+	bool cube = ktex.faces == 6;
+
+	asset.image_info = vk_image_info(
+		extent,
+		extent.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D, format,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		levels, layers, cube ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0
+	);
+	asset.image = vk_create_image(vulkan, asset.image_info, MEMORY_USAGE_DEVICE, MEMORY_CATEGORY_TEXTURE, asset.memory);
+	if (asset.image == VK_NULL_HANDLE) {
+		return;
+	}
+
+	vk_transition_image(vulkan, asset.image, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, levels, layers);
+	vk_staging_upload_image(vulkan, asset.image, ktex.data, regions, ktex.block_width, ktex.block_height, ktex.block_bytes);
+	vk_transition_image(vulkan, asset.image, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, levels, layers);
+
+	VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D;
+	if (extent.depth > 1) {
+		view_type = VK_IMAGE_VIEW_TYPE_3D;
+	} else if (cube) {
+		view_type = layers > 6 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+	} else if (layers > 1) {
+		view_type = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	}
+
+	asset.view_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = asset.image,
+		.viewType = view_type,
+		.format = format,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = levels,
+			.baseArrayLayer = 0,
+			.layerCount = layers,
+		},
+	};
+
+	VK_CALL(vkCreateImageView(vulkan.device, &asset.view_info, vulkan.allocator, &asset.view));
+
+	VkSamplerCreateInfo s_create_info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.mipLodBias = 0.0f,
+		.anisotropyEnable = VK_FALSE,
+		.maxAnisotropy = 1.0f,
+		.compareEnable = VK_FALSE,
+		.compareOp = VK_COMPARE_OP_ALWAYS,
+		.minLod = 0.0f,
+		.maxLod = static_cast<float>(levels),
+		.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+		.unnormalizedCoordinates = VK_FALSE,
+	};
+
+	VK_CALL(vkCreateSampler(vulkan.device, &s_create_info, vulkan.allocator, &asset.sampler));
+}
+
+static VkSampler vk_stream_sampler(vulkan_t & vulkan, float min_lod, float max_lod) {
+	VkSamplerCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.magFilter = VK_FILTER_NEAREST,
+		.minFilter = VK_FILTER_NEAREST,
+		.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+		.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+		.mipLodBias = 0.0f,
+		.anisotropyEnable = VK_FALSE,
+		.maxAnisotropy = 1.0f,
+		.compareEnable = VK_FALSE,
+		.compareOp = VK_COMPARE_OP_ALWAYS,
+		.minLod = min_lod,
+		.maxLod = max_lod,
+		.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK,
+		.unnormalizedCoordinates = VK_FALSE,
+	};
+
+	VkSampler sampler;
+	VK_CALL(vkCreateSampler(vulkan.device, &create_info, vulkan.allocator, &sampler));
+
+	return sampler;
+}
+
+// uploads mip levels [first, last) of every layer, the levels must be in TRANSFER_DST_OPTIMAL
+static void vk_stream_upload_levels(vulkan_t & vulkan, vk_texture_stream_t & stream, uint32_t first, uint32_t last) {
+	std::vector<VkBufferImageCopy> regions;
+	for (uint32_t i = first * stream.ktex.layers; i < last * stream.ktex.layers; ++i) {
+		ktex_image_t & image = stream.ktex.images[i];
+		regions.push_back({
+			.bufferOffset = image.offset,
+			.bufferRowLength = 0,
+			.bufferImageHeight = 0,
+			.imageSubresource = {
+				.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+				.mipLevel = image.level,
+				.baseArrayLayer = image.layer,
+				.layerCount = 1,
+			},
+			.imageOffset = { 0, 0, 0, },
+			.imageExtent = { image.width, image.height, image.depth },
+		});
+	}
+
+	vk_staging_upload_image(vulkan, vulkan.texture, stream.ktex.data, regions, stream.ktex.block_width, stream.ktex.block_height, stream.ktex.block_bytes);
+}
+
+// false when the file isn't there, so the caller can fall back to another format
+bool vk_create_texture_streamed(vulkan_t & vulkan, const char * path, VkDeviceSize frame_budget) {
+	vk_texture_stream_t & stream = vulkan.texture_stream;
+	if (!map_file(path, stream.file)) {
+		return false;
+	}
+
+	int ret = ktex_load(&stream.ktex, stream.file.data, stream.file.size);
+	if (ret != 0) {
+		unmap_file(stream.file);
+		std::cout << "Failed to load " << path << " " << ret << "\n";
+		throw std::runtime_error(std::string("Failed to load ") + path);
+	}
+
+	vk_stream_begin(vulkan, frame_budget);
+	return true;
+}
+
+// texture_stream holds the mapped file and its ktex. Whatever texture is bound is retired, and the levels past
+// the first frame's budget come in through vk_stream_textures.
+static void vk_stream_begin(vulkan_t & vulkan, VkDeviceSize frame_budget) {
+	vk_texture_stream_t & stream = vulkan.texture_stream;
+	ktex_t & ktex = stream.ktex;
+	stream.format = static_cast<VkFormat>(ktex.vk_format);
+	stream.frame_budget = frame_budget;
+
+	// the mip tail is whatever fits in one frame's budget, but at least the smallest level
+	stream.resident_level = ktex.levels - 1;
+	VkDeviceSize tail_size = ktex.images[stream.resident_level * ktex.layers].size * ktex.layers;
+	while (stream.resident_level > 0) {
+		VkDeviceSize level_size = ktex.images[(stream.resident_level - 1) * ktex.layers].size * ktex.layers;
+		if (tail_size + level_size > frame_budget) {
+			break;
+		}
+
+		tail_size += level_size;
+		--stream.resident_level;
+	}
+
+	VkImageCreateInfo image_info = vk_image_info(
+		{ ktex.width, ktex.height, ktex.depth },
+		ktex.depth > 1 ? VK_IMAGE_TYPE_3D : VK_IMAGE_TYPE_2D, stream.format,
+		VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+		ktex.levels, ktex.layers, ktex.faces == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0
+	);
+	vk_retire_texture(vulkan);
+	vulkan.texture = vk_create_image(vulkan, image_info, MEMORY_USAGE_DEVICE, MEMORY_CATEGORY_TEXTURE, vulkan.texture_memory);
+
+	// non-resident levels are moved to SHADER_READ_ONLY too, the sampler's minLod keeps them from being read
+	vk_transition_image(vulkan, vulkan.texture, stream.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, ktex.levels, ktex.layers);
+	vk_stream_upload_levels(vulkan, stream, stream.resident_level, ktex.levels);
+	vk_transition_image(vulkan, vulkan.texture, stream.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, ktex.levels, ktex.layers);
+	vk_staging_submit(vulkan);
+
+	VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D;
+	if (ktex.depth > 1) {
+		view_type = VK_IMAGE_VIEW_TYPE_3D;
+	} else if (ktex.faces == 6) {
+		view_type = ktex.layers > 6 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+	} else if (ktex.layers > 1) {
+		view_type = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	}
+
+	VkImageViewCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = 0,
+		.image = vulkan.texture,
+		.viewType = view_type,
+		.format = stream.format,
+		.components = {
+			.r = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.g = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.b = VK_COMPONENT_SWIZZLE_IDENTITY,
+			.a = VK_COMPONENT_SWIZZLE_IDENTITY,
+		},
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = 0,
+			.levelCount = ktex.levels,
+			.baseArrayLayer = 0,
+			.layerCount = ktex.layers,
+		},
+	};
+
+	VK_CALL(vkCreateImageView(vulkan.device, &create_info, vulkan.allocator, &vulkan.texture_view));
+	vk_defrag_register_image(vulkan, &vulkan.texture, &vulkan.texture_memory, image_info, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, [create_info](vulkan_t & vulkan) {
+		vk_texture_moved(vulkan, create_info);
+	});
+
+	vulkan.texture_sampler = vk_stream_sampler(vulkan, static_cast<float>(stream.resident_level), static_cast<float>(ktex.levels));
+
+	stream.stale_frames = (1u << vulkan.frames_in_flight) - 1;
+
+	if (stream.resident_level == 0) {
+		ktex_destroy(&stream.ktex);
+		unmap_file(stream.file);
+	}
+}
+
+void vk_stream_textures(vulkan_t & vulkan) {
+	vk_texture_stream_t & stream = vulkan.texture_stream;
+
+	if (stream.file.data != nullptr) {
+		ktex_t & ktex = stream.ktex;
+
+		// always make progress by at least one level, even if it alone is over budget
+		VkDeviceSize budget = stream.frame_budget;
+		uint32_t level = stream.resident_level;
+		while (level > 0) {
+			VkDeviceSize level_size = ktex.images[(level - 1) * ktex.layers].size * ktex.layers;
+			if (level_size > budget && level != stream.resident_level) {
+				break;
+			}
+
+			budget -= std::min(level_size, budget);
+			--level;
+		}
+
+		// the levels were never read, the sampler's minLod kept them out, so their contents can be dropped and the
+		// transfer queue doesn't need them handed back by the graphics family first
+		uint32_t count = stream.resident_level - level;
+		vk_transition_image(vulkan, vulkan.texture, stream.format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, level, count, ktex.layers);
+		vk_stream_upload_levels(vulkan, stream, level, stream.resident_level);
+		vk_transition_image(vulkan, vulkan.texture, stream.format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, level, count, ktex.layers);
+		vk_staging_submit(vulkan);
+
+		stream.resident_level = level;
+
+		// samplers are immutable, so raising the clamp means a new sampler that every frame's set has to pick up,
+		// the old one is only used by frames already submitted
+		stream.retired_samplers.push_back({ vulkan.texture_sampler, vulkan.graphics_timeline.submitted });
+		vulkan.texture_sampler = vk_stream_sampler(vulkan, static_cast<float>(level), static_cast<float>(ktex.levels));
+		stream.stale_frames = (1u << vulkan.frames_in_flight) - 1;
+
+		if (level == 0) {
+			ktex_destroy(&stream.ktex);
+			unmap_file(stream.file);
+		}
+	}
+
+	// sets still naming a retired sampler are rewritten before they are bound again, so it only has to outlive
+	// the submits that used it
+	for (size_t i = 0; i < stream.retired_samplers.size();) {
+		if (vk_timeline_done(vulkan, vulkan.graphics_timeline, stream.retired_samplers[i].second)) {
+			vkDestroySampler(vulkan.device, stream.retired_samplers[i].first, vulkan.allocator);
+			stream.retired_samplers.erase(stream.retired_samplers.begin() + i);
+		} else {
+			++i;
+		}
+	}
+
+	// the current frame's last submit has been waited on, so its set is no longer in use and can be rewritten
+	uint32_t frame_bit = 1u << vulkan.current_frame;
+	if ((stream.stale_frames & frame_bit) == 0) {
+		return;
+	}
+
+	VkDescriptorImageInfo image_info = {
+		.sampler = vulkan.texture_sampler,
+		.imageView = vulkan.texture_view,
+		.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+	};
+
+	VkWriteDescriptorSet write = {
+		.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+		.pNext = nullptr,
+		.dstSet = vulkan.desc_sets[vulkan.current_frame],
+		.dstBinding = 1,
+		.dstArrayElement = 0,
+		.descriptorCount = 1,
+		.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+		.pImageInfo = &image_info,
+		.pBufferInfo = nullptr,
+		.pTexelBufferView = nullptr,
+	};
+
+	vkUpdateDescriptorSets(vulkan.device, 1, &write, 0, nullptr);
+	stream.stale_frames &= ~frame_bit;
+}
+
+// runs on a loader thread, so it must not touch vulkan_t. error is -1 when the file couldn't be opened
+static void vk_loader_decode(vk_asset_t & asset) {
+	std::ifstream file(asset.path, std::ios::ate | std::ios::binary);
+	if (!file.is_open()) {
+		asset.error = -1;
+		return;
+	}
+
+	size_t size = file.tellg();
+	std::vector<unsigned char> bytes(size);
+	file.seekg(0);
+	file.read(reinterpret_cast<char *>(bytes.data()), size);
+	file.close();
+
+	if (asset.kind == ASSET_KIND_MESH) {
+		asset.error = vk_decode_mesh(bytes, asset);
+	} else {
+		asset.error = ktga_load(&asset.tga, (void *) bytes.data(), bytes.size());
+	}
+}
+
+static void vk_loader_run(vk_loader_t * loader) {
+	while (true) {
+		vk_asset_t asset;
+		{
+			std::unique_lock<std::mutex> lock(loader->mutex);
+			loader->wake.wait(lock, [loader] { return loader->stop || !loader->queued.empty(); });
+			if (loader->stop) {
+				return;
+			}
+
+			asset = std::move(loader->queued.front());
+			loader->queued.pop_front();
+		}
+
+		vk_loader_decode(asset);
+
+		std::lock_guard<std::mutex> lock(loader->mutex);
+		loader->decoded.push_back(std::move(asset));
+	}
+}
+
+void vk_loader_start(vulkan_t & vulkan) {
+	vk_loader_t & loader = vulkan.loader;
+	loader.stop = false;
+	loader.pending = 0;
+
+	uint32_t count = std::max(vulkan.loader_thread_count, 1u);
+	for (uint32_t i = 0; i < count; ++i) {
+		loader.threads.emplace_back(vk_loader_run, &loader);
+	}
+}
+
+// the device has to be idle, whatever is still uploading is destroyed instead of published
+void vk_loader_stop(vulkan_t & vulkan) {
+	vk_loader_t & loader = vulkan.loader;
+	{
+		std::lock_guard<std::mutex> lock(loader.mutex);
+		loader.stop = true;
+	}
+	loader.wake.notify_all();
+
+	for (std::thread & thread : loader.threads) {
+		thread.join();
+	}
+	loader.threads.clear();
+
+	for (vk_asset_t & asset : loader.decoded) {
+		if (asset.tga.bitmap != nullptr) {
+			ktga_destroy(&asset.tga);
+		}
+	}
+
+	for (vk_asset_t & asset : loader.uploading) {
+		vkDestroySampler(vulkan.device, asset.sampler, vulkan.allocator);
+		vkDestroyImageView(vulkan.device, asset.view, vulkan.allocator);
+		vkDestroyImage(vulkan.device, asset.image, vulkan.allocator);
+		vkDestroyBuffer(vulkan.device, asset.buffer, vulkan.allocator);
+		vk_free_memory(vulkan, asset.memory);
+	}
+
+	loader.queued.clear();
+	loader.decoded.clear();
+	loader.uploading.clear();
+}
+
+void vk_loader_queue(vulkan_t & vulkan, vk_asset_kind_t kind, const char * path) {
+	vk_loader_t & loader = vulkan.loader;
+	vk_asset_t asset = {};
+	asset.kind = kind;
+	asset.path = path;
+
+	{
+		std::lock_guard<std::mutex> lock(loader.mutex);
+		loader.queued.push_back(std::move(asset));
+	}
+	loader.wake.notify_one();
+	++loader.pending;
+}
+
+// swaps the asset in for what frames currently draw with, which frames in flight may still be using so it is
+// retired on the graphics timeline. Descriptor sets are rewritten at their frame's turn in vk_stream_textures.
+static void vk_loader_publish(vulkan_t & vulkan, vk_asset_t & asset) {
+	uint64_t value = vulkan.graphics_timeline.submitted;
+
+	if (asset.kind == ASSET_KIND_MESH) {
+		vk_defrag_unregister(vulkan, &vulkan.mesh_memory);
+		if (vulkan.mesh_buffer != VK_NULL_HANDLE) {
+			vulkan.defrag.retired.push_back({
+				.buffer = vulkan.mesh_buffer,
+				.image = VK_NULL_HANDLE,
+				.view = VK_NULL_HANDLE,
+				.memory = vulkan.mesh_memory,
+				.value = value,
+			});
+		}
+
+		vulkan.mesh_buffer = asset.buffer;
+		vulkan.mesh_memory = asset.memory;
+		vulkan.mesh_vertex_count = asset.vertex_count;
+		vulkan.mesh_index_count = asset.index_count;
+		vk_defrag_register_buffer(vulkan, &vulkan.mesh_buffer, &vulkan.mesh_memory, asset.size, mesh_usage);
+		return;
+	}
+
+	vk_set_texture(vulkan, asset);
+}
+
+void vk_loader_update(vulkan_t & vulkan) {
+	vk_loader_t & loader = vulkan.loader;
+
+	// publishing only once the copies are done keeps frames from queueing up behind a big upload
+	for (size_t i = 0; i < loader.uploading.size();) {
+		if (vk_staging_done(vulkan, loader.uploading[i].serial)) {
+			vk_loader_publish(vulkan, loader.uploading[i]);
+			loader.uploading.erase(loader.uploading.begin() + i);
+			--loader.pending;
+		} else {
+			++i;
+		}
+	}
+
+	std::vector<vk_asset_t> decoded;
+	{
+		std::lock_guard<std::mutex> lock(loader.mutex);
+		size_t count = std::min<size_t>(loader.decoded.size(), vulkan.loader_uploads);
+		for (size_t i = 0; i < count; ++i) {
+			decoded.push_back(std::move(loader.decoded[i]));
+		}
+		loader.decoded.erase(loader.decoded.begin(), loader.decoded.begin() + count);
+	}
+
+	// a failed asset leaves the placeholder in place rather than taking the renderer down
+	for (vk_asset_t & asset : decoded) {
+		if (asset.error == -1) {
+			std::cout << "Failed to open " << asset.path << "\n";
+			--loader.pending;
+			continue;
+		}
+		if (asset.error != 0) {
+			std::cout << "Failed to load " << asset.path << " " << asset.error << "\n";
+			--loader.pending;
+			continue;
+		}
+
+		if (asset.kind == ASSET_KIND_MESH) {
+			vk_upload_mesh(vulkan, asset);
+		} else {
+			vk_upload_texture(vulkan, asset.tga.header.img_w, asset.tga.header.img_h, asset.tga.header.bpp / 8, asset.tga.bitmap, asset);
+			ktga_destroy(&asset.tga);
+		}
+
+		if (asset.buffer == VK_NULL_HANDLE && asset.image == VK_NULL_HANDLE) {
+			std::cout << "Not enough memory for " << asset.path << "\n";
+			--loader.pending;
+			continue;
+		}
+
+		asset.serial = vk_staging_submit(vulkan);
+		loader.uploading.push_back(std::move(asset));
+	}
+}
+
+// every queued asset is either drawn with or was dropped, and the streamed texture has all of its levels
+bool vk_loader_idle(vulkan_t & vulkan) {
+	return vulkan.loader.pending == 0 && vulkan.texture_stream.file.data == nullptr;
+}
+
+// the textures share one page and a single set, which one an object shows is baked into its mesh's uvs.
+// Overflowing the page is an error rather than a second page the shaders couldn't sample.
+static void vk_bench_atlas(vulkan_t & vulkan, vk_bench_t & bench, const std::vector<unsigned char> & pixels, katlas_t & atlas) {
+	const vk_bench_config_t & config = bench.config;
+
+	ktga_t image = {};
+	image.header.img_w = static_cast<unsigned short>(config.texture_size);
+	image.header.img_h = static_cast<unsigned short>(config.texture_size);
+	image.header.bpp = 32;
+	image.bitmap = const_cast<unsigned char *>(pixels.data());
+	std::vector<ktga_t> images(config.textures, image);
+
+	int ret = katlas_build(&atlas, images.data(), config.textures, config.atlas_size, config.atlas_size, 1, 1);
+	if (ret == 5) {
+		std::cout << config.textures << " bench textures of " << config.texture_size << " overflow one " << config.atlas_size << " atlas page\n";
+		throw std::runtime_error("Bench textures overflow the atlas page");
+	}
+	if (ret != 0) {
+		std::cout << "Failed to build the bench atlas " << ret << "\n";
+		throw std::runtime_error("Failed to build the bench atlas");
+	}
+
+	bench.textures.resize(1);
+	bench.textures[0].kind = ASSET_KIND_TEXTURE;
+	vk_create_texture_atlas(vulkan, atlas, bench.textures[0]);
+	if (bench.textures[0].image == VK_NULL_HANDLE) {
+		katlas_destroy(&atlas);
+		std::cout << "Not enough memory for the bench atlas\n";
+		throw std::runtime_error("Not enough memory for the bench atlas");
+	}
+}
+
+// the objects sit on a grid in front of the camera, small enough that they don't cover each other
+static void vk_bench_setup(vulkan_t & vulkan, vk_bench_t & bench) {
+	const vk_bench_config_t & config = bench.config;
+
+	vk_asset_t source = {};
+	source.kind = ASSET_KIND_MESH;
+	source.path = "test.obj";
+	vk_loader_decode(source);
+	if (source.error != 0) {
+		std::cout << "Failed to load " << source.path << " for the bench " << source.error << "\n";
+		throw std::runtime_error("Failed to load the bench mesh");
+	}
+
+	std::vector<unsigned char> pixels(static_cast<size_t>(config.texture_size) * config.texture_size * 4);
+	for (uint32_t y = 0; y < config.texture_size; ++y) {
+		for (uint32_t x = 0; x < config.texture_size; ++x) {
+			unsigned char value = ((x / 8 + y / 8) & 1) ? 0xFF : 0x40;
+			unsigned char * pixel = &pixels[(static_cast<size_t>(y) * config.texture_size + x) * 4];
+			pixel[0] = pixel[1] = pixel[2] = value;
+			pixel[3] = 0xFF;
+		}
+	}
+
+	katlas_t atlas = {};
+	bool atlased = config.atlas_size != 0 && config.textures != 0;
+	if (atlased) {
+		vk_bench_atlas(vulkan, bench, pixels, atlas);
+	} else {
+		bench.textures.resize(config.textures);
+		for (vk_asset_t & texture : bench.textures) {
+			texture.kind = ASSET_KIND_TEXTURE;
+			vk_upload_texture(vulkan, config.texture_size, config.texture_size, 4, pixels.data(), texture);
+			if (texture.image == VK_NULL_HANDLE) {
+				std::cout << "Not enough memory for " << bench.textures.size() << " bench textures\n";
+				throw std::runtime_error("Not enough memory for the bench textures");
+			}
+		}
+	}
+
+	// separate uploads of the same data, so switching between them binds like distinct meshes would. With an
+	// atlas the objects cycle through the meshes for their texture, so there is at least one mesh per texture.
+	bench.meshes.resize(std::max(config.meshes, atlased ? config.textures : 1u));
+	for (size_t i = 0; i < bench.meshes.size(); ++i) {
+		vk_asset_t & mesh = bench.meshes[i];
+		mesh.kind = ASSET_KIND_MESH;
+		mesh.vertices = source.vertices;
+		mesh.indices = source.indices;
+		if (atlased) {
+			for (vertex_t & vertex : mesh.vertices) {
+				katlas_remap_uv(&atlas.entries[i % config.textures], &vertex.uv.u, &vertex.uv.v);
+			}
+		}
+
+		vk_upload_mesh(vulkan, mesh);
+		if (mesh.buffer == VK_NULL_HANDLE) {
+			katlas_destroy(&atlas);
+			std::cout << "Not enough memory for " << bench.meshes.size() << " bench meshes\n";
+			throw std::runtime_error("Not enough memory for the bench meshes");
+		}
+	}
+	katlas_destroy(&atlas);
+
+	// the uniform ring and the textures stay put for the whole run, so a set per texture is written once
+	if (!bench.textures.empty()) {
+		uint32_t set_count = static_cast<uint32_t>(bench.textures.size());
+		VkDescriptorPoolSize pool_sizes[2] = {
+			{
+				.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+				.descriptorCount = set_count,
+			},
+			{
+				.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+				.descriptorCount = set_count,
+			},
+		};
+
+		VkDescriptorPoolCreateInfo pool_info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+			.pNext = nullptr,
+			.flags = 0,
+			.maxSets = set_count,
+			.poolSizeCount = 2,
+			.pPoolSizes = pool_sizes,
+		};
+		VK_CALL(vkCreateDescriptorPool(vulkan.device, &pool_info, vulkan.allocator, &bench.desc_pool));
+
+		std::vector<VkDescriptorSetLayout> layouts(set_count, vulkan.desc_layout);
+		VkDescriptorSetAllocateInfo alloc_info = {
+			.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+			.pNext = nullptr,
+			.descriptorPool = bench.desc_pool,
+			.descriptorSetCount = set_count,
+			.pSetLayouts = layouts.data(),
+		};
+		bench.desc_sets.resize(set_count);
+		VK_CALL(vkAllocateDescriptorSets(vulkan.device, &alloc_info, bench.desc_sets.data()));
+
+		for (uint32_t i = 0; i < set_count; ++i) {
+			VkDescriptorBufferInfo buffer_info = {
+				.buffer = vulkan.unif_ring.buffer,
+				.offset = 0,
+				.range = sizeof(uniform_t),
+			};
+
+			VkDescriptorImageInfo image_info = {
+				.sampler = bench.textures[i].sampler,
+				.imageView = bench.textures[i].view,
+				.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			};
+
+			VkWriteDescriptorSet writes[2] = {
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.pNext = nullptr,
+					.dstSet = bench.desc_sets[i],
+					.dstBinding = 0,
+					.dstArrayElement = 0,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+					.pImageInfo = nullptr,
+					.pBufferInfo = &buffer_info,
+					.pTexelBufferView = nullptr,
+				},
+				{
+					.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+					.pNext = nullptr,
+					.dstSet = bench.desc_sets[i],
+					.dstBinding = 1,
+					.dstArrayElement = 0,
+					.descriptorCount = 1,
+					.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+					.pImageInfo = &image_info,
+					.pBufferInfo = nullptr,
+					.pTexelBufferView = nullptr,
+				},
+			};
+
+			vkUpdateDescriptorSets(vulkan.device, 2, writes, 0, nullptr);
+		}
+	}
+
+	// everything is resident before the first frame, which also acquires whatever went over the transfer queue
+	vk_staging_wait(vulkan, vk_staging_submit(vulkan));
+
+	uint32_t count = std::max(config.objects, 1u);
+	if (ktransform_soa_create(&bench.transforms, count) != 0) {
+		std::cout << "Failed to create " << count << " bench transforms\n";
+		throw std::runtime_error("Failed to create the bench transforms");
+	}
+	bench.models = new mat4x4[count];
+
+	uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<double>(count))));
+	float spacing = 2.0f / static_cast<float>(side);
+	for (uint32_t i = 0; i < count; ++i) {
+		float position[3] = {
+			(static_cast<float>(i % side) + 0.5f) * spacing - 1.0f,
+			(static_cast<float>(i / side % side) + 0.5f) * spacing - 1.0f,
+			-1.5f - static_cast<float>(i / (side * side)) * spacing,
+		};
+		float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		float scale[3] = { 0.1f * spacing, 0.1f * spacing, 0.1f * spacing };
+		ktransform_soa_set(&bench.transforms, i, position, rotation, scale);
+	}
+	vk_create_object_uniforms(vulkan, bench.uniforms, count);
+}
+
+// the first config.moving objects spin about y at their own phase, the rest stand still and after their
+// first few frames cost neither a rebuild nor an upload. Every object has a uniform slot of its own.
+void vk_bench_scene(vulkan_t & vulkan, vk_bench_t & bench, float time) {
+	ktransform_soa_t & soa = bench.transforms;
+	uint32_t moving = std::min(bench.config.moving, soa.count);
+	for (uint32_t i = 0; i < moving; ++i) {
+		float half = (time + static_cast<float>(i) * 0.1f) * 0.5f;
+		soa.rotation[1][i] = sinf(half);
+		soa.rotation[3][i] = cosf(half);
+		ktransform_soa_touch(&soa, i);
+	}
+
+	mat4x4 view;
+	mat4x4_identity(view);
+	view[1][1] *= -1;
+	mat4x4 proj;
+	float aspect = static_cast<float>(vulkan.swapchain_extent.width) / static_cast<float>(vulkan.swapchain_extent.height);
+	mat4x4_perspective(proj, 1, aspect, 0.05f, 100.0f);
+	vk_update_object_uniforms(vulkan, bench.uniforms, soa, bench.models, view, proj, std::thread::hardware_concurrency());
+
+	for (uint32_t i = 0; i < soa.count; ++i) {
+		const vk_asset_t & mesh = bench.meshes[i % bench.meshes.size()];
+		vulkan.draws.push_back({
+			.mesh_buffer = mesh.buffer,
+			.index_offset = sizeof(vertex_t) * mesh.vertex_count,
+			.index_count = mesh.index_count,
+			.first_index = 0,
+			.vertex_offset = 0,
+			.unif_offset = vk_object_uniform_offset(vulkan, bench.uniforms, i),
+			.desc_set = bench.desc_sets.empty() ? VK_NULL_HANDLE : bench.desc_sets[i % bench.desc_sets.size()],
+		});
+	}
+}
+
+static void vk_bench_destroy(vulkan_t & vulkan, vk_bench_t & bench) {
+	vkDeviceWaitIdle(vulkan.device);
+
+	for (vk_asset_t & mesh : bench.meshes) {
+		vkDestroyBuffer(vulkan.device, mesh.buffer, vulkan.allocator);
+		vk_free_memory(vulkan, mesh.memory);
+	}
+	bench.meshes.clear();
+
+	for (vk_asset_t & texture : bench.textures) {
+		vkDestroySampler(vulkan.device, texture.sampler, vulkan.allocator);
+		vkDestroyImageView(vulkan.device, texture.view, vulkan.allocator);
+		vkDestroyImage(vulkan.device, texture.image, vulkan.allocator);
+		vk_free_memory(vulkan, texture.memory);
+	}
+	bench.textures.clear();
+
+	// the sets go with their pool
+	if (bench.desc_pool != VK_NULL_HANDLE) {
+		vkDestroyDescriptorPool(vulkan.device, bench.desc_pool, vulkan.allocator);
+		bench.desc_pool = VK_NULL_HANDLE;
+	}
+	bench.desc_sets.clear();
+
+	ktransform_soa_destroy(&bench.transforms);
+	delete[] bench.models;
+	bench.models = nullptr;
+}
+
+// one row per metric in csv, each carrying the scene so results from several runs can simply be concatenated
+static std::string vk_bench_report(vulkan_t & vulkan, vk_bench_t & bench) {
+	const vk_bench_config_t & config = bench.config;
+	const char * names[3] = { "cpu_ms", "submit_ms", "gpu_ms" };
+	std::vector<double> * samples[3] = { &bench.cpu_times, &bench.submit_times, &bench.gpu_times };
+
+	kstats_summary_t summaries[3];
+	for (uint32_t i = 0; i < 3; ++i) {
+		kstats_summarize(samples[i]->data(), samples[i]->size(), &summaries[i]);
+	}
+
+	std::ostringstream report;
+	if (config.json) {
+		report << "{\"device\":\"" << vulkan.caps.props.deviceName << "\""
+			<< ",\"objects\":" << config.objects
+			<< ",\"meshes\":" << config.meshes
+			<< ",\"textures\":" << config.textures
+			<< ",\"texture_size\":" << config.texture_size
+			<< ",\"atlas_size\":" << config.atlas_size
+			<< ",\"moving\":" << std::min(config.moving, config.objects)
+			<< ",\"frames_in_flight\":" << vulkan.frames_in_flight
+			<< ",\"warmup_frames\":" << config.warmup_frames
+			<< ",\"frames\":" << config.frames;
+		for (uint32_t i = 0; i < 3; ++i) {
+			const kstats_summary_t & summary = summaries[i];
+			report << ",\"" << names[i] << "\":{\"count\":" << summary.count
+				<< ",\"min\":" << summary.min * 1000.0
+				<< ",\"median\":" << summary.median * 1000.0
+				<< ",\"p95\":" << summary.p95 * 1000.0
+				<< ",\"p99\":" << summary.p99 * 1000.0
+				<< ",\"mean\":" << summary.mean * 1000.0
+				<< ",\"max\":" << summary.max * 1000.0 << "}";
+		}
+		report << "}\n";
+		return report.str();
+	}
+
+	report << "device,objects,meshes,textures,texture_size,atlas_size,moving,frames_in_flight,metric,count,min,median,p95,p99,mean,max\n";
+	for (uint32_t i = 0; i < 3; ++i) {
+		const kstats_summary_t & summary = summaries[i];
+		report << "\"" << vulkan.caps.props.deviceName << "\"," << config.objects << "," << config.meshes << "," << config.textures << "," << config.texture_size << "," << config.atlas_size << "," << std::min(config.moving, config.objects) << "," << vulkan.frames_in_flight << ","
+			<< names[i] << "," << summary.count << "," << summary.min * 1000.0 << "," << summary.median * 1000.0 << "," << summary.p95 * 1000.0 << "," << summary.p99 * 1000.0 << "," << summary.mean * 1000.0 << "," << summary.max * 1000.0 << "\n";
+	}
+	return report.str();
+}
+
+void vk_bench_run(vulkan_t & vulkan, vk_bench_t & bench) {
+	const vk_bench_config_t & config = bench.config;
+
+	// the loader's uploads would land in the middle of the measured frames otherwise
+	while (!vk_loader_idle(vulkan)) {
+		vk_draw_frame(vulkan);
+	}
+
+	vk_bench_setup(vulkan, bench);
+	vulkan.bench = &bench;
+
+	for (uint32_t frame = 0; frame < config.warmup_frames; ++frame) {
+		vk_draw_frame(vulkan);
+	}
+
+	// a frame's gpu time only comes back frames_in_flight frames later, so the loop runs that many past the
+	// measured frames to collect the last of them
+	uint32_t lag = vulkan.frames_in_flight;
+	bench.cpu_times.clear();
+	bench.submit_times.clear();
+	bench.gpu_times.clear();
+	bench.cpu_times.reserve(config.frames);
+	bench.submit_times.reserve(config.frames);
+	bench.gpu_times.reserve(config.frames);
+
+	for (uint32_t frame = 0; frame < config.frames + lag; ++frame) {
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		vk_draw_frame(vulkan);
+		double cpu_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (frame < config.frames) {
+			bench.cpu_times.push_back(cpu_time);
+			bench.submit_times.push_back(vulkan.submit_time);
+		}
+		if (frame >= lag && vulkan.gpu_time >= 0.0) {
+			bench.gpu_times.push_back(vulkan.gpu_time);
+		}
+	}
+
+	vulkan.bench = nullptr;
+	vk_bench_destroy(vulkan, bench);
+
+	std::string report = vk_bench_report(vulkan, bench);
+	if (config.out_path == nullptr) {
+		std::cout << report;
+		return;
+	}
+
+	std::ofstream file(config.out_path, std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "Failed to open " << config.out_path << "\n";
+		throw std::runtime_error("Failed to open the bench output file");
+	}
+	file << report;
+}
+
+#ifdef _WIN32
+bool map_file(const char * path, mapped_file_t & mapped) {
+	mapped = {
+		.file = INVALID_HANDLE_VALUE,
+		.mapping = nullptr,
+		.data = nullptr,
+		.size = 0,
+	};
+
+	mapped.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (mapped.file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(mapped.file, &size) == 0 || size.QuadPart == 0) {
+		unmap_file(mapped);
+		return false;
+	}
+
+	mapped.mapping = CreateFileMappingA(mapped.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapped.mapping == nullptr) {
+		unmap_file(mapped);
+		return false;
+	}
+
+	mapped.data = MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0);
+	if (mapped.data == nullptr) {
+		unmap_file(mapped);
+		return false;
+	}
+
+	mapped.size = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void unmap_file(mapped_file_t & mapped) {
+	if (mapped.data != nullptr) {
+		UnmapViewOfFile(mapped.data);
+	}
+
+	if (mapped.mapping != nullptr) {
+		CloseHandle(mapped.mapping);
+	}
+
+	if (mapped.file != INVALID_HANDLE_VALUE) {
+		CloseHandle(mapped.file);
+	}
+
+	mapped.data = nullptr;
+	mapped.mapping = nullptr;
+	mapped.file = INVALID_HANDLE_VALUE;
+	mapped.size = 0;
+}
+#else
+bool map_file(const char * path, mapped_file_t & mapped) {
+	mapped = {
+		.fd = -1,
+		.data = nullptr,
+		.size = 0,
+	};
+
+	mapped.fd = open(path, O_RDONLY);
+	if (mapped.fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(mapped.fd, &st) != 0 || st.st_size == 0) {
+		unmap_file(mapped);
+		return false;
+	}
+
+	void * data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, mapped.fd, 0);
+	if (data == MAP_FAILED) {
+		unmap_file(mapped);
+		return false;
+	}
+
+	// the same front to back read FILE_FLAG_SEQUENTIAL_SCAN asks for on windows
+	posix_madvise(data, static_cast<size_t>(st.st_size), POSIX_MADV_SEQUENTIAL);
+
+	mapped.data = data;
+	mapped.size = static_cast<size_t>(st.st_size);
+	return true;
+}
+
+void unmap_file(mapped_file_t & mapped) {
+	if (mapped.data != nullptr) {
+		munmap(mapped.data, mapped.size);
+	}
+
+	if (mapped.fd >= 0) {
+		close(mapped.fd);
+	}
+
+	mapped.data = nullptr;
+	mapped.fd = -1;
+	mapped.size = 0;
+}
+#endif
+
+VkImageCreateInfo vk_image_info(VkExtent3D extent, VkImageType type, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, uint32_t mip_levels, uint32_t array_layers, VkImageCreateFlags flags) {
+	VkImageCreateInfo create_info = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+		.pNext = nullptr,
+		.flags = flags,
+		.imageType = type,
+		.format = format,
+		.extent = extent,
+		.mipLevels = mip_levels,
+		.arrayLayers = array_layers,
+		.samples = VK_SAMPLE_COUNT_1_BIT,
+		.tiling = tiling,
+		.usage = usage,
+		.sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+		.queueFamilyIndexCount = 0,
+		.pQueueFamilyIndices = nullptr,
+		.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+	};
+
+	return create_info;
+}
+
+VkImage vk_create_image(vulkan_t & vulkan, const VkImageCreateInfo & create_info, vk_memory_usage_t memory_usage, vk_memory_category_t category, vk_allocation_t & memory) {
+	VkImage image;
+	VK_CALL(vkCreateImage(vulkan.device, &create_info, vulkan.allocator, &image));
+
+	VkMemoryRequirements reqs;
+	vkGetImageMemoryRequirements(vulkan.device, image, &reqs);
+
+	memory = vk_alloc_memory(vulkan, reqs, memory_usage, category, create_info.tiling == VK_IMAGE_TILING_OPTIMAL);
+	if (memory.memory == VK_NULL_HANDLE) {
+		vkDestroyImage(vulkan.device, image, vulkan.allocator);
+		return VK_NULL_HANDLE;
+	}
+	VK_CALL(vkBindImageMemory(vulkan.device, image, memory.memory, memory.offset));
+
+	return image;
+}
+
+VkImage vk_create_image(vulkan_t & vulkan, VkExtent3D extent, VkImageType type, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, vk_memory_usage_t memory_usage, vk_memory_category_t category, vk_allocation_t & memory, uint32_t mip_levels, uint32_t array_layers, VkImageCreateFlags flags) {
+	return vk_create_image(vulkan, vk_image_info(extent, type, format, tiling, usage, mip_levels, array_layers, flags), memory_usage, category, memory);
+}
+
+void vk_transition_image(vulkan_t & vulkan, VkImage image, VkFormat format, VkImageLayout old_layout, VkImageLayout new_layout, uint32_t base_level, uint32_t level_count, uint32_t layer_count) {
+	VkImageMemoryBarrier2 barrier = {
+		.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+		.pNext = nullptr,
+		.srcStageMask = VK_PIPELINE_STAGE_2_NONE,
+		.srcAccessMask = VK_ACCESS_2_NONE,
+		.dstStageMask = VK_PIPELINE_STAGE_2_NONE,
+		.dstAccessMask = VK_ACCESS_2_NONE,
+		.oldLayout = old_layout,
+		.newLayout = new_layout,
+		.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+		.image = image,
+		.subresourceRange = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.baseMipLevel = base_level,
+			.levelCount = level_count,
+			.baseArrayLayer = 0,
+			.layerCount = layer_count,
+		},
+	};
+
+	if (new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+		
+		if (format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT) {
+			barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
+	} else {
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	}
+
+	// each side from the layout's usual use, the same table the frame graph works from
+	if (kgraph_layout_access(old_layout, &barrier.srcStageMask, &barrier.srcAccessMask) != 0 || kgraph_layout_access(new_layout, &barrier.dstStageMask, &barrier.dstAccessMask) != 0) {
+		throw std::invalid_argument("Unsupported layout transition");
+	}
+
+	if (vulkan.transfer_family != vulkan.graphics_family) {
+		if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+			// on a transfer queue this is the release half, the next frame acquires with the same layouts
+			barrier.srcQueueFamilyIndex = vulkan.transfer_family;
+			barrier.dstQueueFamilyIndex = vulkan.graphics_family;
+
+			VkImageMemoryBarrier2 acquire = barrier;
+			acquire.srcStageMask = barrier.dstStageMask;
+			acquire.srcAccessMask = VK_ACCESS_2_NONE;
+			vulkan.staging.open_acquires.images.push_back(acquire);
+			vulkan.staging.open_acquire_stages |= static_cast<VkPipelineStageFlags>(barrier.dstStageMask);
+
+			barrier.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+			barrier.dstAccessMask = VK_ACCESS_2_NONE;
+		} else if (old_layout != VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+			// the graphics family owns sampled images, a transfer queue can only start over from UNDEFINED
+			throw std::invalid_argument("Unsupported layout transition on the transfer queue");
+		}
+	}
+
+	// recorded in front of the batch's next command, together with any other transitions queued up before it
+	if (vulkan.staging.cmd == VK_NULL_HANDLE) {
+		vk_staging_open(vulkan, vulkan.staging.head);
+	}
+	vulkan.staging.barriers.images.push_back(barrier);
+}
+
+void vk_copy_buffer_to_image(vulkan_t & vulkan, VkBuffer buffer, VkImage image, VkExtent3D extent) {
+	VkBufferImageCopy region = {
+		.bufferOffset = 0,
+		.bufferRowLength = 0,
+		.bufferImageHeight = 0,
+		.imageSubresource = {
+			.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+			.mipLevel = 0,
+			.baseArrayLayer = 0,
+			.layerCount = 1,
+		},
+		.imageOffset = { 0, 0, 0, },
+		.imageExtent = extent,
+	};
+
+	vk_copy_buffer_to_image_regions(vulkan, buffer, image, { region });
+}
+
+void vk_copy_buffer_to_image_regions(vulkan_t & vulkan, VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> & regions) {
+	vkCmdCopyBufferToImage(vk_staging_cmd(vulkan), buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+}
\ No newline at end of file